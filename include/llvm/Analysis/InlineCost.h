@@ -55,10 +55,10 @@ class InlineCost {
   };
 
   /// \brief The estimated cost of inlining this callsite.
-  const int Cost;
+  int Cost;
 
   /// \brief The adjusted threshold against which this cost was computed.
-  const int Threshold;
+  int Threshold;
 
   // Trivial constructor, interesting logic in the factory functions below.
   InlineCost(int Cost, int Threshold) : Cost(Cost), Threshold(Threshold) {}
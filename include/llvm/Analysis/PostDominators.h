@@ -79,6 +79,14 @@ struct PostDominatorTree : public FunctionPass {
     return DT->findNearestCommonDominator(A, B);
   }
 
+  /// Inform the tree about a batch of CFG edge insertions and deletions, so
+  /// that it can be kept in sync with a DominatorTree receiving the same
+  /// updates.
+  void
+  applyUpdates(ArrayRef<DominatorTreeBase<BasicBlock>::UpdateType> Updates) {
+    DT->applyUpdates(Updates);
+  }
+
   /// Get all nodes post-dominated by R, including R itself.
   void getDescendants(BasicBlock *R,
                       SmallVectorImpl<BasicBlock *> &Result) const {
@@ -260,6 +260,14 @@ namespace llvm {
     /// conditions dominating the backedge of a loop.
     bool WalkingBEDominatingConds;
 
+    /// The number of createSCEV calls currently on the stack.  Past
+    /// -scalar-evolution-max-value-depth, values are left as SCEVUnknown.
+    unsigned CreateSCEVDepth;
+
+    /// The number of backedge-taken count computations currently on the
+    /// stack, so that only the outermost one is timed.
+    unsigned BECountDepth;
+
     /// ExitLimit - Information about the number of loop iterations for which a
     /// loop exit's branch condition evaluates to the not-taken path.  This is a
     /// temporary pair of exact and max expressions that are eventually
@@ -417,6 +425,13 @@ namespace llvm {
     /// Analyze the expression.
     const SCEV *createSCEV(Value *V);
 
+    /// getOrCreateAddExpr, getOrCreateMulExpr - Return the uniqued add or mul
+    /// of exactly these (sorted, already folded) operands.
+    const SCEV *getOrCreateAddExpr(SmallVectorImpl<const SCEV *> &Ops,
+                                   SCEV::NoWrapFlags Flags);
+    const SCEV *getOrCreateMulExpr(SmallVectorImpl<const SCEV *> &Ops,
+                                   SCEV::NoWrapFlags Flags);
+
     /// createNodeForPHI - Provide the special handling we need to analyze PHI
     /// SCEVs.
     const SCEV *createNodeForPHI(PHINode *PN);
@@ -350,6 +350,13 @@ public:
   /// \brief Don't restrict interleaved unrolling to small loops.
   bool enableAggressiveInterleaving(bool LoopHasReductions) const;
 
+  /// \brief Return true if calls to memcmp with a small constant size should
+  /// be expanded inline into loads and compares. \p MaxLoadSize is set to the
+  /// widest load to use, in bytes, and \p MaxNumLoads to the largest number of
+  /// loads from each operand that an expansion may use.
+  bool enableMemCmpExpansion(unsigned &MaxLoadSize,
+                             unsigned &MaxNumLoads) const;
+
   /// \brief Return hardware support for population count.
   PopcntSupportKind getPopcntSupport(unsigned IntTyWidthInBit) const;
 
@@ -576,6 +583,8 @@ public:
   virtual unsigned getJumpBufSize() = 0;
   virtual bool shouldBuildLookupTables() = 0;
   virtual bool enableAggressiveInterleaving(bool LoopHasReductions) = 0;
+  virtual bool enableMemCmpExpansion(unsigned &MaxLoadSize,
+                                     unsigned &MaxNumLoads) = 0;
   virtual PopcntSupportKind getPopcntSupport(unsigned IntTyWidthInBit) = 0;
   virtual bool haveFastSqrt(Type *Ty) = 0;
   virtual unsigned getFPOpCost(Type *Ty) = 0;
@@ -715,6 +724,10 @@ public:
   bool enableAggressiveInterleaving(bool LoopHasReductions) override {
     return Impl.enableAggressiveInterleaving(LoopHasReductions);
   }
+  bool enableMemCmpExpansion(unsigned &MaxLoadSize,
+                             unsigned &MaxNumLoads) override {
+    return Impl.enableMemCmpExpansion(MaxLoadSize, MaxNumLoads);
+  }
   PopcntSupportKind getPopcntSupport(unsigned IntTyWidthInBit) override {
     return Impl.getPopcntSupport(IntTyWidthInBit);
   }
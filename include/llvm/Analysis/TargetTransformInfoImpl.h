@@ -226,6 +226,10 @@ public:
 
   bool enableAggressiveInterleaving(bool LoopHasReductions) { return false; }
 
+  bool enableMemCmpExpansion(unsigned &MaxLoadSize, unsigned &MaxNumLoads) {
+    return false;
+  }
+
   TTI::PopcntSupportKind getPopcntSupport(unsigned IntTyWidthInBit) {
     return TTI::PSK_Software;
   }
@@ -427,6 +427,17 @@ private:
 
     BitsInCurWord = 0;
   }
+
+  /// Read \p NumElts fixed-width fields of \p Width bits into \p Vals,
+  /// decoding each as a char6 if \p IsChar6 is set. Fields that lie entirely
+  /// within CurWord are extracted without refilling or re-checking the word.
+  void readFixedRun(unsigned Width, bool IsChar6, unsigned NumElts,
+                    SmallVectorImpl<uint64_t> &Vals);
+
+  /// Read \p NumElts VBR fields with \p NumBits chunks into \p Vals. Runs of
+  /// single-chunk values that lie within CurWord are decoded in one pass.
+  void readVBR64Run(unsigned NumBits, unsigned NumElts,
+                    SmallVectorImpl<uint64_t> &Vals);
 public:
 
   unsigned ReadCode() {
@@ -10,7 +10,9 @@
 #ifndef LLVM_LIB_DEBUGINFO_DWARFCONTEXT_H
 #define LLVM_LIB_DEBUGINFO_DWARFCONTEXT_H
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/DebugInfo/DIContext.h"
 #include "llvm/DebugInfo/DWARF/DWARFCompileUnit.h"
@@ -21,6 +23,7 @@
 #include "llvm/DebugInfo/DWARF/DWARFDebugRangeList.h"
 #include "llvm/DebugInfo/DWARF/DWARFSection.h"
 #include "llvm/DebugInfo/DWARF/DWARFTypeUnit.h"
+#include <deque>
 #include <vector>
 
 namespace llvm {
@@ -252,46 +255,116 @@ class DWARFContextInMemory : public DWARFContext {
   DWARFSection AppleNamespacesSection;
   DWARFSection AppleObjCSection;
 
-  SmallVector<SmallString<32>, 4> UncompressedSections;
+  /// A zlib-compressed section that has not been needed yet.
+  struct CompressedSection {
+    StringRef Data;
+    uint64_t OriginalSize;
+    /// Index into UncompressedSections once uncompressed, -1 before.
+    int Uncompressed;
+  };
+  SmallVector<CompressedSection, 4> CompressedSections;
+  /// Map from the members still holding a compressed section to its index in
+  /// CompressedSections. Several members may share one section.
+  DenseMap<const StringRef *, unsigned> PendingSections;
+  /// Storage for uncompressed sections. A deque, so that the sections stay at
+  /// the same address while more are added.
+  std::deque<SmallString<0>> UncompressedSections;
+
+  /// Uncompress the section \p Data stands for, if it has not been accessed
+  /// yet, and point \p Data at its contents.
+  void uncompressSection(StringRef &Data);
+  StringRef getSection(StringRef &Data) {
+    if (!PendingSections.empty())
+      uncompressSection(Data);
+    return Data;
+  }
+  const DWARFSection &getSection(DWARFSection &Section) {
+    getSection(Section.Data);
+    return Section;
+  }
+  const TypeSectionMap &getSections(TypeSectionMap &Sections) {
+    if (!PendingSections.empty())
+      for (auto &P : Sections)
+        uncompressSection(P.second.Data);
+    return Sections;
+  }
 
 public:
   DWARFContextInMemory(const object::ObjectFile &Obj,
     const LoadedObjectInfo *L = nullptr);
   bool isLittleEndian() const override { return IsLittleEndian; }
   uint8_t getAddressSize() const override { return AddressSize; }
-  const DWARFSection &getInfoSection() override { return InfoSection; }
-  const TypeSectionMap &getTypesSections() override { return TypesSections; }
-  StringRef getAbbrevSection() override { return AbbrevSection; }
-  const DWARFSection &getLocSection() override { return LocSection; }
-  StringRef getARangeSection() override { return ARangeSection; }
-  StringRef getDebugFrameSection() override { return DebugFrameSection; }
-  const DWARFSection &getLineSection() override { return LineSection; }
-  StringRef getStringSection() override { return StringSection; }
-  StringRef getRangeSection() override { return RangeSection; }
-  StringRef getPubNamesSection() override { return PubNamesSection; }
-  StringRef getPubTypesSection() override { return PubTypesSection; }
-  StringRef getGnuPubNamesSection() override { return GnuPubNamesSection; }
-  StringRef getGnuPubTypesSection() override { return GnuPubTypesSection; }
-  const DWARFSection& getAppleNamesSection() override { return AppleNamesSection; }
-  const DWARFSection& getAppleTypesSection() override { return AppleTypesSection; }
-  const DWARFSection& getAppleNamespacesSection() override { return AppleNamespacesSection; }
-  const DWARFSection& getAppleObjCSection() override { return AppleObjCSection; }
+  const DWARFSection &getInfoSection() override {
+    return getSection(InfoSection);
+  }
+  const TypeSectionMap &getTypesSections() override {
+    return getSections(TypesSections);
+  }
+  StringRef getAbbrevSection() override { return getSection(AbbrevSection); }
+  const DWARFSection &getLocSection() override {
+    return getSection(LocSection);
+  }
+  StringRef getARangeSection() override { return getSection(ARangeSection); }
+  StringRef getDebugFrameSection() override {
+    return getSection(DebugFrameSection);
+  }
+  const DWARFSection &getLineSection() override {
+    return getSection(LineSection);
+  }
+  StringRef getStringSection() override { return getSection(StringSection); }
+  StringRef getRangeSection() override { return getSection(RangeSection); }
+  StringRef getPubNamesSection() override {
+    return getSection(PubNamesSection);
+  }
+  StringRef getPubTypesSection() override {
+    return getSection(PubTypesSection);
+  }
+  StringRef getGnuPubNamesSection() override {
+    return getSection(GnuPubNamesSection);
+  }
+  StringRef getGnuPubTypesSection() override {
+    return getSection(GnuPubTypesSection);
+  }
+  const DWARFSection& getAppleNamesSection() override {
+    return getSection(AppleNamesSection);
+  }
+  const DWARFSection& getAppleTypesSection() override {
+    return getSection(AppleTypesSection);
+  }
+  const DWARFSection& getAppleNamespacesSection() override {
+    return getSection(AppleNamespacesSection);
+  }
+  const DWARFSection& getAppleObjCSection() override {
+    return getSection(AppleObjCSection);
+  }
 
   // Sections for DWARF5 split dwarf proposal.
-  const DWARFSection &getInfoDWOSection() override { return InfoDWOSection; }
+  const DWARFSection &getInfoDWOSection() override {
+    return getSection(InfoDWOSection);
+  }
   const TypeSectionMap &getTypesDWOSections() override {
-    return TypesDWOSections;
+    return getSections(TypesDWOSections);
+  }
+  StringRef getAbbrevDWOSection() override {
+    return getSection(AbbrevDWOSection);
+  }
+  const DWARFSection &getLineDWOSection() override {
+    return getSection(LineDWOSection);
+  }
+  const DWARFSection &getLocDWOSection() override {
+    return getSection(LocDWOSection);
+  }
+  StringRef getStringDWOSection() override {
+    return getSection(StringDWOSection);
   }
-  StringRef getAbbrevDWOSection() override { return AbbrevDWOSection; }
-  const DWARFSection &getLineDWOSection() override { return LineDWOSection; }
-  const DWARFSection &getLocDWOSection() override { return LocDWOSection; }
-  StringRef getStringDWOSection() override { return StringDWOSection; }
   StringRef getStringOffsetDWOSection() override {
-    return StringOffsetDWOSection;
+    return getSection(StringOffsetDWOSection);
+  }
+  StringRef getRangeDWOSection() override {
+    return getSection(RangeDWOSection);
   }
-  StringRef getRangeDWOSection() override { return RangeDWOSection; }
   StringRef getAddrSection() override {
-    return AddrSection;
+    return getSection(AddrSection);
   }
 };
 
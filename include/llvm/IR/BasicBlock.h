@@ -70,6 +70,9 @@ public:
 private:
   InstListType InstList;
   Function *Parent;
+  /// \brief Whether the Order field of the contained instructions is up to
+  /// date. Cleared whenever an instruction is inserted into this block.
+  bool InstrOrderValid;
 
   void setParent(Function *parent);
   friend class SymbolTableListTraits<BasicBlock, Function>;
@@ -319,6 +322,19 @@ public:
   LandingPadInst *getLandingPadInst();
   const LandingPadInst *getLandingPadInst() const;
 
+  /// \brief Returns true if the Order field of child instructions is valid.
+  bool isInstrOrderValid() const { return InstrOrderValid; }
+
+  /// \brief Mark the instruction ordering invalid.
+  ///
+  /// This is done on every instruction insertion; removing instructions keeps
+  /// the relative order of the remaining ones intact.
+  void invalidateOrders() { InstrOrderValid = false; }
+
+  /// \brief Renumber the instructions of this block and mark the ordering as
+  /// valid.
+  void renumberInstructions();
+
 private:
   /// \brief Increment the internal refcount of the number of BlockAddresses
   /// referencing this BasicBlock by \p Amt.
@@ -55,6 +55,12 @@ class Instruction : public User, public ilist_node<Instruction> {
   BasicBlock *Parent;
   DebugLoc DbgLoc;                         // 'dbg' Metadata cache.
 
+  /// Relative order of this instruction in its parent basic block. Used for
+  /// O(1) local dominance checks between instructions. Only meaningful while
+  /// the parent's instruction ordering is valid.
+  unsigned Order;
+  friend class BasicBlock;
+
   enum {
     /// HasMetadataBit - This is a bit stored in the SubClassData field which
     /// indicates whether this instruction has metadata attached to it or not.
@@ -104,6 +110,12 @@ public:
   /// MovePos.
   void moveBefore(Instruction *MovePos);
 
+  /// comesBefore - Given an instruction Other in the same basic block as this
+  /// instruction, return true if this instruction comes before Other. The
+  /// parent's instruction numbering is recomputed lazily, so this is amortized
+  /// O(1) rather than a linear scan of the block.
+  bool comesBefore(const Instruction *Other) const;
+
   //===--------------------------------------------------------------------===//
   // Subclass classification.
   //===--------------------------------------------------------------------===//
@@ -72,6 +72,8 @@ public:
   virtual bool needsRelocateWithSymbol(const MCSymbol &Sym,
                                        unsigned Type) const;
 
+  /// Sort the relocations of one section.  This may be called concurrently
+  /// for different sections, so it must not modify shared state.
   virtual void sortRelocs(const MCAssembler &Asm,
                           std::vector<ELFRelocationEntry> &Relocs);
 
@@ -56,6 +56,20 @@ public:
   /// still manually register any additional analyses.
   void registerFunctionAnalyses(FunctionAnalysisManager &FAM);
 
+  /// \brief Add the function simplification pipeline.
+  ///
+  /// This is a bottom-up walk over the call graph that runs the function
+  /// simplification passes ported to the new pass manager so far (lower-expect,
+  /// simplify-cfg, early-cse and instcombine) over each function. It is a small
+  /// subset of what the legacy \c PassManagerBuilder schedules at any -O level:
+  /// there is no inliner, SROA, GVN or loop pipeline yet, so it is not offered
+  /// as a default pipeline.
+  ///
+  /// The pipeline is available in textual descriptions as
+  /// \c function-simplification.
+  void addFunctionSimplificationPipeline(ModulePassManager &MPM,
+                                         bool DebugLogging = false);
+
   /// \brief Parse a textual pass pipeline description into a \c ModulePassManager.
   ///
   /// The format of the textual pass pipeline description looks something like:
@@ -88,7 +102,8 @@ public:
                          bool VerifyEachPass = true, bool DebugLogging = false);
 
 private:
-  bool parseModulePassName(ModulePassManager &MPM, StringRef Name);
+  bool parseModulePassName(ModulePassManager &MPM, StringRef Name,
+                           bool DebugLogging);
   bool parseCGSCCPassName(CGSCCPassManager &CGPM, StringRef Name);
   bool parseFunctionPassName(FunctionPassManager &FPM, StringRef Name);
   bool parseFunctionPassPipeline(FunctionPassManager &FPM,
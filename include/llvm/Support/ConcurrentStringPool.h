@@ -0,0 +1,86 @@
+//===-- ConcurrentStringPool.h - Thread-safe string interner ----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares a string interner that may be used from several threads
+// at once.
+//
+// To intern a string:
+//
+//   ConcurrentStringPool Pool;
+//   StringRef Str = Pool.intern("wakka wakka");
+//
+// Interning the same contents again, from any thread, returns a StringRef
+// with the same data pointer, so interned strings can be compared by pointer.
+// Unlike StringPool, strings are not reference counted: they are allocated in
+// per-shard arenas and live, at a stable address, until the pool is
+// destroyed. This matches how symbol and metadata names are used, and keeps
+// the fast path free of atomic reference count updates.
+//
+// The table is split into shards selected by the string's hash, each with its
+// own lock, so threads interning different strings rarely contend.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_CONCURRENTSTRINGPOOL_H
+#define LLVM_SUPPORT_CONCURRENTSTRINGPOOL_H
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/Mutex.h"
+
+namespace llvm {
+
+  /// ConcurrentStringPool - A thread-safe, lock-striped string interner.
+  class ConcurrentStringPool {
+  public:
+    /// Number of independently locked shards. A power of two.
+    enum { NumShards = 32 };
+
+  private:
+    struct Shard {
+      mutable sys::Mutex Lock;
+      StringMap<char, BumpPtrAllocator> Strings;
+
+      Shard() : Lock(/*recursive=*/false) {}
+    };
+
+    Shard Shards[NumShards];
+
+    Shard &getShard(StringRef Str);
+    const Shard &getShard(StringRef Str) const {
+      return const_cast<ConcurrentStringPool *>(this)->getShard(Str);
+    }
+
+    ConcurrentStringPool(const ConcurrentStringPool &) = delete;
+    void operator=(const ConcurrentStringPool &) = delete;
+
+  public:
+    ConcurrentStringPool();
+    ~ConcurrentStringPool();
+
+    /// intern - Returns the pool's copy of \p Str, adding it if it is not
+    /// already present. The returned data is nul-terminated and stays valid,
+    /// at the same address, until the pool is destroyed.
+    StringRef intern(StringRef Str);
+
+    /// count - Returns true if \p Str has been interned.
+    bool count(StringRef Str) const;
+
+    /// size - Returns the number of distinct strings in the pool. Only exact
+    /// if no other thread is interning at the same time.
+    size_t size() const;
+
+    /// getMemorySize - Returns the number of bytes allocated for strings.
+    size_t getMemorySize() const;
+  };
+
+} // End llvm namespace
+
+#endif
@@ -41,6 +41,11 @@ class formatted_raw_ostream : public raw_ostream {
   ///
   const char *Scanned;
 
+  /// TrackPosition - Whether Position is kept up to date.  Scanning every
+  /// byte written is a measurable cost for large outputs that never need
+  /// to be aligned.
+  bool TrackPosition;
+
   void write_impl(const char *Ptr, size_t Size) override;
 
   /// current_pos - Return the current position within the stream,
@@ -87,10 +92,11 @@ public:
   /// underneath it.
   ///
   formatted_raw_ostream(raw_ostream &Stream)
-      : TheStream(nullptr), Position(0, 0) {
+      : TheStream(nullptr), Position(0, 0), TrackPosition(true) {
     setStream(Stream);
   }
-  explicit formatted_raw_ostream() : TheStream(nullptr), Position(0, 0) {
+  explicit formatted_raw_ostream()
+      : TheStream(nullptr), Position(0, 0), TrackPosition(true) {
     Scanned = nullptr;
   }
 
@@ -107,10 +113,24 @@ public:
   formatted_raw_ostream &PadToColumn(unsigned NewCol);
 
   /// getColumn - Return the column number
-  unsigned getColumn() { return Position.first; }
+  unsigned getColumn() {
+    assert(TrackPosition && "Position tracking is disabled!");
+    return Position.first;
+  }
 
   /// getLine - Return the line number
-  unsigned getLine() { return Position.second; }
+  unsigned getLine() {
+    assert(TrackPosition && "Position tracking is disabled!");
+    return Position.second;
+  }
+
+  /// disablePositionTracking - Stop keeping track of the line and column.
+  /// Output written after this is not scanned, so getLine, getColumn and
+  /// PadToColumn may no longer be used.
+  void disablePositionTracking() { TrackPosition = false; }
+
+  /// isTrackingPosition - Return true if line and column are kept up to date.
+  bool isTrackingPosition() const { return TrackPosition; }
 
   raw_ostream &resetColor() override {
     TheStream->resetColor();
@@ -18,6 +18,7 @@
 #ifndef LLVM_SUPPORT_GENERICDOMTREE_H
 #define LLVM_SUPPORT_GENERICDOMTREE_H
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DepthFirstIterator.h"
 #include "llvm/ADT/GraphTraits.h"
@@ -27,6 +28,8 @@
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
+#include <queue>
+#include <type_traits>
 
 namespace llvm {
 
@@ -63,6 +66,7 @@ public:
 };
 
 template <class NodeT> class DominatorTreeBase;
+template <class NodeT> class DomTreeIncrementalUpdater;
 struct PostDominatorTree;
 
 /// \brief Base class for the actual dominator tree node.
@@ -70,9 +74,11 @@ template <class NodeT> class DomTreeNodeBase {
   NodeT *TheBB;
   DomTreeNodeBase<NodeT> *IDom;
   std::vector<DomTreeNodeBase<NodeT> *> Children;
+  unsigned Level;
   mutable int DFSNumIn, DFSNumOut;
 
   template <class N> friend class DominatorTreeBase;
+  template <class N> friend class DomTreeIncrementalUpdater;
   friend struct PostDominatorTree;
 
 public:
@@ -92,7 +98,8 @@ public:
   }
 
   DomTreeNodeBase(NodeT *BB, DomTreeNodeBase<NodeT> *iDom)
-      : TheBB(BB), IDom(iDom), DFSNumIn(-1), DFSNumOut(-1) {}
+      : TheBB(BB), IDom(iDom), Level(iDom ? iDom->Level + 1 : 0),
+        DFSNumIn(-1), DFSNumOut(-1) {}
 
   std::unique_ptr<DomTreeNodeBase<NodeT>>
   addChild(std::unique_ptr<DomTreeNodeBase<NodeT>> C) {
@@ -102,6 +109,10 @@ public:
 
   size_t getNumChildren() const { return Children.size(); }
 
+  /// getLevel - Return the depth of this node in the tree. The root node has
+  /// level zero.
+  unsigned getLevel() const { return Level; }
+
   void clearAllChildren() { Children.clear(); }
 
   bool compare(const DomTreeNodeBase<NodeT> *Other) const {
@@ -135,6 +146,7 @@ public:
       // Switch to new dominator
       IDom = NewIDom;
       IDom->Children.push_back(this);
+      UpdateLevel();
     }
   }
 
@@ -150,6 +162,27 @@ private:
     return this->DFSNumIn >= other->DFSNumIn &&
            this->DFSNumOut <= other->DFSNumOut;
   }
+
+  // Recompute the level of this node and of every node below it whose level
+  // is out of date after an IDom change.
+  void UpdateLevel() {
+    assert(IDom);
+    if (Level == IDom->Level + 1)
+      return;
+
+    SmallVector<DomTreeNodeBase<NodeT> *, 64> WorkStack;
+    WorkStack.push_back(this);
+    while (!WorkStack.empty()) {
+      DomTreeNodeBase<NodeT> *Current = WorkStack.pop_back_val();
+      Current->Level = Current->IDom->Level + 1;
+
+      for (DomTreeNodeBase<NodeT> *C : *Current) {
+        assert(C->IDom);
+        if (C->Level != C->IDom->Level + 1)
+          WorkStack.push_back(C);
+      }
+    }
+  }
 };
 
 template <class NodeT>
@@ -608,6 +641,49 @@ public:
       this->Split<NodeT *, GraphTraits<NodeT *>>(*this, NewBB);
   }
 
+  /// UpdateKind - The kind of a CFG edge update passed to applyUpdates.
+  enum UpdateKind { Insert, Delete };
+
+  /// UpdateType - A single CFG edge insertion or deletion From -> To.
+  struct UpdateType {
+    UpdateKind Kind;
+    NodeT *From;
+    NodeT *To;
+
+    UpdateType(UpdateKind Kind, NodeT *From, NodeT *To)
+        : Kind(Kind), From(From), To(To) {}
+  };
+
+  /// insertEdge - Inform the tree that the edge From -> To was inserted into
+  /// the CFG. The CFG must already contain the new edge.
+  void insertEdge(NodeT *From, NodeT *To) {
+    applyUpdates(UpdateType(Insert, From, To));
+  }
+
+  /// deleteEdge - Inform the tree that the edge From -> To was deleted from
+  /// the CFG. The CFG must already be missing the edge.
+  void deleteEdge(NodeT *From, NodeT *To) {
+    applyUpdates(UpdateType(Delete, From, To));
+  }
+
+  /// applyUpdates - Incrementally update the tree after a batch of CFG edge
+  /// insertions and deletions. The CFG must already reflect every update in
+  /// the batch; updates that cancel each other out are dropped, and the
+  /// remaining ones are applied one at a time against a view of the CFG that
+  /// hides the updates not applied yet.
+  ///
+  /// Forward dominator trees are updated with the depth-based search
+  /// algorithms of Georgiadis et al., "An Experimental Study of Dynamic
+  /// Dominators", and only recompute the subtrees affected by a deletion.
+  /// Post-dominator trees, and batches touching a large fraction of the
+  /// tree, are recalculated from scratch once for the whole batch.
+  void applyUpdates(ArrayRef<UpdateType> Updates);
+
+  /// verify - Recalculate the tree for the current CFG and check that it
+  /// matches this one, including the cached node levels. This is expensive
+  /// and intended for assertions and -verify-dom-info style checking.
+  bool verify() const;
+
   /// print - Convert to human readable form
   ///
   void print(raw_ostream &o) const {
@@ -639,6 +715,19 @@ protected:
   friend void
   Calculate(DominatorTreeBase<typename GraphTraits<N>::NodeType> &DT, FuncT &F);
 
+  friend class DomTreeIncrementalUpdater<NodeT>;
+
+  // Return some block of the CFG this tree was computed for, so that the tree
+  // can be recalculated without being handed the function again.
+  NodeT *getAnyBlock() const {
+    if (!this->Roots.empty())
+      return this->Roots.front();
+    for (const auto &Entry : DomTreeNodes)
+      if (Entry.first)
+        return Entry.first;
+    return nullptr;
+  }
+
 
   DomTreeNodeBase<NodeT> *getNodeForBlock(NodeT *BB) {
     if (DomTreeNodeBase<NodeT> *Node = getNode(BB))
@@ -772,6 +861,643 @@ bool DominatorTreeBase<NodeT>::properlyDominates(const NodeT *A,
                    getNode(const_cast<NodeT *>(B)));
 }
 
+
+/// \brief Incremental dominator tree updater.
+///
+/// Implements the insertion and deletion algorithms from:
+///
+///   Loukas Georgiadis, et al. "An Experimental Study of Dynamic Dominators",
+///   ESA 2012.
+///
+/// Insertions use a depth-based search over the node levels to find the
+/// affected nodes, which all get the nearest common dominator of the edge
+/// endpoints as their new immediate dominator. Deletions rebuild only the
+/// subtree rooted at the nearest common dominator using SemiNCA.
+///
+/// The updater works on forward dominator trees only.
+template <class NodeT> class DomTreeIncrementalUpdater {
+  typedef DominatorTreeBase<NodeT> DomTreeT;
+  typedef DomTreeNodeBase<NodeT> TreeNode;
+  typedef typename DomTreeT::UpdateKind UpdateKind;
+  typedef typename DomTreeT::UpdateType UpdateType;
+  typedef SmallVector<std::pair<NodeT *, UpdateKind>, 4> FutureChildrenTy;
+
+  DomTreeT &DT;
+
+  // Updates that have not been applied to the tree yet, indexed by both ends.
+  // They are used to present the CFG as it was before those updates.
+  DenseMap<NodeT *, FutureChildrenTy> FutureSuccessors;
+  DenseMap<NodeT *, FutureChildrenTy> FuturePredecessors;
+
+  // Set when the tree had to be recalculated from the final CFG, in which case
+  // the remaining updates are already accounted for.
+  bool IsRecalculated;
+
+  // Information record used by the SemiNCA subtree (re)computation.
+  struct InfoRec {
+    unsigned DFSNum;
+    unsigned Parent;
+    unsigned Semi;
+    NodeT *Label;
+    NodeT *IDom;
+    SmallVector<NodeT *, 2> ReverseChildren;
+
+    InfoRec() : DFSNum(0), Parent(0), Semi(0), Label(nullptr), IDom(nullptr) {}
+  };
+
+  // Number to node mapping is 1-based.
+  std::vector<NodeT *> NumToNode;
+  DenseMap<NodeT *, InfoRec> NodeToInfo;
+
+public:
+  explicit DomTreeIncrementalUpdater(DomTreeT &DT)
+      : DT(DT), IsRecalculated(false) {}
+
+  void applyUpdates(ArrayRef<UpdateType> Updates);
+
+private:
+  // Drop updates that cancel each other out, as well as deletions of edges
+  // that are still present in the CFG through a parallel edge.
+  static void legalizeUpdates(ArrayRef<UpdateType> AllUpdates,
+                              SmallVectorImpl<UpdateType> &Result);
+
+  static bool hasCFGEdge(NodeT *From, NodeT *To) {
+    typedef GraphTraits<NodeT *> GraphT;
+    for (auto I = GraphT::child_begin(From), E = GraphT::child_end(From);
+         I != E; ++I)
+      if (*I == To)
+        return true;
+    return false;
+  }
+
+  // Collect the successors (or predecessors) of N as seen with the pending
+  // updates not applied yet.
+  template <bool IsInverse>
+  void getChildren(NodeT *N, SmallVectorImpl<NodeT *> &Result) const {
+    typedef typename std::conditional<IsInverse,
+                                      GraphTraits<Inverse<NodeT *>>,
+                                      GraphTraits<NodeT *>>::type GraphT;
+    Result.clear();
+    Result.append(GraphT::child_begin(N), GraphT::child_end(N));
+
+    const DenseMap<NodeT *, FutureChildrenTy> &FutureChildren =
+        IsInverse ? FuturePredecessors : FutureSuccessors;
+    auto FCIt = FutureChildren.find(N);
+    if (FCIt == FutureChildren.end())
+      return;
+
+    for (const auto &ChildAndKind : FCIt->second) {
+      NodeT *Child = ChildAndKind.first;
+      // Reverse-apply the future update.
+      if (ChildAndKind.second == DomTreeT::Insert)
+        Result.erase(std::remove(Result.begin(), Result.end(), Child),
+                     Result.end());
+      else
+        Result.push_back(Child);
+    }
+  }
+
+  static void removeFutureChild(FutureChildrenTy &Children, NodeT *Child,
+                                UpdateKind Kind) {
+    auto I = std::find(Children.begin(), Children.end(),
+                       std::make_pair(Child, Kind));
+    assert(I != Children.end() && "Update not pending?");
+    Children.erase(I);
+  }
+
+  // Nearest common dominator of two reachable nodes, computed from the node
+  // levels so that it does not depend on the DFS numbers being valid.
+  static TreeNode *getNCD(TreeNode *A, TreeNode *B) {
+    while (A != B) {
+      if (A->getLevel() < B->getLevel())
+        std::swap(A, B);
+      A = A->getIDom();
+    }
+    return A;
+  }
+
+  void recalculateFromScratch() {
+    DT.recalculate(*DT.getRoot()->getParent());
+    IsRecalculated = true;
+  }
+
+  void insertEdge(NodeT *From, NodeT *To);
+  void insertReachable(TreeNode *From, TreeNode *To);
+  void insertUnreachable(TreeNode *From, NodeT *To);
+  void deleteEdge(NodeT *From, NodeT *To);
+  void deleteReachable(TreeNode *FromTN, TreeNode *ToTN);
+  void deleteUnreachable(TreeNode *ToTN);
+  bool hasProperSupport(TreeNode *TN);
+
+  void clearSemiNCA() {
+    NumToNode.clear();
+    NumToNode.push_back(nullptr);
+    NodeToInfo.clear();
+  }
+
+  // Number the nodes reachable from V in depth-first order, descending along
+  // an edge From -> To only when Condition(From, To) holds.
+  template <typename DescendCondition>
+  unsigned runDFS(NodeT *V, unsigned LastNum, DescendCondition Condition,
+                  unsigned AttachToNum);
+  // Compute the immediate dominators of the numbered nodes, ignoring the
+  // predecessors above MinLevel in the tree.
+  void runSemiNCA(unsigned MinLevel);
+  NodeT *eval(NodeT *V, unsigned LastLinked);
+  // Create tree nodes for the numbered (previously unreachable) blocks.
+  void attachNewSubtree(TreeNode *AttachTo);
+  // Update the immediate dominators of the numbered (existing) nodes.
+  void reattachExistingSubtree(TreeNode *AttachTo);
+};
+
+template <class NodeT>
+void DomTreeIncrementalUpdater<NodeT>::legalizeUpdates(
+    ArrayRef<UpdateType> AllUpdates, SmallVectorImpl<UpdateType> &Result) {
+  // Count the insertions and deletions of each edge, keeping the edges in the
+  // order they were first seen so that the result is deterministic.
+  SmallDenseMap<std::pair<NodeT *, NodeT *>, int, 4> Operations;
+  SmallVector<std::pair<NodeT *, NodeT *>, 4> Edges;
+  for (const UpdateType &U : AllUpdates) {
+    // Self-loops never change dominance.
+    if (U.From == U.To)
+      continue;
+    auto Edge = std::make_pair(U.From, U.To);
+    auto Inserted = Operations.insert(std::make_pair(Edge, 0));
+    if (Inserted.second)
+      Edges.push_back(Edge);
+    Inserted.first->second += U.Kind == DomTreeT::Insert ? 1 : -1;
+  }
+
+  for (const auto &Edge : Edges) {
+    int NumInsertions = Operations.lookup(Edge);
+    if (NumInsertions == 0)
+      continue;
+    UpdateKind Kind = NumInsertions > 0 ? DomTreeT::Insert : DomTreeT::Delete;
+    if (Kind == DomTreeT::Delete && hasCFGEdge(Edge.first, Edge.second))
+      continue;
+    Result.push_back(UpdateType(Kind, Edge.first, Edge.second));
+  }
+}
+
+template <class NodeT>
+void DomTreeIncrementalUpdater<NodeT>::applyUpdates(
+    ArrayRef<UpdateType> Updates) {
+  SmallVector<UpdateType, 8> Legalized;
+  legalizeUpdates(Updates, Legalized);
+  if (Legalized.empty())
+    return;
+
+  // Recalculating is cheaper than applying many updates to a small tree.
+  if (Legalized.size() > 100 &&
+      Legalized.size() > DT.DomTreeNodes.size() / 40) {
+    recalculateFromScratch();
+    return;
+  }
+
+  for (const UpdateType &U : Legalized) {
+    FutureSuccessors[U.From].push_back(std::make_pair(U.To, U.Kind));
+    FuturePredecessors[U.To].push_back(std::make_pair(U.From, U.Kind));
+  }
+
+  for (const UpdateType &U : Legalized) {
+    // Expose this update to the CFG view.
+    removeFutureChild(FutureSuccessors[U.From], U.To, U.Kind);
+    removeFutureChild(FuturePredecessors[U.To], U.From, U.Kind);
+
+    if (U.Kind == DomTreeT::Insert)
+      insertEdge(U.From, U.To);
+    else
+      deleteEdge(U.From, U.To);
+
+    if (IsRecalculated)
+      return;
+  }
+}
+
+template <class NodeT>
+void DomTreeIncrementalUpdater<NodeT>::insertEdge(NodeT *From, NodeT *To) {
+  TreeNode *FromTN = DT.getNode(From);
+  // Insertion in an unreachable subgraph -- nothing to do.
+  if (!FromTN)
+    return;
+
+  if (TreeNode *ToTN = DT.getNode(To))
+    insertReachable(FromTN, ToTN);
+  else
+    insertUnreachable(FromTN, To);
+}
+
+template <class NodeT>
+void DomTreeIncrementalUpdater<NodeT>::insertReachable(TreeNode *From,
+                                                       TreeNode *To) {
+  TreeNode *NCD = getNCD(From, To);
+  // Nothing affected -- the NCA property holds.
+  if (NCD == To || NCD == To->getIDom())
+    return;
+
+  // A node V is affected iff depth(NCD) + 1 < depth(V) and there is a path
+  // from To to V whose nodes W all have depth(V) <= depth(W). This is a widest
+  // path problem, solved with a bucket queue processing the deepest nodes
+  // first (the depth-based search).
+  const unsigned NCDLevel = NCD->getLevel();
+  typedef std::pair<unsigned, TreeNode *> BucketElementTy;
+  std::priority_queue<BucketElementTy, SmallVector<BucketElementTy, 8>>
+      Bucket;
+  SmallPtrSet<TreeNode *, 8> Visited;
+  SmallVector<TreeNode *, 8> Affected;
+  SmallVector<TreeNode *, 8> Stack;
+  SmallVector<NodeT *, 8> Successors;
+
+  Bucket.push(std::make_pair(To->getLevel(), To));
+  Visited.insert(To);
+
+  while (!Bucket.empty()) {
+    TreeNode *Current = Bucket.top().second;
+    Bucket.pop();
+    const unsigned CurrentLevel = Current->getLevel();
+    Affected.push_back(Current);
+
+    Stack.push_back(Current);
+    while (!Stack.empty()) {
+      TreeNode *TN = Stack.pop_back_val();
+      getChildren<false>(TN->getBlock(), Successors);
+      for (NodeT *Succ : Successors) {
+        TreeNode *SuccTN = DT.getNode(Succ);
+        assert(SuccTN && "Unreachable successor found at reachable insertion");
+        const unsigned SuccLevel = SuccTN->getLevel();
+
+        // There is no need to visit nodes that are at or above NCD's children.
+        if (SuccLevel <= NCDLevel + 1)
+          continue;
+        if (!Visited.insert(SuccTN).second)
+          continue;
+
+        // A deeper successor is not affected, but it may lead to affected
+        // nodes; otherwise the successor itself is affected.
+        if (SuccLevel > CurrentLevel)
+          Stack.push_back(SuccTN);
+        else
+          Bucket.push(std::make_pair(SuccLevel, SuccTN));
+      }
+    }
+  }
+
+  for (TreeNode *TN : Affected)
+    TN->setIDom(NCD);
+}
+
+template <class NodeT>
+void DomTreeIncrementalUpdater<NodeT>::insertUnreachable(TreeNode *From,
+                                                         NodeT *To) {
+  // Discover the nodes that became reachable, collecting the edges from them
+  // to nodes that were already reachable.
+  SmallVector<std::pair<NodeT *, TreeNode *>, 8> DiscoveredEdgesToReachable;
+  auto UnreachableDescender = [&](NodeT *Src, NodeT *Dst) {
+    TreeNode *DstTN = DT.getNode(Dst);
+    if (!DstTN)
+      return true;
+    DiscoveredEdgesToReachable.push_back(std::make_pair(Src, DstTN));
+    return false;
+  };
+
+  clearSemiNCA();
+  runDFS(To, 0, UnreachableDescender, 0);
+  runSemiNCA(0);
+  attachNewSubtree(From);
+
+  // The new subtree is now reachable; connect the edges leaving it.
+  for (const auto &Edge : DiscoveredEdgesToReachable)
+    insertReachable(DT.getNode(Edge.first), Edge.second);
+}
+
+template <class NodeT>
+void DomTreeIncrementalUpdater<NodeT>::deleteEdge(NodeT *From, NodeT *To) {
+  TreeNode *FromTN = DT.getNode(From);
+  // Deletion in an unreachable subgraph -- nothing to do.
+  if (!FromTN)
+    return;
+  TreeNode *ToTN = DT.getNode(To);
+  if (!ToTN)
+    return;
+
+  // If To dominates From, the deleted edge was a back edge and nothing
+  // changes.
+  TreeNode *NCD = getNCD(FromTN, ToTN);
+  if (NCD == ToTN)
+    return;
+
+  // To remains reachable if it was reached through another edge.
+  if (FromTN != ToTN->getIDom() || hasProperSupport(ToTN))
+    deleteReachable(FromTN, ToTN);
+  else
+    deleteUnreachable(ToTN);
+}
+
+template <class NodeT>
+bool DomTreeIncrementalUpdater<NodeT>::hasProperSupport(TreeNode *TN) {
+  SmallVector<NodeT *, 8> Predecessors;
+  getChildren<true>(TN->getBlock(), Predecessors);
+  for (NodeT *Pred : Predecessors) {
+    TreeNode *PredTN = DT.getNode(Pred);
+    if (!PredTN)
+      continue;
+    if (getNCD(TN, PredTN) != TN)
+      return true;
+  }
+  return false;
+}
+
+template <class NodeT>
+void DomTreeIncrementalUpdater<NodeT>::deleteReachable(TreeNode *FromTN,
+                                                       TreeNode *ToTN) {
+  // Find the top of the subtree that needs to be rebuilt.
+  TreeNode *ToIDomTN = getNCD(FromTN, ToTN);
+  TreeNode *PrevIDomSubTree = ToIDomTN->getIDom();
+
+  // The subtree to rebuild starts at the root; rebuild the whole tree.
+  if (!PrevIDomSubTree) {
+    recalculateFromScratch();
+    return;
+  }
+
+  // Only visit the nodes in the subtree starting at ToIDom.
+  const unsigned Level = ToIDomTN->getLevel();
+  auto DescendBelow = [&](NodeT *, NodeT *Dst) {
+    return DT.getNode(Dst)->getLevel() > Level;
+  };
+
+  clearSemiNCA();
+  runDFS(ToIDomTN->getBlock(), 0, DescendBelow, 0);
+  runSemiNCA(Level);
+  reattachExistingSubtree(PrevIDomSubTree);
+}
+
+template <class NodeT>
+void DomTreeIncrementalUpdater<NodeT>::deleteUnreachable(TreeNode *ToTN) {
+  // The subtree rooted at To becomes unreachable. Collect the nodes outside
+  // of it that it had edges to: their dominators may change.
+  SmallVector<NodeT *, 16> AffectedQueue;
+  const unsigned Level = ToTN->getLevel();
+  auto DescendAndCollect = [&](NodeT *, NodeT *Dst) {
+    TreeNode *TN = DT.getNode(Dst);
+    assert(TN);
+    if (TN->getLevel() > Level)
+      return true;
+    if (std::find(AffectedQueue.begin(), AffectedQueue.end(), Dst) ==
+        AffectedQueue.end())
+      AffectedQueue.push_back(Dst);
+    return false;
+  };
+
+  clearSemiNCA();
+  unsigned LastDFSNum = runDFS(ToTN->getBlock(), 0, DescendAndCollect, 0);
+
+  // Identify the top of the subtree to rebuild by finding the NCD of all the
+  // affected nodes.
+  TreeNode *MinNode = ToTN;
+  for (NodeT *N : AffectedQueue) {
+    TreeNode *TN = DT.getNode(N);
+    TreeNode *NCD = getNCD(TN, ToTN);
+    if (NCD != TN && NCD->getLevel() < MinNode->getLevel())
+      MinNode = NCD;
+  }
+
+  // The root was reached; rebuild the whole tree.
+  if (!MinNode->getIDom()) {
+    recalculateFromScratch();
+    return;
+  }
+
+  // Erase the unreachable subtree in reverse preorder, so that all the
+  // children are erased before their parent.
+  for (unsigned i = LastDFSNum; i > 0; --i)
+    DT.eraseNode(NumToNode[i]);
+
+  // The affected subtree started at To -- there is nothing left to do.
+  if (MinNode == ToTN)
+    return;
+
+  const unsigned MinLevel = MinNode->getLevel();
+  TreeNode *PrevIDom = MinNode->getIDom();
+  auto DescendBelow = [&](NodeT *, NodeT *Dst) {
+    TreeNode *TN = DT.getNode(Dst);
+    return TN && TN->getLevel() > MinLevel;
+  };
+
+  clearSemiNCA();
+  runDFS(MinNode->getBlock(), 0, DescendBelow, 0);
+  runSemiNCA(MinLevel);
+  reattachExistingSubtree(PrevIDom);
+}
+
+template <class NodeT>
+template <typename DescendCondition>
+unsigned DomTreeIncrementalUpdater<NodeT>::runDFS(NodeT *V, unsigned LastNum,
+                                                  DescendCondition Condition,
+                                                  unsigned AttachToNum) {
+  assert(V);
+  SmallVector<NodeT *, 64> WorkList;
+  SmallVector<NodeT *, 8> Successors;
+  WorkList.push_back(V);
+  if (NodeToInfo.count(V) != 0)
+    NodeToInfo[V].Parent = AttachToNum;
+
+  while (!WorkList.empty()) {
+    NodeT *BB = WorkList.pop_back_val();
+    InfoRec &BBInfo = NodeToInfo[BB];
+
+    // Visited nodes always have positive DFS numbers.
+    if (BBInfo.DFSNum != 0)
+      continue;
+    BBInfo.DFSNum = BBInfo.Semi = ++LastNum;
+    BBInfo.Label = BB;
+    NumToNode.push_back(BB);
+
+    getChildren<false>(BB, Successors);
+    for (NodeT *Succ : Successors) {
+      auto SIT = NodeToInfo.find(Succ);
+      // Don't visit nodes more than once, but remember the reverse edges.
+      if (SIT != NodeToInfo.end() && SIT->second.DFSNum != 0) {
+        if (Succ != BB)
+          SIT->second.ReverseChildren.push_back(BB);
+        continue;
+      }
+
+      if (!Condition(BB, Succ))
+        continue;
+
+      // The most recent push of Succ is the one that gets visited first, so
+      // it determines the spanning tree parent.
+      InfoRec &SuccInfo = NodeToInfo[Succ];
+      WorkList.push_back(Succ);
+      SuccInfo.Parent = LastNum;
+      SuccInfo.ReverseChildren.push_back(BB);
+    }
+  }
+
+  return LastNum;
+}
+
+template <class NodeT>
+NodeT *DomTreeIncrementalUpdater<NodeT>::eval(NodeT *VIn,
+                                              unsigned LastLinked) {
+  InfoRec &VInInfo = NodeToInfo[VIn];
+  if (VInInfo.DFSNum < LastLinked)
+    return VIn;
+
+  SmallVector<NodeT *, 32> Work;
+  SmallPtrSet<NodeT *, 32> Visited;
+
+  if (VInInfo.Parent >= LastLinked)
+    Work.push_back(VIn);
+
+  while (!Work.empty()) {
+    NodeT *V = Work.back();
+    InfoRec &VInfo = NodeToInfo[V];
+    NodeT *VAncestor = NumToNode[VInfo.Parent];
+
+    // Process the ancestor first.
+    if (Visited.insert(VAncestor).second && VInfo.Parent >= LastLinked) {
+      Work.push_back(VAncestor);
+      continue;
+    }
+    Work.pop_back();
+
+    // Update VInfo based on the ancestor info.
+    if (VInfo.Parent < LastLinked)
+      continue;
+
+    InfoRec &VAInfo = NodeToInfo[VAncestor];
+    NodeT *VAncestorLabel = VAInfo.Label;
+    NodeT *VLabel = VInfo.Label;
+    if (NodeToInfo[VAncestorLabel].Semi < NodeToInfo[VLabel].Semi)
+      VInfo.Label = VAncestorLabel;
+    VInfo.Parent = VAInfo.Parent;
+  }
+
+  return VInInfo.Label;
+}
+
+template <class NodeT>
+void DomTreeIncrementalUpdater<NodeT>::runSemiNCA(unsigned MinLevel) {
+  const unsigned NextDFSNum = NumToNode.size();
+
+  // Initialize the IDoms to the spanning tree parents.
+  for (unsigned i = 1; i < NextDFSNum; ++i) {
+    InfoRec &VInfo = NodeToInfo[NumToNode[i]];
+    VInfo.IDom = NumToNode[VInfo.Parent];
+  }
+
+  // Step #1: Calculate the semidominators of all vertices.
+  for (unsigned i = NextDFSNum - 1; i >= 2; --i) {
+    NodeT *W = NumToNode[i];
+    // Initialize the semi dominator to point to the parent node.
+    unsigned WSemi = NodeToInfo[W].Parent;
+    SmallVector<NodeT *, 2> ReverseChildren = NodeToInfo[W].ReverseChildren;
+    for (NodeT *N : ReverseChildren) {
+      if (NodeToInfo.count(N) == 0) // Skip unreachable predecessors.
+        continue;
+
+      // Skip predecessors whose level is above the subtree being processed.
+      TreeNode *TN = DT.getNode(N);
+      if (TN && TN->getLevel() < MinLevel)
+        continue;
+
+      unsigned SemiU = NodeToInfo[eval(N, i + 1)].Semi;
+      if (SemiU < WSemi)
+        WSemi = SemiU;
+    }
+    NodeToInfo[W].Semi = WSemi;
+  }
+
+  // Step #2: Explicitly define the immediate dominator of each vertex:
+  //          IDom[i] = NCA(SDom[i], SpanningTreeParent(i)).
+  // The parents were stored in the IDoms above, as they got invalidated by
+  // the path compression in eval.
+  for (unsigned i = 2; i < NextDFSNum; ++i) {
+    NodeT *W = NumToNode[i];
+    InfoRec &WInfo = NodeToInfo[W];
+    const unsigned SDomNum = NodeToInfo[NumToNode[WInfo.Semi]].DFSNum;
+    NodeT *WIDomCandidate = WInfo.IDom;
+    while (NodeToInfo[WIDomCandidate].DFSNum > SDomNum)
+      WIDomCandidate = NodeToInfo[WIDomCandidate].IDom;
+    WInfo.IDom = WIDomCandidate;
+  }
+}
+
+template <class NodeT>
+void DomTreeIncrementalUpdater<NodeT>::attachNewSubtree(TreeNode *AttachTo) {
+  // Attach the first unreachable block to AttachTo.
+  NodeToInfo[NumToNode[1]].IDom = AttachTo->getBlock();
+  // Loop over all of the discovered blocks, in DFS preorder so that the
+  // immediate dominator of a block always has a node already.
+  for (size_t i = 1, e = NumToNode.size(); i != e; ++i) {
+    NodeT *W = NumToNode[i];
+    if (DT.getNode(W))
+      continue;
+
+    TreeNode *IDomNode = DT.getNode(NodeToInfo[W].IDom);
+    assert(IDomNode && "Immediate dominator not attached yet?");
+    DT.DomTreeNodes[W] =
+        IDomNode->addChild(llvm::make_unique<TreeNode>(W, IDomNode));
+  }
+}
+
+template <class NodeT>
+void DomTreeIncrementalUpdater<NodeT>::reattachExistingSubtree(
+    TreeNode *AttachTo) {
+  NodeToInfo[NumToNode[1]].IDom = AttachTo->getBlock();
+  for (size_t i = 1, e = NumToNode.size(); i != e; ++i) {
+    NodeT *N = NumToNode[i];
+    TreeNode *TN = DT.getNode(N);
+    assert(TN);
+    TN->setIDom(DT.getNode(NodeToInfo[N].IDom));
+  }
+}
+
+template <class NodeT>
+void DominatorTreeBase<NodeT>::applyUpdates(ArrayRef<UpdateType> Updates) {
+  if (Updates.empty())
+    return;
+
+  DFSInfoValid = false;
+  if (this->IsPostDominators || !RootNode) {
+    // FIXME: Update post-dominator trees incrementally as well. Their virtual
+    // root and changing set of exit blocks make the forward algorithms not
+    // directly applicable.
+    if (NodeT *BB = getAnyBlock())
+      recalculate(*BB->getParent());
+    return;
+  }
+
+  DomTreeIncrementalUpdater<NodeT>(*this).applyUpdates(Updates);
+
+#ifdef XDEBUG
+  assert(verify() && "Incrementally updated dominator tree is incorrect!");
+#endif
+}
+
+template <class NodeT> bool DominatorTreeBase<NodeT>::verify() const {
+  NodeT *BB = getAnyBlock();
+  if (!BB)
+    return DomTreeNodes.empty();
+
+  DominatorTreeBase<NodeT> Fresh(this->IsPostDominators);
+  Fresh.recalculate(*BB->getParent());
+  if (compare(Fresh))
+    return false;
+
+  for (const auto &Entry : DomTreeNodes) {
+    const DomTreeNodeBase<NodeT> *TN = Entry.second.get();
+    if (!TN)
+      continue;
+    const DomTreeNodeBase<NodeT> *IDom = TN->getIDom();
+    if (TN->getLevel() != (IDom ? IDom->getLevel() + 1 : 0))
+      return false;
+  }
+  return true;
+}
+
 }
 
 #endif
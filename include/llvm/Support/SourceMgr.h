@@ -49,13 +49,34 @@ private:
     /// The memory buffer for the file.
     std::unique_ptr<MemoryBuffer> Buffer;
 
+    /// Lazily built table of the offsets of every '\n' in the buffer, used to
+    /// answer line number queries with a binary search. The element type is
+    /// the narrowest of uint16_t, uint32_t and uint64_t that can hold an
+    /// offset into the buffer, so this is a std::vector of one of those.
+    mutable void *OffsetCache;
+
     /// This is the location of the parent include, or null if at the top level.
     SMLoc IncludeLoc;
 
-    SrcBuffer() {}
+    SrcBuffer() : OffsetCache(nullptr) {}
 
     SrcBuffer(SrcBuffer &&O)
-        : Buffer(std::move(O.Buffer)), IncludeLoc(O.IncludeLoc) {}
+        : Buffer(std::move(O.Buffer)), OffsetCache(O.OffsetCache),
+          IncludeLoc(O.IncludeLoc) {
+      O.OffsetCache = nullptr;
+    }
+
+    ~SrcBuffer();
+
+    /// Return the 1-based line number of \p Ptr, which must point into (or
+    /// one past the end of) this buffer.
+    unsigned getLineNumber(const char *Ptr) const;
+
+  private:
+    template <typename T> unsigned getLineNumberImpl(const char *Ptr) const;
+
+    SrcBuffer(const SrcBuffer &) = delete;
+    void operator=(const SrcBuffer &) = delete;
   };
 
   /// This is all of the buffers that we are reading from.
@@ -64,10 +85,6 @@ private:
   // This is the list of directories we should search for include files in.
   std::vector<std::string> IncludeDirectories;
 
-  /// This is a cache for line number queries, its implementation is really
-  /// private to SourceMgr.cpp.
-  mutable void *LineNoCache;
-
   DiagHandlerTy DiagHandler;
   void *DiagContext;
 
@@ -76,9 +93,7 @@ private:
   SourceMgr(const SourceMgr&) = delete;
   void operator=(const SourceMgr&) = delete;
 public:
-  SourceMgr()
-    : LineNoCache(nullptr), DiagHandler(nullptr), DiagContext(nullptr) {}
-  ~SourceMgr();
+  SourceMgr() : DiagHandler(nullptr), DiagContext(nullptr) {}
 
   void setIncludeDirs(const std::vector<std::string> &Dirs) {
     IncludeDirectories = Dirs;
@@ -144,13 +159,14 @@ public:
   unsigned FindBufferContainingLoc(SMLoc Loc) const;
 
   /// Find the line number for the specified location in the specified file.
-  /// This is not a fast method.
+  /// The first query against a buffer indexes all of its lines; later queries
+  /// are a binary search, in any order.
   unsigned FindLineNumber(SMLoc Loc, unsigned BufferID = 0) const {
     return getLineAndColumn(Loc, BufferID).first;
   }
 
   /// Find the line and column number for the specified location in the
-  /// specified file. This is not a fast method.
+  /// specified file.
   std::pair<unsigned, unsigned> getLineAndColumn(SMLoc Loc,
                                                  unsigned BufferID = 0) const;
 
@@ -17,6 +17,7 @@
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/DataTypes.h"
+#include <memory>
 #include <system_error>
 
 namespace llvm {
@@ -358,9 +359,18 @@ class raw_fd_ostream : public raw_pwrite_stream {
 
   bool SupportsSeeking;
 
+  /// Hands filled buffers to a writer thread, if asynchronous writes are
+  /// enabled.
+  class AsyncWriter;
+  std::unique_ptr<AsyncWriter> Async;
+
   /// See raw_ostream::write_impl.
   void write_impl(const char *Ptr, size_t Size) override;
 
+  /// Wait until the writer thread has written everything handed to it, and
+  /// note any error it encountered.
+  void waitForAsyncWrites();
+
   void pwrite_impl(const char *Ptr, size_t Size, uint64_t Offset) override;
 
   /// Return the current position within the stream, not counting the bytes
@@ -399,6 +409,20 @@ public:
 
   bool supportsSeeking() { return SupportsSeeking; }
 
+  /// Write to the file from a separate thread, so that the producer can fill
+  /// the next buffer while the previous one is being written. At most
+  /// \p NumBuffers buffers of \p BufferSize bytes are in use at any time;
+  /// when all of them are waiting to be written, the producer blocks.
+  ///
+  /// This is only done for regular files. Pipes, terminals, unbuffered and
+  /// atomic-write streams, and builds without threads keep writing
+  /// synchronously, and false is returned.
+  ///
+  /// In asynchronous mode flush() only queues the buffer. Errors are
+  /// reported by has_error() once seek() or close() has been called, or the
+  /// stream is destroyed.
+  bool enableAsyncWrites(size_t BufferSize = 1 << 20, unsigned NumBuffers = 2);
+
   /// Flushes the stream and repositions the underlying file descriptor position
   /// to the offset specified from the beginning of the file.
   uint64_t seek(uint64_t off);
@@ -70,6 +70,13 @@ ModulePass *createGlobalOptimizerPass();
 ///
 ModulePass *createGlobalDCEPass();
 
+//===----------------------------------------------------------------------===//
+/// createGlobalReorderPass - This pass reorders global variables so that the
+/// ones accessed together are laid out next to each other, hottest first, and
+/// the ones never accessed on a warm path are laid out last.
+///
+ModulePass *createGlobalReorderPass();
+
 //===----------------------------------------------------------------------===//
 /// This transform is designed to eliminate available external globals
 /// (functions or global variables)
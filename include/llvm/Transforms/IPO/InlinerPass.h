@@ -17,12 +17,14 @@
 #ifndef LLVM_TRANSFORMS_IPO_INLINERPASS_H
 #define LLVM_TRANSFORMS_IPO_INLINERPASS_H
 
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/Analysis/CallGraphSCCPass.h"
+#include "llvm/Analysis/InlineCost.h"
 
 namespace llvm {
   class CallSite;
   class DataLayout;
-  class InlineCost;
   template<class PtrType, unsigned SmallSize>
   class SmallPtrSet;
 
@@ -81,6 +83,34 @@ private:
   // InsertLifetime - Insert @llvm.lifetime intrinsics.
   bool InsertLifetime;
 
+  /// A getInlineCost result remembered for one shape of call site: the
+  /// argument pattern the cost analysis keys on, plus the versions of the
+  /// caller and callee bodies it was computed against.
+  struct CachedInlineCost {
+    SmallVector<uintptr_t, 8> ArgPattern;
+    unsigned CallerVersion;
+    unsigned CalleeVersion;
+    InlineCost Cost;
+  };
+
+  // InlineCostCache - Memoized inline costs, indexed by (caller, callee).
+  // Only valid for the duration of a single runOnSCC invocation.
+  DenseMap<std::pair<Function *, Function *>,
+           SmallVector<CachedInlineCost, 1> > InlineCostCache;
+
+  // FunctionVersions - Bumped whenever a function's body or use list is
+  // changed by inlining, which makes its cached inline costs stale.
+  DenseMap<Function *, unsigned> FunctionVersions;
+
+  /// getCachedInlineCost - Return getInlineCost(CS), reusing an earlier
+  /// result for an identical call site shape when neither the caller nor the
+  /// callee has changed since.
+  InlineCost getCachedInlineCost(CallSite CS);
+
+  /// invalidateInlineCosts - Forget the cached inline costs computed with F
+  /// as either the caller or the callee.
+  void invalidateInlineCosts(Function *F) { ++FunctionVersions[F]; }
+
   /// shouldInline - Return true if the inliner should attempt to
   /// inline at the given CallSite.
   bool shouldInline(CallSite CS);
@@ -11,6 +11,7 @@
 #define LLVM_TRANSFORMS_INSTCOMBINE_INSTCOMBINEWORKLIST_H
 
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/IR/Instruction.h"
 #include "llvm/Support/Compiler.h"
@@ -27,6 +28,11 @@ class InstCombineWorklist {
   SmallVector<Instruction*, 256> Worklist;
   DenseMap<Instruction*, unsigned> WorklistMap;
 
+  /// Instructions added since the last call to startTracking, i.e. every
+  /// instruction that was changed or created, or used or fed a value that was.
+  SmallPtrSet<Instruction*, 16> Touched;
+  bool Tracking = false;
+
   void operator=(const InstCombineWorklist&RHS) = delete;
   InstCombineWorklist(const InstCombineWorklist&) = delete;
 public:
@@ -34,10 +40,13 @@ public:
 
   InstCombineWorklist(InstCombineWorklist &&Arg)
       : Worklist(std::move(Arg.Worklist)),
-        WorklistMap(std::move(Arg.WorklistMap)) {}
+        WorklistMap(std::move(Arg.WorklistMap)),
+        Touched(std::move(Arg.Touched)), Tracking(Arg.Tracking) {}
   InstCombineWorklist &operator=(InstCombineWorklist &&RHS) {
     Worklist = std::move(RHS.Worklist);
     WorklistMap = std::move(RHS.WorklistMap);
+    Touched = std::move(RHS.Touched);
+    Tracking = RHS.Tracking;
     return *this;
   }
 
@@ -50,6 +59,8 @@ public:
       DEBUG(dbgs() << "IC: ADD: " << *I << '\n');
       Worklist.push_back(I);
     }
+    if (Tracking)
+      Touched.insert(I);
   }
 
   void AddValue(Value *V) {
@@ -74,6 +85,7 @@ public:
 
   // Remove - remove I from the worklist if it exists.
   void Remove(Instruction *I) {
+    Touched.erase(I);
     DenseMap<Instruction*, unsigned>::iterator It = WorklistMap.find(I);
     if (It == WorklistMap.end()) return; // Not in worklist.
 
@@ -99,6 +111,20 @@ public:
   }
 
 
+  /// startTracking - Forget the previously touched instructions and start
+  /// recording every instruction added through Add from now on.
+  void startTracking() {
+    Touched.clear();
+    Tracking = true;
+  }
+
+  /// stopTracking - Stop recording added instructions.  The set recorded so
+  /// far stays available through isTouched until the next startTracking.
+  void stopTracking() { Tracking = false; }
+
+  /// isTouched - Return true if I was added to the worklist while tracking.
+  bool isTouched(Instruction *I) const { return Touched.count(I); }
+
   /// Zap - check that the worklist is empty and nuke the backing store for
   /// the map if it is large.
   void Zap() {
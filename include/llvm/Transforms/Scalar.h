@@ -333,6 +333,13 @@ FunctionPass *createEarlyCSEPass();
 //
 FunctionPass *createMergedLoadStoreMotionPass();
 
+//===----------------------------------------------------------------------===//
+//
+// GVNHoistSink - This pass merges equivalent instructions on both sides of a
+// branch, hoisting them above it or sinking them below the join.
+//
+FunctionPass *createGVNHoistSinkPass();
+
 //===----------------------------------------------------------------------===//
 //
 // GVN - This pass performs global value numbering and redundant load
@@ -486,6 +493,19 @@ FunctionPass *createNaryReassociatePass();
 //
 FunctionPass *createLoopDistributePass();
 
+//===----------------------------------------------------------------------===//
+//
+// LoopVersioningLICM - Version loops with run-time alias checks so that LICM
+// can hoist invariant loads out of the checked copy.
+//
+FunctionPass *createLoopVersioningLICMPass();
+
+//===----------------------------------------------------------------------===//
+//
+// LoopFusion - Fuse adjacent loops that run over the same iteration space.
+//
+FunctionPass *createLoopFusionPass();
+
 } // End llvm namespace
 
 #endif
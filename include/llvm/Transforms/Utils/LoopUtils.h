@@ -32,6 +32,7 @@ class Pass;
 class PredIteratorCache;
 class ScalarEvolution;
 class TargetLibraryInfo;
+class TargetTransformInfo;
 
 /// \brief Captures loop safety information.
 /// It keep information for loop & its header may throw exception.
@@ -245,13 +246,16 @@ bool hoistRegion(DomTreeNode *, AliasAnalysis *, LoopInfo *, DominatorTree *,
 /// the stores in the loop, looking for stores to Must pointers which are 
 /// loop invariant. It takes AliasSet, Loop exit blocks vector, loop exit blocks
 /// insertion point vector, PredIteratorCache, LoopInfo, DominatorTree, Loop,
-/// AliasSet information for all instructions of the loop and loop safety 
-/// information as arguments. It returns changed status.
+/// AliasSet information for all instructions of the loop, loop safety
+/// information and TargetTransformInfo as arguments. If TargetTransformInfo is
+/// null, stores that are not guaranteed to execute are never promoted with a
+/// guard flag. It returns changed status.
 bool promoteLoopAccessesToScalars(AliasSet &, SmallVectorImpl<BasicBlock*> &,
                                   SmallVectorImpl<Instruction*> &,
                                   PredIteratorCache &, LoopInfo *,
                                   DominatorTree *, Loop *, AliasSetTracker *,
-                                  LICMSafetyInfo *);
+                                  LICMSafetyInfo *,
+                                  const TargetTransformInfo *);
 
 /// \brief Computes safety information for a loop
 /// checks loop body & header for the possiblity of may throw
@@ -95,6 +95,9 @@ private:
   LoopInfo *LI;
   DominatorTree *DT;
 };
+
+/// \brief Returns the instructions that use values defined in the loop.
+SmallVector<Instruction *, 8> findDefsUsedOutsideOfLoop(Loop *L);
 }
 
 #endif
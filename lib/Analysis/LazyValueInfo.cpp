@@ -15,6 +15,8 @@
 #include "llvm/Analysis/LazyValueInfo.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SparseBitVector.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/AssumptionCache.h"
 #include "llvm/Analysis/ConstantFolding.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
@@ -28,8 +30,10 @@
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/PatternMatch.h"
 #include "llvm/IR/ValueHandle.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 #include <map>
 #include <stack>
 using namespace llvm;
@@ -37,6 +41,17 @@ using namespace PatternMatch;
 
 #define DEBUG_TYPE "lazy-value-info"
 
+STATISTIC(NumCacheEvictions, "Number of values evicted from the LVI cache");
+STATISTIC(NumOverdefinedBits,
+          "Number of overdefined results stored as single bits");
+STATISTIC(MaxCacheEntries, "Largest number of entries held by an LVI cache");
+
+static cl::opt<unsigned>
+CacheEntryLimit("lvi-cache-entry-limit", cl::init(500000), cl::Hidden,
+                cl::desc("Number of (value, block) results LazyValueInfo keeps "
+                         "per function before evicting the least recently "
+                         "used values"));
+
 char LazyValueInfo::ID = 0;
 INITIALIZE_PASS_BEGIN(LazyValueInfo, "lazy-value-info",
                 "Lazy Value Information Analysis", false, true)
@@ -313,23 +328,39 @@ namespace {
   /// maintains information about queries across the clients' queries.
   class LazyValueInfoCache {
     /// This is all of the cached block information for exactly one Value*.
-    /// The entries are sorted by the BasicBlock* of the
-    /// entries, allowing us to do a lookup with a binary search.
-    typedef std::map<AssertingVH<BasicBlock>, LVILatticeVal> ValueCacheEntryTy;
+    struct ValueCacheEntryTy {
+      /// Results that are not overdefined, sorted by the BasicBlock* of the
+      /// entries, allowing us to do a lookup with a binary search.
+      std::map<AssertingVH<BasicBlock>, LVILatticeVal> BlockVals;
+
+      /// The numbers of the blocks at whose end the value is overdefined.
+      /// This is by far the most common result, so it only costs one bit.
+      /// It is also what cache updating needs to look at.
+      SparseBitVector<> OverDefined;
+
+      /// The query that last used this entry, for LRU eviction.
+      unsigned LastUse;
+
+      ValueCacheEntryTy() : LastUse(0) {}
+
+      unsigned size() { return BlockVals.size() + OverDefined.count(); }
+    };
 
     /// This is all of the cached information for all values,
     /// mapped from Value* to key information.
     std::map<LVIValueHandle, ValueCacheEntryTy> ValueCache;
-    
-    /// This tracks, on a per-block basis, the set of values that are
-    /// over-defined at the end of that block.  This is required
-    /// for cache updating.
-    typedef std::pair<AssertingVH<BasicBlock>, Value*> OverDefinedPairTy;
-    DenseSet<OverDefinedPairTy> OverDefinedCache;
 
     /// Keep track of all blocks that we have ever seen, so we
     /// don't spend time removing unused blocks from our caches.
-    DenseSet<AssertingVH<BasicBlock> > SeenBlocks;
+    /// Each one is given a number to index the OverDefined bit vectors.
+    DenseMap<AssertingVH<BasicBlock>, unsigned> SeenBlocks;
+    unsigned NextBlockNumber;
+
+    /// The number of results held in ValueCache, overdefined ones included.
+    unsigned NumCachedEntries;
+
+    /// Incremented for every top level query, to order entries by last use.
+    unsigned CurrentQuery;
 
     /// This stack holds the state of the value solver during a query.
     /// It basically emulates the callstack of the naive
@@ -355,11 +386,29 @@ namespace {
 
     friend struct LVIValueHandle;
 
+    unsigned getBlockNumber(BasicBlock *BB) {
+      auto I = SeenBlocks.insert(std::make_pair(BB, NextBlockNumber));
+      if (I.second)
+        ++NextBlockNumber;
+      return I.first->second;
+    }
+
     void insertResult(Value *Val, BasicBlock *BB, const LVILatticeVal &Result) {
-      SeenBlocks.insert(BB);
-      lookup(Val)[BB] = Result;
-      if (Result.isOverdefined())
-        OverDefinedCache.insert(std::make_pair(BB, Val));
+      ValueCacheEntryTy &Entry = lookup(Val);
+      if (Result.isOverdefined()) {
+        if (!Entry.OverDefined.test_and_set(getBlockNumber(BB)))
+          return;
+        ++NumOverdefinedBits;
+      } else {
+        getBlockNumber(BB);
+        auto I = Entry.BlockVals.insert(std::make_pair(BB, Result));
+        if (!I.second) {
+          I.first->second = Result;
+          return;
+        }
+      }
+      if (++NumCachedEntries > MaxCacheEntries)
+        MaxCacheEntries = NumCachedEntries;
     }
 
     LVILatticeVal getBlockValue(Value *Val, BasicBlock *BB);
@@ -382,9 +431,23 @@ namespace {
                                             Instruction *BBI);
 
     void solve();
-    
+
+    /// Drop the least recently used values until the cache is comfortably
+    /// below CacheEntryLimit.  Only called between queries, since the solver
+    /// relies on the results it has computed so far staying in the cache.
+    void evictIfOverLimit();
+
+    /// Start a new top level query.
+    void beginQuery() {
+      assert(BlockValueStack.empty() && BlockValueSet.empty());
+      evictIfOverLimit();
+      ++CurrentQuery;
+    }
+
     ValueCacheEntryTy &lookup(Value *V) {
-      return ValueCache[LVIValueHandle(V, this)];
+      ValueCacheEntryTy &Entry = ValueCache[LVIValueHandle(V, this)];
+      Entry.LastUse = CurrentQuery;
+      return Entry;
     }
 
   public:
@@ -415,47 +478,71 @@ namespace {
     void clear() {
       SeenBlocks.clear();
       ValueCache.clear();
-      OverDefinedCache.clear();
+      NumCachedEntries = 0;
     }
 
     LazyValueInfoCache(AssumptionCache *AC, const DataLayout &DL,
                        DominatorTree *DT = nullptr)
-        : AC(AC), DL(DL), DT(DT) {}
+        : NextBlockNumber(0), NumCachedEntries(0), CurrentQuery(0), AC(AC),
+          DL(DL), DT(DT) {}
   };
 } // end anonymous namespace
 
 void LVIValueHandle::deleted() {
-  typedef std::pair<AssertingVH<BasicBlock>, Value*> OverDefinedPairTy;
-  
-  SmallVector<OverDefinedPairTy, 4> ToErase;
-  for (const OverDefinedPairTy &P : Parent->OverDefinedCache)
-    if (P.second == getValPtr())
-      ToErase.push_back(P);
-  for (const OverDefinedPairTy &P : ToErase)
-    Parent->OverDefinedCache.erase(P);
-  
+  auto I = Parent->ValueCache.find(*this);
+  assert(I != Parent->ValueCache.end() && "Handle not in the cache?");
+  Parent->NumCachedEntries -= I->second.size();
+
   // This erasure deallocates *this, so it MUST happen after we're done
   // using any and all members of *this.
-  Parent->ValueCache.erase(*this);
+  Parent->ValueCache.erase(I);
 }
 
 void LazyValueInfoCache::eraseBlock(BasicBlock *BB) {
   // Shortcut if we have never seen this block.
-  DenseSet<AssertingVH<BasicBlock> >::iterator I = SeenBlocks.find(BB);
+  DenseMap<AssertingVH<BasicBlock>, unsigned>::iterator I = SeenBlocks.find(BB);
   if (I == SeenBlocks.end())
     return;
+  unsigned BBNum = I->second;
   SeenBlocks.erase(I);
 
-  SmallVector<OverDefinedPairTy, 4> ToErase;
-  for (const OverDefinedPairTy& P : OverDefinedCache)
-    if (P.first == BB)
-      ToErase.push_back(P);
-  for (const OverDefinedPairTy &P : ToErase)
-    OverDefinedCache.erase(P);
+  for (auto &VC : ValueCache) {
+    ValueCacheEntryTy &Entry = VC.second;
+    if (Entry.OverDefined.test(BBNum)) {
+      Entry.OverDefined.reset(BBNum);
+      --NumCachedEntries;
+    }
+    NumCachedEntries -= Entry.BlockVals.erase(BB);
+  }
+}
 
-  for (std::map<LVIValueHandle, ValueCacheEntryTy>::iterator
-       I = ValueCache.begin(), E = ValueCache.end(); I != E; ++I)
-    I->second.erase(BB);
+void LazyValueInfoCache::evictIfOverLimit() {
+  if (NumCachedEntries <= CacheEntryLimit)
+    return;
+
+  // Evict down to three quarters of the limit so the sort is amortized over
+  // a good number of queries.
+  unsigned Target = CacheEntryLimit - CacheEntryLimit / 4;
+  typedef std::map<LVIValueHandle, ValueCacheEntryTy>::iterator CacheIt;
+  std::vector<std::pair<unsigned, CacheIt>> ByAge;
+  ByAge.reserve(ValueCache.size());
+  for (CacheIt I = ValueCache.begin(), E = ValueCache.end(); I != E; ++I)
+    ByAge.push_back(std::make_pair(I->second.LastUse, I));
+  std::sort(ByAge.begin(), ByAge.end(),
+            [](const std::pair<unsigned, CacheIt> &LHS,
+               const std::pair<unsigned, CacheIt> &RHS) {
+    return LHS.first < RHS.first;
+  });
+
+  for (auto &P : ByAge) {
+    if (NumCachedEntries <= Target)
+      break;
+    NumCachedEntries -= P.second->second.size();
+    ValueCache.erase(P.second);
+    ++NumCacheEvictions;
+  }
+  DEBUG(dbgs() << "LVI evicted values, " << NumCachedEntries
+               << " results left in the cache\n");
 }
 
 void LazyValueInfoCache::solve() {
@@ -466,7 +553,7 @@ void LazyValueInfoCache::solve() {
     if (solveBlockValue(e.second, e.first)) {
       // The work item was completely processed.
       assert(BlockValueStack.top() == e && "Nothing should have been pushed!");
-      assert(lookup(e.second).count(e.first) && "Result should be in cache!");
+      assert(hasBlockValue(e.second, e.first) && "Result should be in cache!");
 
       BlockValueStack.pop();
       BlockValueSet.erase(e);
@@ -486,7 +573,10 @@ bool LazyValueInfoCache::hasBlockValue(Value *Val, BasicBlock *BB) {
   std::map<LVIValueHandle, ValueCacheEntryTy>::iterator I =
     ValueCache.find(ValHandle);
   if (I == ValueCache.end()) return false;
-  return I->second.count(BB);
+  if (I->second.BlockVals.count(BB))
+    return true;
+  DenseMap<AssertingVH<BasicBlock>, unsigned>::iterator BI = SeenBlocks.find(BB);
+  return BI != SeenBlocks.end() && I->second.OverDefined.test(BI->second);
 }
 
 LVILatticeVal LazyValueInfoCache::getBlockValue(Value *Val, BasicBlock *BB) {
@@ -494,22 +584,25 @@ LVILatticeVal LazyValueInfoCache::getBlockValue(Value *Val, BasicBlock *BB) {
   if (Constant *VC = dyn_cast<Constant>(Val))
     return LVILatticeVal::get(VC);
 
-  SeenBlocks.insert(BB);
-  return lookup(Val)[BB];
+  ValueCacheEntryTy &Entry = lookup(Val);
+  auto I = Entry.BlockVals.find(BB);
+  if (I != Entry.BlockVals.end())
+    return I->second;
+
+  LVILatticeVal Result;
+  if (Entry.OverDefined.test(getBlockNumber(BB)))
+    Result.markOverdefined();
+  return Result;
 }
 
 bool LazyValueInfoCache::solveBlockValue(Value *Val, BasicBlock *BB) {
   if (isa<Constant>(Val))
     return true;
 
-  if (lookup(Val).count(BB)) {
+  if (hasBlockValue(Val, BB)) {
     // If we have a cached value, use that.
     DEBUG(dbgs() << "  reuse BB '" << BB->getName()
-                 << "' val=" << lookup(Val)[BB] << '\n');
-
-    // Since we're reusing a cached value, we don't need to update the
-    // OverDefinedCache. The cache will have been properly updated whenever the
-    // cached value was inserted.
+                 << "' val=" << getBlockValue(Val, BB) << '\n');
     return true;
   }
 
@@ -998,7 +1091,7 @@ LVILatticeVal LazyValueInfoCache::getValueInBlock(Value *V, BasicBlock *BB,
   DEBUG(dbgs() << "LVI Getting block end value " << *V << " at '"
         << BB->getName() << "'\n");
   
-  assert(BlockValueStack.empty() && BlockValueSet.empty());
+  beginQuery();
   pushBlockValue(std::make_pair(BB, V));
 
   solve();
@@ -1025,7 +1118,8 @@ getValueOnEdge(Value *V, BasicBlock *FromBB, BasicBlock *ToBB,
                Instruction *CxtI) {
   DEBUG(dbgs() << "LVI Getting edge value " << *V << " from '"
         << FromBB->getName() << "' to '" << ToBB->getName() << "'\n");
-  
+
+  beginQuery();
   LVILatticeVal Result;
   if (!getEdgeValue(V, FromBB, ToBB, Result, CxtI)) {
     solve();
@@ -1050,13 +1144,18 @@ void LazyValueInfoCache::threadEdge(BasicBlock *PredBB, BasicBlock *OldSucc,
   // for all values that were marked overdefined in OldSucc, and for those same
   // values in any successor of OldSucc (except NewSucc) in which they were
   // also marked overdefined.
+  DenseMap<AssertingVH<BasicBlock>, unsigned>::iterator OI =
+    SeenBlocks.find(OldSucc);
+  if (OI == SeenBlocks.end())
+    return;
+
   std::vector<BasicBlock*> worklist;
   worklist.push_back(OldSucc);
-  
-  DenseSet<Value*> ClearSet;
-  for (OverDefinedPairTy &P : OverDefinedCache)
-    if (P.first == OldSucc)
-      ClearSet.insert(P.second);
+
+  SmallVector<ValueCacheEntryTy *, 16> ClearSet;
+  for (auto &VC : ValueCache)
+    if (VC.second.OverDefined.test(OI->second))
+      ClearSet.push_back(&VC.second);
   
   // Use a worklist to perform a depth-first search of OldSucc's successors.
   // NOTE: We do not need a visited list since any blocks we have already
@@ -1069,20 +1168,18 @@ void LazyValueInfoCache::threadEdge(BasicBlock *PredBB, BasicBlock *OldSucc,
     // Skip blocks only accessible through NewSucc.
     if (ToUpdate == NewSucc) continue;
     
+    DenseMap<AssertingVH<BasicBlock>, unsigned>::iterator BI =
+      SeenBlocks.find(ToUpdate);
+    if (BI == SeenBlocks.end()) continue;
+
     bool changed = false;
-    for (Value *V : ClearSet) {
+    for (ValueCacheEntryTy *Entry : ClearSet) {
       // If a value was marked overdefined in OldSucc, and is here too...
-      DenseSet<OverDefinedPairTy>::iterator OI =
-        OverDefinedCache.find(std::make_pair(ToUpdate, V));
-      if (OI == OverDefinedCache.end()) continue;
-
-      // Remove it from the caches.
-      ValueCacheEntryTy &Entry = ValueCache[LVIValueHandle(V, this)];
-      ValueCacheEntryTy::iterator CI = Entry.find(ToUpdate);
+      if (!Entry->OverDefined.test(BI->second)) continue;
 
-      assert(CI != Entry.end() && "Couldn't find entry to update?");
-      Entry.erase(CI);
-      OverDefinedCache.erase(OI);
+      // Remove it from the cache.
+      Entry->OverDefined.reset(BI->second);
+      --NumCachedEntries;
 
       // If we removed anything, then we potentially need to update 
       // blocks successors too.
@@ -87,6 +87,7 @@
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/MathExtras.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 using namespace llvm;
@@ -101,6 +102,12 @@ STATISTIC(NumTripCountsNotComputed,
           "Number of loops without predictable loop counts");
 STATISTIC(NumBruteForceTripCountsComputed,
           "Number of loops with trip counts computed by force");
+STATISTIC(NumSCEVsCreated, "Number of values analyzed by createSCEV");
+STATISTIC(NumValueDepthExceeded,
+          "Number of values left unknown because of the depth budget");
+STATISTIC(NumArithOpsExceeded,
+          "Number of add/mul expressions built without folding because of "
+          "the operand budget");
 
 static cl::opt<unsigned>
 MaxBruteForceIterations("scalar-evolution-max-iterations", cl::ReallyHidden,
@@ -109,6 +116,23 @@ MaxBruteForceIterations("scalar-evolution-max-iterations", cl::ReallyHidden,
                                  "derived loop"),
                         cl::init(100));
 
+static cl::opt<unsigned>
+MaxValueDepth("scalar-evolution-max-value-depth", cl::Hidden,
+              cl::desc("Maximum recursion depth when building SCEVs for "
+                       "values; deeper values are treated as unknown"),
+              cl::init(500));
+
+static cl::opt<unsigned>
+MaxArithOperands("scalar-evolution-max-arith-operands", cl::Hidden,
+                 cl::desc("Maximum number of operands of an add or mul that "
+                          "SCEV tries to simplify"),
+                 cl::init(64));
+
+static cl::opt<bool>
+TimeQueries("scalar-evolution-time-queries", cl::Hidden,
+            cl::desc("Time the outermost getSCEV and backedge-taken count "
+                     "queries"));
+
 // FIXME: Enable this with XDEBUG when the test suite is clean.
 static cl::opt<bool>
 VerifySCEV("verify-scev",
@@ -2008,6 +2032,13 @@ const SCEV *ScalarEvolution::getAddExpr(SmallVectorImpl<const SCEV *> &Ops,
     if (Ops.size() == 1) return Ops[0];
   }
 
+  // Everything below is at least quadratic in the number of operands.  Huge
+  // sums are kept as they are.
+  if (Ops.size() > MaxArithOperands) {
+    ++NumArithOpsExceeded;
+    return getOrCreateAddExpr(Ops, Flags);
+  }
+
   // Okay, check to see if the same value occurs in the operand list more than
   // once.  If so, merge them together into an multiply expression.  Since we
   // sorted the list, these values are required to be adjacent.
@@ -2303,8 +2334,14 @@ const SCEV *ScalarEvolution::getAddExpr(SmallVectorImpl<const SCEV *> &Ops,
     // next one.
   }
 
-  // Okay, it looks like we really DO need an add expr.  Check to see if we
-  // already have one, otherwise create a new one.
+  // Okay, it looks like we really DO need an add expr.
+  return getOrCreateAddExpr(Ops, Flags);
+}
+
+const SCEV *
+ScalarEvolution::getOrCreateAddExpr(SmallVectorImpl<const SCEV *> &Ops,
+                                    SCEV::NoWrapFlags Flags) {
+  // Check to see if we already have one, otherwise create a new one.
   FoldingSetNodeID ID;
   ID.AddInteger(scAddExpr);
   for (unsigned i = 0, e = Ops.size(); i != e; ++i)
@@ -2460,6 +2497,12 @@ const SCEV *ScalarEvolution::getMulExpr(SmallVectorImpl<const SCEV *> &Ops,
       return Ops[0];
   }
 
+  // As for adds, the folding below does not scale to huge products.
+  if (Ops.size() > MaxArithOperands) {
+    ++NumArithOpsExceeded;
+    return getOrCreateMulExpr(Ops, Flags);
+  }
+
   // Skip over the add expression until we get to a multiply.
   while (Idx < Ops.size() && Ops[Idx]->getSCEVType() < scMulExpr)
     ++Idx;
@@ -2599,8 +2642,14 @@ const SCEV *ScalarEvolution::getMulExpr(SmallVectorImpl<const SCEV *> &Ops,
     // next one.
   }
 
-  // Okay, it looks like we really DO need an mul expr.  Check to see if we
-  // already have one, otherwise create a new one.
+  // Okay, it looks like we really DO need an mul expr.
+  return getOrCreateMulExpr(Ops, Flags);
+}
+
+const SCEV *
+ScalarEvolution::getOrCreateMulExpr(SmallVectorImpl<const SCEV *> &Ops,
+                                    SCEV::NoWrapFlags Flags) {
+  // Check to see if we already have one, otherwise create a new one.
   FoldingSetNodeID ID;
   ID.AddInteger(scMulExpr);
   for (unsigned i = 0, e = Ops.size(); i != e; ++i)
@@ -3323,7 +3372,28 @@ const SCEV *ScalarEvolution::getSCEV(Value *V) {
     else
       ValueExprMap.erase(I);
   }
-  const SCEV *S = createSCEV(V);
+
+  if (CreateSCEVDepth >= MaxValueDepth && isa<Instruction>(V)) {
+    // Give up on analyzing V rather than recursing any further.  This only
+    // happens when V has no cached SCEV yet; one computed earlier was returned
+    // above, whatever the depth.  The unknown is deliberately not cached, so
+    // that V is analyzed properly when it is queried with budget to spare.
+    // Expressions built on top of it in the meantime keep V opaque, so they
+    // may fold less than they would have had V been analyzed first.
+    // Constants are left alone: they do not recurse far.
+    ++NumValueDepthExceeded;
+    return getUnknown(V);
+  }
+
+  const SCEV *S;
+  {
+    NamedRegionTimer T("getSCEV", "Scalar Evolution Queries",
+                       TimeQueries && CreateSCEVDepth == 0);
+    ++NumSCEVsCreated;
+    ++CreateSCEVDepth;
+    S = createSCEV(V);
+    --CreateSCEVDepth;
+  }
 
   // The process of creating a SCEV for V may have caused other SCEVs
   // to have been created, so it's necessary to insert the new entry
@@ -4613,7 +4683,11 @@ ScalarEvolution::getBackedgeTakenInfo(const Loop *L) {
   // ComputeBackedgeTakenCount may allocate memory for its result. Inserting it
   // into the BackedgeTakenCounts map transfers ownership. Otherwise, the result
   // must be cleared in this scope.
+  NamedRegionTimer T("getBackedgeTakenCount", "Scalar Evolution Queries",
+                     TimeQueries && BECountDepth == 0);
+  ++BECountDepth;
   BackedgeTakenInfo Result = ComputeBackedgeTakenCount(L);
+  --BECountDepth;
 
   if (Result.getExact(this) != getCouldNotCompute()) {
     assert(isLoopInvariant(Result.getExact(this), L) &&
@@ -8060,7 +8134,8 @@ ScalarEvolution::SCEVCallbackVH::SCEVCallbackVH(Value *V, ScalarEvolution *se)
 //===----------------------------------------------------------------------===//
 
 ScalarEvolution::ScalarEvolution()
-    : FunctionPass(ID), WalkingBEDominatingConds(false), ValuesAtScopes(64),
+    : FunctionPass(ID), WalkingBEDominatingConds(false), CreateSCEVDepth(0),
+      BECountDepth(0), ValuesAtScopes(64),
       LoopDispositions(64), BlockDispositions(64), FirstUnknown(nullptr) {
   initializeScalarEvolutionPass(*PassRegistry::getPassRegistry());
 }
@@ -153,6 +153,11 @@ bool TargetTransformInfo::enableAggressiveInterleaving(bool LoopHasReductions) c
   return TTIImpl->enableAggressiveInterleaving(LoopHasReductions);
 }
 
+bool TargetTransformInfo::enableMemCmpExpansion(unsigned &MaxLoadSize,
+                                                unsigned &MaxNumLoads) const {
+  return TTIImpl->enableMemCmpExpansion(MaxLoadSize, MaxNumLoads);
+}
+
 TargetTransformInfo::PopcntSupportKind
 TargetTransformInfo::getPopcntSupport(unsigned IntTyWidthInBit) const {
   return TTIImpl->getPopcntSupport(IntTyWidthInBit);
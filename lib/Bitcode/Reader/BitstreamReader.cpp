@@ -51,6 +51,83 @@ bool BitstreamCursor::EnterSubBlock(unsigned BlockID, unsigned *NumWordsP) {
   return CurCodeSize == 0 || AtEndOfStream();
 }
 
+/// Reserve room for a run of \p NumElts fields of at least \p Width bits each.
+/// The count comes from the stream, so only trust it if the stream is long
+/// enough to hold that many fields.
+static void reserveRun(const BitstreamCursor &Cursor, unsigned Width,
+                       unsigned NumElts, SmallVectorImpl<uint64_t> &Vals) {
+  uint64_t NewEnd = Cursor.GetCurrentBitNo() + uint64_t(NumElts) * Width;
+  if (Cursor.canSkipToPos(NewEnd / 8))
+    Vals.reserve(Vals.size() + NumElts);
+}
+
+void BitstreamCursor::readFixedRun(unsigned Width, bool IsChar6,
+                                   unsigned NumElts,
+                                   SmallVectorImpl<uint64_t> &Vals) {
+  assert(Width && Width <= MaxChunkSize && "Invalid fixed field width");
+  const word_t FieldMask = ~word_t(0) >> (MaxChunkSize - Width);
+  const unsigned ShiftMask = MaxChunkSize - 1;
+
+  reserveRun(*this, Width, NumElts, Vals);
+  while (NumElts) {
+    // Peel off every field that is wholly in the current word, then write the
+    // cursor state back once.
+    word_t W = CurWord;
+    unsigned Avail = BitsInCurWord;
+    while (NumElts && Avail >= Width) {
+      word_t V = W & FieldMask;
+      Vals.push_back(IsChar6 ? BitCodeAbbrevOp::DecodeChar6(V) : V);
+      // Use a mask to avoid undefined behavior for full-word fields.
+      W >>= (Width & ShiftMask);
+      Avail -= Width;
+      --NumElts;
+    }
+    CurWord = W;
+    BitsInCurWord = Avail;
+    if (!NumElts)
+      break;
+
+    // This field straddles a word boundary; let Read refill the word.
+    word_t V = Read(Width);
+    Vals.push_back(IsChar6 ? BitCodeAbbrevOp::DecodeChar6(V) : V);
+    --NumElts;
+  }
+}
+
+void BitstreamCursor::readVBR64Run(unsigned NumBits, unsigned NumElts,
+                                   SmallVectorImpl<uint64_t> &Vals) {
+  assert(NumBits && NumBits <= 32 && "Invalid VBR chunk width");
+  const word_t ChunkMask = ~word_t(0) >> (MaxChunkSize - NumBits);
+  const word_t ContinueBit = word_t(1) << (NumBits - 1);
+  const unsigned ShiftMask = MaxChunkSize - 1;
+
+  reserveRun(*this, NumBits, NumElts, Vals);
+  while (NumElts) {
+    // Most values fit in a single chunk. Decode those straight out of the
+    // current word and stop at the first value that needs more.
+    word_t W = CurWord;
+    unsigned Avail = BitsInCurWord;
+    while (NumElts && Avail >= NumBits) {
+      word_t Piece = W & ChunkMask;
+      if (Piece & ContinueBit)
+        break;
+      Vals.push_back(Piece);
+      // Use a mask to avoid undefined behavior for full-word chunks.
+      W >>= (NumBits & ShiftMask);
+      Avail -= NumBits;
+      --NumElts;
+    }
+    CurWord = W;
+    BitsInCurWord = Avail;
+    if (!NumElts)
+      break;
+
+    // Multi-chunk value, or one that straddles a word boundary.
+    Vals.push_back(ReadVBR64(NumBits));
+    --NumElts;
+  }
+}
+
 static uint64_t readAbbreviatedField(BitstreamCursor &Cursor,
                                      const BitCodeAbbrevOp &Op) {
   assert(!Op.isLiteral() && "Not to be used with literals!");
@@ -130,6 +207,19 @@ void BitstreamCursor::skipRecord(unsigned AbbrevID) {
       assert(i+2 == e && "array op not second to last?");
       const BitCodeAbbrevOp &EltEnc = Abbv->getOperandInfo(++i);
 
+      // Fixed-width elements can be skipped without decoding them.
+      if (EltEnc.getEncoding() == BitCodeAbbrevOp::Fixed ||
+          EltEnc.getEncoding() == BitCodeAbbrevOp::Char6) {
+        unsigned Width = EltEnc.getEncoding() == BitCodeAbbrevOp::Char6
+                             ? 6
+                             : (unsigned)EltEnc.getEncodingData();
+        uint64_t NewEnd = GetCurrentBitNo() + uint64_t(NumElts) * Width;
+        if (canSkipToPos(NewEnd / 8)) {
+          JumpToBit(NewEnd);
+          continue;
+        }
+      }
+
       // Read all the elements.
       for (; NumElts; --NumElts)
         skipAbbreviatedField(*this, EltEnc);
@@ -162,8 +252,7 @@ unsigned BitstreamCursor::readRecord(unsigned AbbrevID,
   if (AbbrevID == bitc::UNABBREV_RECORD) {
     unsigned Code = ReadVBR(6);
     unsigned NumElts = ReadVBR(6);
-    for (unsigned i = 0; i != NumElts; ++i)
-      Vals.push_back(ReadVBR64(6));
+    readVBR64Run(6, NumElts, Vals);
     return Code;
   }
 
@@ -210,9 +299,20 @@ unsigned BitstreamCursor::readRecord(unsigned AbbrevID,
           EltEnc.getEncoding() == BitCodeAbbrevOp::Blob)
         report_fatal_error("Array element type can't be an Array or a Blob");
 
-      // Read all the elements.
-      for (; NumElts; --NumElts)
-        Vals.push_back(readAbbreviatedField(*this, EltEnc));
+      // Read all the elements, a word at a time where possible.
+      if (EltEnc.getEncoding() == BitCodeAbbrevOp::Char6) {
+        readFixedRun(6, /*IsChar6=*/true, NumElts, Vals);
+        continue;
+      }
+      unsigned Width = (unsigned)EltEnc.getEncodingData();
+      assert(Width <= MaxChunkSize);
+      if (EltEnc.getEncoding() == BitCodeAbbrevOp::Fixed)
+        readFixedRun(Width, /*IsChar6=*/false, NumElts, Vals);
+      else if (Width <= 32)
+        readVBR64Run(Width, NumElts, Vals);
+      else
+        for (; NumElts; --NumElts)
+          Vals.push_back(ReadVBR64(Width));
       continue;
     }
 
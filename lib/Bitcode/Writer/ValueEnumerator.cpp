@@ -141,13 +141,20 @@ static OrderMap orderModule(const Module &M) {
 static void predictValueUseListOrderImpl(const Value *V, const Function *F,
                                          unsigned ID, const OrderMap &OM,
                                          UseListOrderStack &Stack) {
-  // Predict use-list order for this one.
-  typedef std::pair<const Use *, unsigned> Entry;
+  // Predict use-list order for this one. The user ID and operand number of
+  // each use are looked up once here: the comparator below runs O(N log N)
+  // times, and both lookups are expensive (a hash probe, and a walk to the
+  // start of the operand list).
+  struct Entry {
+    unsigned UserID;
+    unsigned OperandNo;
+    unsigned Index;
+  };
   SmallVector<Entry, 64> List;
   for (const Use &U : V->uses())
     // Check if this user will be serialized.
-    if (OM.lookup(U.getUser()).first)
-      List.push_back(std::make_pair(&U, List.size()));
+    if (unsigned UserID = OM.lookup(U.getUser()).first)
+      List.push_back({UserID, U.getOperandNo(), (unsigned)List.size()});
 
   if (List.size() < 2)
     // We may have lost some users.
@@ -155,13 +162,11 @@ static void predictValueUseListOrderImpl(const Value *V, const Function *F,
 
   bool IsGlobalValue = OM.isGlobalValue(ID);
   std::sort(List.begin(), List.end(), [&](const Entry &L, const Entry &R) {
-    const Use *LU = L.first;
-    const Use *RU = R.first;
-    if (LU == RU)
+    if (L.Index == R.Index)
       return false;
 
-    auto LID = OM.lookup(LU->getUser()).first;
-    auto RID = OM.lookup(RU->getUser()).first;
+    unsigned LID = L.UserID;
+    unsigned RID = R.UserID;
 
     // Global values are processed in reverse order.
     //
@@ -190,13 +195,13 @@ static void predictValueUseListOrderImpl(const Value *V, const Function *F,
     // Assume operands are added in order for all instructions.
     if (LID <= ID)
       if (!IsGlobalValue) // GlobalValue uses don't get reversed.
-        return LU->getOperandNo() < RU->getOperandNo();
-    return LU->getOperandNo() > RU->getOperandNo();
+        return L.OperandNo < R.OperandNo;
+    return L.OperandNo > R.OperandNo;
   });
 
   if (std::is_sorted(
           List.begin(), List.end(),
-          [](const Entry &L, const Entry &R) { return L.second < R.second; }))
+          [](const Entry &L, const Entry &R) { return L.Index < R.Index; }))
     // Order is already correct.
     return;
 
@@ -204,7 +209,7 @@ static void predictValueUseListOrderImpl(const Value *V, const Function *F,
   Stack.emplace_back(V, F, List.size());
   assert(List.size() == Stack.back().Shuffle.size() && "Wrong size");
   for (size_t I = 0, E = List.size(); I != E; ++I)
-    Stack.back().Shuffle[I] = List[I].second;
+    Stack.back().Shuffle[I] = List[I].Index;
 }
 
 static void predictValueUseListOrder(const Value *V, const Function *F,
@@ -479,15 +484,24 @@ void ValueEnumerator::OptimizeConstants(unsigned CstStart, unsigned CstEnd) {
     // Disable it for now when trying to preserve the order.
     return;
 
-  std::stable_sort(Values.begin() + CstStart, Values.begin() + CstEnd,
-                   [this](const std::pair<const Value *, unsigned> &LHS,
-                          const std::pair<const Value *, unsigned> &RHS) {
-    // Sort by plane.
-    if (LHS.first->getType() != RHS.first->getType())
-      return getTypeID(LHS.first->getType()) < getTypeID(RHS.first->getType());
-    // Then by frequency.
-    return LHS.second > RHS.second;
+  // Sort by plane, then by frequency. Type IDs come from a hash lookup, so
+  // compute each one once rather than twice per comparison.
+  struct ConstantKey {
+    unsigned TypeID;
+    std::pair<const Value *, unsigned> Entry;
+  };
+  SmallVector<ConstantKey, 64> Keys;
+  Keys.reserve(CstEnd - CstStart);
+  for (unsigned I = CstStart; I != CstEnd; ++I)
+    Keys.push_back({getTypeID(Values[I].first->getType()), Values[I]});
+  std::stable_sort(Keys.begin(), Keys.end(),
+                   [](const ConstantKey &LHS, const ConstantKey &RHS) {
+    if (LHS.TypeID != RHS.TypeID)
+      return LHS.TypeID < RHS.TypeID;
+    return LHS.Entry.second > RHS.Entry.second;
   });
+  for (unsigned I = 0, E = Keys.size(); I != E; ++I)
+    Values[CstStart + I] = Keys[I].Entry;
 
   // Ensure that integer and vector of integer constants are at the start of the
   // constant pool.  This is important so that GEP structure indices come before
@@ -68,6 +68,7 @@ STATISTIC(NumDbgValueMoved, "Number of debug value instructions moved");
 STATISTIC(NumSelectsExpanded, "Number of selects turned into branches");
 STATISTIC(NumAndCmpsMoved, "Number of and/cmp's pushed into branches");
 STATISTIC(NumStoreExtractExposed, "Number of store(extractelement) exposed");
+STATISTIC(NumMemCmpExpanded, "Number of memcmp calls expanded inline");
 
 static cl::opt<bool> DisableBranchOpts(
   "disable-cgp-branch-opts", cl::Hidden, cl::init(false),
@@ -89,6 +90,10 @@ static cl::opt<bool> EnableAndCmpSinking(
    "enable-andcmp-sinking", cl::Hidden, cl::init(true),
    cl::desc("Enable sinkinig and/cmp into branches."));
 
+static cl::opt<bool> DisableMemCmpExpansion(
+    "disable-cgp-memcmp-expansion", cl::Hidden, cl::init(false),
+    cl::desc("Disable inline expansion of memcmp with a constant size"));
+
 static cl::opt<bool> DisableStoreExtract(
     "disable-cgp-store-extract", cl::Hidden, cl::init(false),
     cl::desc("Disable store(extract) optimizations in CodeGenPrepare"));
@@ -161,7 +166,10 @@ class TypePromotionTransaction;
     const char *getPassName() const override { return "CodeGen Prepare"; }
 
     void getAnalysisUsage(AnalysisUsage &AU) const override {
-      AU.addPreserved<DominatorTreeWrapperPass>();
+      // FIXME: The dominator tree is not preserved. Several transforms here
+      // change the CFG without a tree to update, and ModifiedDT only restarts
+      // the walk over the blocks. Preserve it once every CFG change is
+      // reported through DominatorTree::applyUpdates.
       AU.addRequired<TargetLibraryInfoWrapperPass>();
       AU.addRequired<TargetTransformInfoWrapperPass>();
     }
@@ -1295,6 +1303,198 @@ static void ScalarizeMaskedStore(CallInst *CI) {
   CI->eraseFromParent();
 }
 
+/// Return true if every user of \p CI only compares it against zero for
+/// equality, so that only "equal or not" has to be computed.
+static bool isOnlyUsedInZeroEqualityComparison(const CallInst *CI) {
+  for (const User *U : CI->users()) {
+    const ICmpInst *IC = dyn_cast<ICmpInst>(U);
+    if (!IC || !IC->isEquality())
+      return false;
+    const Constant *Other = dyn_cast<Constant>(IC->getOperand(1));
+    if (IC->getOperand(1) == CI)
+      Other = dyn_cast<Constant>(IC->getOperand(0));
+    if (!Other || !Other->isNullValue())
+      return false;
+  }
+  return true;
+}
+
+/// Load \p Size bytes at \p Offset from \p Ptr as an integer, byte swapped if
+/// needed so that an unsigned compare of two such values orders them the way
+/// memcmp does, and zero extended to \p WideTy.
+static Value *emitMemCmpLoad(IRBuilder<> &Builder, const DataLayout &DL,
+                             Value *Ptr, uint64_t Offset, unsigned Size,
+                             IntegerType *WideTy, bool ForOrdering) {
+  LLVMContext &Ctx = Builder.getContext();
+  IntegerType *LoadTy = IntegerType::get(Ctx, Size * 8);
+  unsigned AS = cast<PointerType>(Ptr->getType())->getAddressSpace();
+  Value *Addr = Builder.CreateBitCast(Ptr, Type::getInt8PtrTy(Ctx, AS));
+  if (Offset)
+    Addr = Builder.CreateConstGEP1_64(Addr, Offset);
+  Addr = Builder.CreateBitCast(Addr, LoadTy->getPointerTo(AS));
+  Value *V = Builder.CreateAlignedLoad(Addr, 1);
+  if (ForOrdering && Size > 1 && DL.isLittleEndian()) {
+    Function *BSwap = Intrinsic::getDeclaration(
+        Builder.GetInsertBlock()->getModule(), Intrinsic::bswap, LoadTy);
+    V = Builder.CreateCall(BSwap, V);
+  }
+  return Builder.CreateZExt(V, WideTy);
+}
+
+/// Expand a call to memcmp (or bcmp) with a small constant size into loads
+/// of the widest size the target allows. Comparisons that only check for
+/// equality XOR the chunks together and OR the results, with no branches.
+/// Otherwise each chunk is byte swapped and compared in its own block, and
+/// the first chunk that differs decides the result.
+static bool ExpandMemCmp(CallInst *CI, const TargetTransformInfo *TTI,
+                         const TargetLibraryInfo *TLInfo, const DataLayout &DL,
+                         bool &ModifiedDT) {
+  if (CI->isNoBuiltin())
+    return false;
+
+  Function *Callee = CI->getCalledFunction();
+  LibFunc::Func Func;
+  if (!Callee || !TLInfo->getLibFunc(Callee->getName(), Func) ||
+      !TLInfo->has(Func) ||
+      (Func != LibFunc::memcmp && Func != LibFunc::bcmp))
+    return false;
+
+  FunctionType *FTy = Callee->getFunctionType();
+  if (FTy->getNumParams() != 3 || !FTy->getReturnType()->isIntegerTy() ||
+      !FTy->getParamType(0)->isPointerTy() ||
+      !FTy->getParamType(1)->isPointerTy())
+    return false;
+
+  ConstantInt *SizeCI = dyn_cast<ConstantInt>(CI->getArgOperand(2));
+  if (!SizeCI || SizeCI->isZero())
+    return false;
+
+  unsigned MaxLoadSize, MaxNumLoads;
+  if (!TTI->enableMemCmpExpansion(MaxLoadSize, MaxNumLoads))
+    return false;
+  assert(isPowerOf2_32(MaxLoadSize) && "Load size must be a power of two");
+
+  // Cover the buffer with the widest loads that fit, largest first.
+  SmallVector<std::pair<uint64_t, unsigned>, 8> Chunks;
+  uint64_t Remaining = SizeCI->getZExtValue(), Offset = 0;
+  for (unsigned LoadSize = MaxLoadSize; Remaining; LoadSize /= 2) {
+    while (Remaining >= LoadSize) {
+      if (Chunks.size() == MaxNumLoads)
+        return false;
+      Chunks.push_back(std::make_pair(Offset, LoadSize));
+      Offset += LoadSize;
+      Remaining -= LoadSize;
+    }
+  }
+
+  // An inline expansion is larger than the call unless it is a single load.
+  Function *F = CI->getParent()->getParent();
+  if (Chunks.size() > 1 && (F->hasFnAttribute(Attribute::OptimizeForSize) ||
+                            F->hasFnAttribute(Attribute::MinSize)))
+    return false;
+
+  bool IsEquality =
+      Func == LibFunc::bcmp || isOnlyUsedInZeroEqualityComparison(CI);
+  LLVMContext &Ctx = CI->getContext();
+  IntegerType *WideTy = IntegerType::get(Ctx, MaxLoadSize * 8);
+  Type *ResTy = CI->getType();
+  Value *LHS = CI->getArgOperand(0);
+  Value *RHS = CI->getArgOperand(1);
+  IRBuilder<> Builder(CI);
+
+  if (IsEquality) {
+    // memcmp(a, b, n) == 0 iff the OR of the XOR of every chunk is zero.
+    Value *Diff = nullptr;
+    for (auto &Chunk : Chunks) {
+      Value *L = emitMemCmpLoad(Builder, DL, LHS, Chunk.first, Chunk.second,
+                                WideTy, /*ForOrdering=*/false);
+      Value *R = emitMemCmpLoad(Builder, DL, RHS, Chunk.first, Chunk.second,
+                                WideTy, /*ForOrdering=*/false);
+      Value *X = Builder.CreateXor(L, R);
+      Diff = Diff ? Builder.CreateOr(Diff, X) : X;
+    }
+    Value *Res = Builder.CreateZExt(
+        Builder.CreateICmpNE(Diff, ConstantInt::get(WideTy, 0)), ResTy);
+    CI->replaceAllUsesWith(Res);
+    CI->eraseFromParent();
+    ++NumMemCmpExpanded;
+    return true;
+  }
+
+  if (Chunks.size() == 1) {
+    // A single chunk needs no control flow: -1, 0 or 1 from two selects.
+    Value *L = emitMemCmpLoad(Builder, DL, LHS, 0, Chunks[0].second, WideTy,
+                              /*ForOrdering=*/true);
+    Value *R = emitMemCmpLoad(Builder, DL, RHS, 0, Chunks[0].second, WideTy,
+                              /*ForOrdering=*/true);
+    Value *Res;
+    if (Chunks[0].second == 1) {
+      // Both bytes fit in the result, so their difference is the answer.
+      Res = Builder.CreateSub(Builder.CreateZExtOrTrunc(L, ResTy),
+                              Builder.CreateZExtOrTrunc(R, ResTy));
+    } else {
+      Value *Ord = Builder.CreateSelect(Builder.CreateICmpULT(L, R),
+                                        ConstantInt::getSigned(ResTy, -1),
+                                        ConstantInt::get(ResTy, 1));
+      Res = Builder.CreateSelect(Builder.CreateICmpEQ(L, R),
+                                 ConstantInt::get(ResTy, 0), Ord);
+    }
+    CI->replaceAllUsesWith(Res);
+    CI->eraseFromParent();
+    ++NumMemCmpExpanded;
+    return true;
+  }
+
+  // Each chunk gets a block that branches to the next chunk if the loads
+  // are equal and to the result block otherwise:
+  //
+  //   loadbb.N:  %l = bswap(load a+N); %r = bswap(load b+N)
+  //              br (%l == %r), loadbb.N+1 (or end), res
+  //   res:       %l.phi, %r.phi; select (%l.phi < %r.phi), -1, 1
+  //   end:       phi [0, last loadbb], [select, res]
+  BasicBlock *StartBB = CI->getParent();
+  BasicBlock *EndBB = StartBB->splitBasicBlock(CI, "memcmp.end");
+  BasicBlock *ResBB = BasicBlock::Create(Ctx, "memcmp.res", F, EndBB);
+
+  Builder.SetInsertPoint(ResBB);
+  PHINode *PhiL = Builder.CreatePHI(WideTy, Chunks.size(), "memcmp.lhs");
+  PHINode *PhiR = Builder.CreatePHI(WideTy, Chunks.size(), "memcmp.rhs");
+  Value *Ord = Builder.CreateSelect(Builder.CreateICmpULT(PhiL, PhiR),
+                                    ConstantInt::getSigned(ResTy, -1),
+                                    ConstantInt::get(ResTy, 1));
+  Builder.CreateBr(EndBB);
+
+  Builder.SetInsertPoint(EndBB, EndBB->begin());
+  PHINode *Res = Builder.CreatePHI(ResTy, 2, "memcmp.result");
+  Res->addIncoming(Ord, ResBB);
+
+  // Reuse the fall-through branch splitBasicBlock left in the first block.
+  BasicBlock *LoadBB = StartBB;
+  StartBB->getTerminator()->eraseFromParent();
+  for (unsigned I = 0, E = Chunks.size(); I != E; ++I) {
+    Builder.SetInsertPoint(LoadBB);
+    Value *L = emitMemCmpLoad(Builder, DL, LHS, Chunks[I].first,
+                              Chunks[I].second, WideTy, /*ForOrdering=*/true);
+    Value *R = emitMemCmpLoad(Builder, DL, RHS, Chunks[I].first,
+                              Chunks[I].second, WideTy, /*ForOrdering=*/true);
+    BasicBlock *NextBB =
+        I + 1 == E ? EndBB
+                   : BasicBlock::Create(Ctx, "memcmp.loadbb", F, ResBB);
+    Builder.CreateCondBr(Builder.CreateICmpEQ(L, R), NextBB, ResBB);
+    PhiL->addIncoming(L, LoadBB);
+    PhiR->addIncoming(R, LoadBB);
+    if (NextBB == EndBB)
+      Res->addIncoming(ConstantInt::get(ResTy, 0), LoadBB);
+    LoadBB = NextBB;
+  }
+
+  CI->replaceAllUsesWith(Res);
+  CI->eraseFromParent();
+  ++NumMemCmpExpanded;
+  ModifiedDT = true;
+  return true;
+}
+
 bool CodeGenPrepare::OptimizeCallInst(CallInst *CI, bool& ModifiedDT) {
   BasicBlock *BB = CI->getParent();
 
@@ -1434,6 +1634,10 @@ bool CodeGenPrepare::OptimizeCallInst(CallInst *CI, bool& ModifiedDT) {
   // From here on out we're working with named functions.
   if (!CI->getCalledFunction()) return false;
 
+  if (TLI && !DisableMemCmpExpansion &&
+      ExpandMemCmp(CI, TTI, TLInfo, *DL, ModifiedDT))
+    return true;
+
   // Lower all default uses of _chk calls.  This is very similar
   // to what InstCombineCalls does, but here we are only lowering calls
   // to fortified library functions (e.g. __memcpy_chk) that have the default
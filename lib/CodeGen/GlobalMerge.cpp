@@ -101,6 +101,12 @@ static cl::opt<bool> GlobalMergeIgnoreSingleUse(
     cl::desc("Improve global merge pass to ignore globals only used alone"),
     cl::init(true));
 
+static cl::opt<bool> GlobalMergeModuleOrder(
+    "global-merge-module-order", cl::Hidden,
+    cl::desc("Lay out merged globals in module order instead of by size, as "
+             "is done for modules laid out by -reorder-globals"),
+    cl::init(false));
+
 static cl::opt<bool>
 EnableGlobalMergeOnConst("global-merge-on-const", cl::Hidden,
                          cl::desc("Enable global merge pass on constants"),
@@ -189,14 +195,17 @@ bool GlobalMerge::doMerge(SmallVectorImpl<GlobalVariable*> &Globals,
                           Module &M, bool isConst, unsigned AddrSpace) const {
   auto &DL = M.getDataLayout();
   // FIXME: Find better heuristics
-  std::stable_sort(
-      Globals.begin(), Globals.end(),
-      [&DL](const GlobalVariable *GV1, const GlobalVariable *GV2) {
-        Type *Ty1 = cast<PointerType>(GV1->getType())->getElementType();
-        Type *Ty2 = cast<PointerType>(GV2->getType())->getElementType();
-
-        return (DL.getTypeAllocSize(Ty1) < DL.getTypeAllocSize(Ty2));
-      });
+  // When the module has been laid out by access affinity, globals used
+  // together are already adjacent; sorting by size would scatter them again.
+  if (!GlobalMergeModuleOrder && !M.getModuleFlag("Global Affinity Order"))
+    std::stable_sort(
+        Globals.begin(), Globals.end(),
+        [&DL](const GlobalVariable *GV1, const GlobalVariable *GV2) {
+          Type *Ty1 = cast<PointerType>(GV1->getType())->getElementType();
+          Type *Ty2 = cast<PointerType>(GV2->getType())->getElementType();
+
+          return (DL.getTypeAllocSize(Ty1) < DL.getTypeAllocSize(Ty2));
+        });
 
   // If we want to just blindly group all globals together, do so.
   if (!GlobalMergeGroupByUse) {
@@ -18,6 +18,7 @@
 #include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
+#include <tuple>
 using namespace llvm;
 using namespace dwarf;
 using namespace object;
@@ -544,6 +545,11 @@ DWARFContextInMemory::DWARFContextInMemory(const object::ObjectFile &Obj,
     const LoadedObjectInfo *L)
     : IsLittleEndian(Obj.isLittleEndian()),
       AddressSize(Obj.getBytesInAddress()) {
+  // Compressed type sections, registered once TypesSections and
+  // TypesDWOSections have stopped growing.
+  std::vector<std::tuple<TypeSectionMap *, SectionRef, unsigned>>
+      PendingTypes;
+
   for (const SectionRef &Section : Obj.sections()) {
     StringRef name;
     Section.getName(name);
@@ -564,22 +570,22 @@ DWARFContextInMemory::DWARFContextInMemory(const object::ObjectFile &Obj,
 
     name = name.substr(name.find_first_not_of("._")); // Skip . and _ prefixes.
 
-    // Check if debug info section is compressed with zlib.
+    // Check if debug info section is compressed with zlib. Only its header is
+    // read here; the contents are uncompressed when the section is first
+    // accessed, so that looking at one section does not pay for all of them.
+    bool IsCompressed = false;
     if (name.startswith("zdebug_")) {
       uint64_t OriginalSize;
       if (!zlib::isAvailable() ||
           !consumeCompressedDebugSectionHeader(data, OriginalSize))
         continue;
-      UncompressedSections.resize(UncompressedSections.size() + 1);
-      if (zlib::uncompress(data, UncompressedSections.back(), OriginalSize) !=
-          zlib::StatusOK) {
-        UncompressedSections.pop_back();
-        continue;
-      }
-      // Make data point to uncompressed section contents and save its contents.
+      CompressedSection CS = {data, OriginalSize, -1};
+      CompressedSections.push_back(CS);
+      IsCompressed = true;
       name = name.substr(1);
-      data = UncompressedSections.back();
+      data = StringRef();
     }
+    unsigned CompressedIdx = CompressedSections.size() - 1;
 
     StringRef *SectionData =
         StringSwitch<StringRef *>(name)
@@ -611,16 +617,29 @@ DWARFContextInMemory::DWARFContextInMemory(const object::ObjectFile &Obj,
             .Default(nullptr);
     if (SectionData) {
       *SectionData = data;
+      if (IsCompressed)
+        PendingSections[SectionData] = CompressedIdx;
       if (name == "debug_ranges") {
         // FIXME: Use the other dwo range section when we emit it.
         RangeDWOSection = data;
+        if (IsCompressed)
+          PendingSections[&RangeDWOSection] = CompressedIdx;
       }
     } else if (name == "debug_types") {
       // Find debug_types data by section rather than name as there are
       // multiple, comdat grouped, debug_types sections.
       TypesSections[Section].Data = data;
+      if (IsCompressed)
+        PendingTypes.push_back(
+            std::make_tuple(&TypesSections, Section, CompressedIdx));
     } else if (name == "debug_types.dwo") {
       TypesDWOSections[Section].Data = data;
+      if (IsCompressed)
+        PendingTypes.push_back(
+            std::make_tuple(&TypesDWOSections, Section, CompressedIdx));
+    } else if (IsCompressed) {
+      // Not a section we read.
+      CompressedSections.pop_back();
     }
 
     section_iterator RelocatedSection = Section.getRelocatedSection();
@@ -738,6 +757,32 @@ DWARFContextInMemory::DWARFContextInMemory(const object::ObjectFile &Obj,
       }
     }
   }
+
+  for (const auto &P : PendingTypes)
+    PendingSections[&(*std::get<0>(P))[std::get<1>(P)].Data] = std::get<2>(P);
+}
+
+void DWARFContextInMemory::uncompressSection(StringRef &Data) {
+  auto I = PendingSections.find(&Data);
+  if (I == PendingSections.end())
+    return;
+  CompressedSection &CS = CompressedSections[I->second];
+  PendingSections.erase(I);
+
+  // Several members may refer to the same section; only uncompress it once.
+  if (CS.Uncompressed == -1) {
+    UncompressedSections.emplace_back();
+    if (zlib::uncompress(CS.Data, UncompressedSections.back(),
+                         CS.OriginalSize) == zlib::StatusOK) {
+      CS.Uncompressed = UncompressedSections.size() - 1;
+    } else {
+      UncompressedSections.pop_back();
+      CS.Uncompressed = -2;
+    }
+  }
+  // A section that fails to uncompress is left empty.
+  if (CS.Uncompressed >= 0)
+    Data = UncompressedSections[CS.Uncompressed];
 }
 
 void DWARFContextInMemory::anchor() { }
@@ -21,6 +21,16 @@
 
 namespace llvm {
 
+class BasicBlock;
+
+/// invalidateParentIListOrdering - Notify the list owner that an element was
+/// inserted, so that any cached element numbering can be dropped. Only basic
+/// blocks cache such a numbering; this is a no-op for the other owners.
+template <typename ParentClass>
+inline void invalidateParentIListOrdering(ParentClass *Parent) {}
+
+template <> void invalidateParentIListOrdering(BasicBlock *BB);
+
 /// setSymTabObject - This is called when (f.e.) the parent of a basic block
 /// changes.  This requires us to remove all the instruction symtab entries from
 /// the current function and reinsert them into the new function.
@@ -68,6 +78,7 @@ void SymbolTableListTraits<ValueSubClass,ItemParentClass>
   assert(!V->getParent() && "Value already in a container!!");
   ItemParentClass *Owner = getListOwner();
   V->setParent(Owner);
+  invalidateParentIListOrdering(Owner);
   if (V->hasName())
     if (ValueSymbolTable *ST = TraitsClass::getSymTab(Owner))
       ST->reinsertValue(V);
@@ -89,6 +100,8 @@ void SymbolTableListTraits<ValueSubClass,ItemParentClass>
                         ilist_iterator<ValueSubClass> last) {
   // We only have to do work here if transferring instructions between BBs
   ItemParentClass *NewIP = getListOwner(), *OldIP = L2.getListOwner();
+  // Splicing nodes in, even within the same list, may reorder them.
+  invalidateParentIListOrdering(NewIP);
   if (NewIP == OldIP) return;  // No work to do at all...
 
   // We only have to update symbol table entries if we are transferring the
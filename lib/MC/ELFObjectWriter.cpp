@@ -16,6 +16,7 @@
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringMap.h"
+#include "llvm/Config/llvm-config.h"
 #include "llvm/MC/MCAsmBackend.h"
 #include "llvm/MC/MCAsmInfo.h"
 #include "llvm/MC/MCAsmLayout.h"
@@ -28,17 +29,27 @@
 #include "llvm/MC/MCSymbolELF.h"
 #include "llvm/MC/MCValue.h"
 #include "llvm/MC/StringTableBuilder.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Compression.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ELF.h"
 #include "llvm/Support/Endian.h"
 #include "llvm/Support/ErrorHandling.h"
 #include <vector>
+#if LLVM_ENABLE_THREADS != 0
+#include <atomic>
+#include <thread>
+#endif
 using namespace llvm;
 
 #undef  DEBUG_TYPE
 #define DEBUG_TYPE "reloc-info"
 
+static cl::opt<unsigned> WriterThreads(
+    "elf-writer-threads", cl::Hidden, cl::init(1),
+    cl::desc("Number of threads used to compress debug sections and to sort "
+             "and encode relocations (0 = one per hardware thread)"));
+
 namespace {
 
 typedef DenseMap<const MCSectionELF *, uint32_t> SectionIndexMapTy;
@@ -99,6 +110,10 @@ class ELFObjectWriter : public MCObjectWriter {
 
     DenseMap<const MCSymbolELF *, const MCSymbolELF *> Renames;
 
+    /// Contents of the debug sections that are emitted compressed, computed
+    /// in parallel before any section is written.
+    DenseMap<const MCSectionELF *, SmallVector<char, 0>> CompressedSections;
+
     llvm::DenseMap<const MCSectionELF *, std::vector<ELFRelocationEntry>>
         Relocations;
 
@@ -140,6 +155,7 @@ class ELFObjectWriter : public MCObjectWriter {
 
     void reset() override {
       Renames.clear();
+      CompressedSections.clear();
       Relocations.clear();
       StrTabBuilder.clear();
       SectionTable.clear();
@@ -155,11 +171,13 @@ class ELFObjectWriter : public MCObjectWriter {
         write32(W);
     }
 
-    template <typename T> void write(T Val) {
+    template <typename T> void write(T Val) { write(OS, Val); }
+
+    template <typename T> void write(raw_ostream &Out, T Val) const {
       if (IsLittleEndian)
-        support::endian::Writer<support::little>(OS).write(Val);
+        support::endian::Writer<support::little>(Out).write(Val);
       else
-        support::endian::Writer<support::big>(OS).write(Val);
+        support::endian::Writer<support::big>(Out).write(Val);
     }
 
     void writeHeader(const MCAssembler &Asm);
@@ -206,6 +224,9 @@ class ELFObjectWriter : public MCObjectWriter {
                             const SectionIndexMapTy &SectionIndexMap,
                             const SectionOffsetsTy &SectionOffsets);
 
+    void compressDebugSections(const MCAssembler &Asm,
+                               const MCAsmLayout &Layout);
+
     void writeSectionData(const MCAssembler &Asm, MCSection &Sec,
                           const MCAsmLayout &Layout);
 
@@ -214,7 +235,9 @@ class ELFObjectWriter : public MCObjectWriter {
                           uint32_t Link, uint32_t Info, uint64_t Alignment,
                           uint64_t EntrySize);
 
-    void writeRelocations(const MCAssembler &Asm, const MCSectionELF &Sec);
+    void encodeRelocations(const MCAssembler &Asm,
+                           std::vector<ELFRelocationEntry> &Relocs,
+                           SmallVectorImpl<char> &Out) const;
 
     bool isSymbolRefDifferenceFullyResolvedImpl(const MCAssembler &Asm,
                                                 const MCSymbol &SymA,
@@ -231,6 +254,33 @@ class ELFObjectWriter : public MCObjectWriter {
   };
 }
 
+/// Call \p Fn once for every index in [0, N), spread over -elf-writer-threads
+/// threads.  \p Fn must be safe to call concurrently for different indices.
+static void parallelFor(size_t N, function_ref<void(size_t)> Fn) {
+#if LLVM_ENABLE_THREADS != 0
+  size_t NumThreads = WriterThreads;
+  if (NumThreads == 0)
+    NumThreads = std::thread::hardware_concurrency();
+  NumThreads = std::min(NumThreads, N);
+  if (NumThreads > 1) {
+    std::atomic<size_t> Next(0);
+    auto Worker = [&]() {
+      for (size_t I = Next++; I < N; I = Next++)
+        Fn(I);
+    };
+    std::vector<std::thread> Threads;
+    for (size_t T = 1; T != NumThreads; ++T)
+      Threads.emplace_back(Worker);
+    Worker();
+    for (std::thread &T : Threads)
+      T.join();
+    return;
+  }
+#endif
+  for (size_t I = 0; I != N; ++I)
+    Fn(I);
+}
+
 void ELFObjectWriter::align(unsigned Alignment) {
   uint64_t Padding = OffsetToAlignment(OS.tell(), Alignment);
   WriteZeros(Padding);
@@ -1002,41 +1052,60 @@ prependCompressionHeader(uint64_t Size,
   return true;
 }
 
-void ELFObjectWriter::writeSectionData(const MCAssembler &Asm, MCSection &Sec,
-                                       const MCAsmLayout &Layout) {
-  MCSectionELF &Section = static_cast<MCSectionELF &>(Sec);
-  StringRef SectionName = Section.getSectionName();
+void ELFObjectWriter::compressDebugSections(const MCAssembler &Asm,
+                                            const MCAsmLayout &Layout) {
+  if (!Asm.getContext().getAsmInfo()->compressDebugSections())
+    return;
 
   // Compressing debug_frame requires handling alignment fragments which is
   // more work (possibly generalizing MCAssembler.cpp:writeFragment to allow
   // for writing to arbitrary buffers) for little benefit.
-  if (!Asm.getContext().getAsmInfo()->compressDebugSections() ||
-      !SectionName.startswith(".debug_") || SectionName == ".debug_frame") {
-    Asm.writeSectionData(&Section, Layout);
-    return;
+  std::vector<const MCSectionELF *> Sections;
+  for (const MCSection &Sec : Asm) {
+    const MCSectionELF &Section = static_cast<const MCSectionELF &>(Sec);
+    StringRef SectionName = Section.getSectionName();
+    if (SectionName.startswith(".debug_") && SectionName != ".debug_frame")
+      Sections.push_back(&Section);
   }
 
-  // Gather the uncompressed data from all the fragments.
-  const MCSection::FragmentListType &Fragments = Section.getFragmentList();
-  SmallVector<char, 128> UncompressedData =
-      getUncompressedData(Layout, Fragments);
+  // The sections are independent, so compress them concurrently.  A section
+  // that does not compress, or does not get smaller, is left empty here and
+  // written uncompressed.
+  std::vector<SmallVector<char, 0>> Contents(Sections.size());
+  parallelFor(Sections.size(), [&](size_t I) {
+    // Gather the uncompressed data from all the fragments.
+    SmallVector<char, 128> UncompressedData =
+        getUncompressedData(Layout, Sections[I]->getFragmentList());
+
+    SmallVector<char, 0> &CompressedContents = Contents[I];
+    zlib::Status Success = zlib::compress(
+        StringRef(UncompressedData.data(), UncompressedData.size()),
+        CompressedContents);
+    if (Success != zlib::StatusOK ||
+        !prependCompressionHeader(UncompressedData.size(), CompressedContents))
+      CompressedContents.clear();
+  });
+
+  for (size_t I = 0, E = Sections.size(); I != E; ++I)
+    if (!Contents[I].empty())
+      CompressedSections[Sections[I]] = std::move(Contents[I]);
+}
 
-  SmallVector<char, 128> CompressedContents;
-  zlib::Status Success = zlib::compress(
-      StringRef(UncompressedData.data(), UncompressedData.size()),
-      CompressedContents);
-  if (Success != zlib::StatusOK) {
-    Asm.writeSectionData(&Section, Layout);
-    return;
-  }
+void ELFObjectWriter::writeSectionData(const MCAssembler &Asm, MCSection &Sec,
+                                       const MCAsmLayout &Layout) {
+  MCSectionELF &Section = static_cast<MCSectionELF &>(Sec);
 
-  if (!prependCompressionHeader(UncompressedData.size(), CompressedContents)) {
+  auto I = CompressedSections.find(&Section);
+  if (I == CompressedSections.end()) {
     Asm.writeSectionData(&Section, Layout);
     return;
   }
+
+  StringRef SectionName = Section.getSectionName();
   Asm.getContext().renameELFSection(&Section,
                                     (".z" + SectionName.drop_front(1)).str());
-  OS << CompressedContents;
+  OS << I->second;
+  CompressedSections.erase(I);
 }
 
 void ELFObjectWriter::WriteSecHdrEntry(uint32_t Name, uint32_t Type,
@@ -1057,45 +1126,46 @@ void ELFObjectWriter::WriteSecHdrEntry(uint32_t Name, uint32_t Type,
   WriteWord(EntrySize); // sh_entsize
 }
 
-void ELFObjectWriter::writeRelocations(const MCAssembler &Asm,
-                                       const MCSectionELF &Sec) {
-  std::vector<ELFRelocationEntry> &Relocs = Relocations[&Sec];
-
+void ELFObjectWriter::encodeRelocations(const MCAssembler &Asm,
+                                        std::vector<ELFRelocationEntry> &Relocs,
+                                        SmallVectorImpl<char> &Out) const {
   // Sort the relocation entries. Most targets just sort by Offset, but some
   // (e.g., MIPS) have additional constraints.
   TargetObjectWriter->sortRelocs(Asm, Relocs);
 
+  raw_svector_ostream ROS(Out);
   for (unsigned i = 0, e = Relocs.size(); i != e; ++i) {
     const ELFRelocationEntry &Entry = Relocs[e - i - 1];
     unsigned Index = Entry.Symbol ? Entry.Symbol->getIndex() : 0;
 
     if (is64Bit()) {
-      write(Entry.Offset);
+      write(ROS, Entry.Offset);
       if (TargetObjectWriter->isN64()) {
-        write(uint32_t(Index));
+        write(ROS, uint32_t(Index));
 
-        write(TargetObjectWriter->getRSsym(Entry.Type));
-        write(TargetObjectWriter->getRType3(Entry.Type));
-        write(TargetObjectWriter->getRType2(Entry.Type));
-        write(TargetObjectWriter->getRType(Entry.Type));
+        write(ROS, TargetObjectWriter->getRSsym(Entry.Type));
+        write(ROS, TargetObjectWriter->getRType3(Entry.Type));
+        write(ROS, TargetObjectWriter->getRType2(Entry.Type));
+        write(ROS, TargetObjectWriter->getRType(Entry.Type));
       } else {
         struct ELF::Elf64_Rela ERE64;
         ERE64.setSymbolAndType(Index, Entry.Type);
-        write(ERE64.r_info);
+        write(ROS, ERE64.r_info);
       }
       if (hasRelocationAddend())
-        write(Entry.Addend);
+        write(ROS, Entry.Addend);
     } else {
-      write(uint32_t(Entry.Offset));
+      write(ROS, uint32_t(Entry.Offset));
 
       struct ELF::Elf32_Rela ERE32;
       ERE32.setSymbolAndType(Index, Entry.Type);
-      write(ERE32.r_info);
+      write(ROS, ERE32.r_info);
 
       if (hasRelocationAddend())
-        write(uint32_t(Entry.Addend));
+        write(ROS, uint32_t(Entry.Addend));
     }
   }
+  ROS.flush();
 }
 
 const MCSectionELF *ELFObjectWriter::createStringTable(MCContext &Ctx) {
@@ -1199,6 +1269,8 @@ void ELFObjectWriter::writeObject(MCAssembler &Asm,
   // Write out the ELF header ...
   writeHeader(Asm);
 
+  compressDebugSections(Asm, Layout);
+
   // ... then the sections ...
   SectionOffsetsTy SectionOffsets;
   std::vector<MCSectionELF *> Groups;
@@ -1263,13 +1335,25 @@ void ELFObjectWriter::writeObject(MCAssembler &Asm,
   // Compute symbol table information.
   computeSymbolTable(Asm, Layout, SectionIndexMap, RevGroupMap, SectionOffsets);
 
-  for (MCSectionELF *RelSection : Relocations) {
+  // Now that every symbol has its final index, sort and encode the
+  // relocations of each section concurrently, then write them in order.
+  std::vector<std::vector<ELFRelocationEntry> *> Relocs;
+  for (MCSectionELF *RelSection : Relocations)
+    Relocs.push_back(&this->Relocations[RelSection->getAssociatedSection()]);
+  std::vector<SmallVector<char, 0>> EncodedRelocs(Relocations.size());
+  parallelFor(Relocations.size(), [&](size_t I) {
+    encodeRelocations(Asm, *Relocs[I], EncodedRelocs[I]);
+  });
+
+  for (size_t I = 0, E = Relocations.size(); I != E; ++I) {
+    MCSectionELF *RelSection = Relocations[I];
     align(RelSection->getAlignment());
 
     // Remember the offset into the file for this section.
     uint64_t SecStart = OS.tell();
 
-    writeRelocations(Asm, *RelSection->getAssociatedSection());
+    OS << EncodedRelocs[I];
+    EncodedRelocs[I] = SmallVector<char, 0>();
 
     uint64_t SecEnd = OS.tell();
     SectionOffsets[RelSection] = std::make_pair(SecStart, SecEnd);
@@ -67,7 +67,10 @@ public:
         UseDwarfDirectory(useDwarfDirectory) {
     assert(InstPrinter);
     if (IsVerboseAsm)
-        InstPrinter->setCommentStream(CommentStream);
+      InstPrinter->setCommentStream(CommentStream);
+    else
+      // Columns are only needed to align comments, and there are none.
+      OS.disablePositionTracking();
   }
 
   inline void EmitEOL() {
@@ -113,8 +113,38 @@ void PassBuilder::registerFunctionAnalyses(FunctionAnalysisManager &FAM) {
 #include "PassRegistry.def"
 }
 
+void PassBuilder::addFunctionSimplificationPipeline(ModulePassManager &MPM,
+                                                    bool DebugLogging) {
+  // FIXME: Add the inliner, SROA, GVN and the loop passes once they are
+  // available in the new pass manager, and build default<O1..O3> pipelines
+  // around this once those levels schedule different passes.
+
+  // Clean up and simplify each function after its callees, which is where the
+  // inliner will run. Only simplify-cfg changes the CFG, so the dominator tree
+  // is only rebuilt after it.
+  //
+  // FIXME: The legacy pipeline also cleans up every function before this walk
+  // and once more after it. Function analyses are cached either through the
+  // CGSCC proxy or through the module proxy, and neither can be created once
+  // the other holds results, so everything is scheduled in this walk until
+  // the two can share the function analysis manager.
+  FunctionPassManager FPM(DebugLogging);
+  FPM.addPass(LowerExpectIntrinsicPass());
+  FPM.addPass(SimplifyCFGPass());
+  FPM.addPass(EarlyCSEPass());
+  FPM.addPass(InstCombinePass());
+  FPM.addPass(SimplifyCFGPass());
+  FPM.addPass(InstCombinePass());
+  CGSCCPassManager CGPM(DebugLogging);
+  CGPM.addPass(createCGSCCToFunctionPassAdaptor(std::move(FPM)));
+  MPM.addPass(createModuleToPostOrderCGSCCPassAdaptor(std::move(CGPM)));
+}
+
 #ifndef NDEBUG
 static bool isModulePassName(StringRef Name) {
+  if (Name == "function-simplification")
+    return true;
+
 #define MODULE_PASS(NAME, CREATE_PASS) if (Name == NAME) return true;
 #define MODULE_ANALYSIS(NAME, CREATE_PASS)                                     \
   if (Name == "require<" NAME ">" || Name == "invalidate<" NAME ">")           \
@@ -145,7 +175,13 @@ static bool isFunctionPassName(StringRef Name) {
   return false;
 }
 
-bool PassBuilder::parseModulePassName(ModulePassManager &MPM, StringRef Name) {
+bool PassBuilder::parseModulePassName(ModulePassManager &MPM, StringRef Name,
+                                      bool DebugLogging) {
+  if (Name == "function-simplification") {
+    addFunctionSimplificationPipeline(MPM, DebugLogging);
+    return true;
+  }
+
 #define MODULE_PASS(NAME, CREATE_PASS)                                         \
   if (Name == NAME) {                                                          \
     MPM.addPass(CREATE_PASS);                                                  \
@@ -349,7 +385,7 @@ bool PassBuilder::parseModulePassPipeline(ModulePassManager &MPM,
     } else {
       // Otherwise try to parse a pass name.
       size_t End = PipelineText.find_first_of(",)");
-      if (!parseModulePassName(MPM, PipelineText.substr(0, End)))
+      if (!parseModulePassName(MPM, PipelineText.substr(0, End), DebugLogging))
         return false;
       if (VerifyEachPass)
         MPM.addPass(VerifierPass());
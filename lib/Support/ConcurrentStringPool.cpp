@@ -0,0 +1,58 @@
+//===-- ConcurrentStringPool.cpp - Thread-safe string interner ------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the ConcurrentStringPool class.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/ConcurrentStringPool.h"
+#include "llvm/ADT/StringExtras.h"
+
+using namespace llvm;
+
+ConcurrentStringPool::ConcurrentStringPool() {}
+
+ConcurrentStringPool::~ConcurrentStringPool() {}
+
+ConcurrentStringPool::Shard &ConcurrentStringPool::getShard(StringRef Str) {
+  // StringMap picks buckets with the low bits of the same hash, so select the
+  // shard with the high bits to keep each shard's buckets evenly used.
+  unsigned Hash = HashString(Str);
+  return Shards[(Hash >> 24) & (NumShards - 1)];
+}
+
+StringRef ConcurrentStringPool::intern(StringRef Str) {
+  Shard &S = getShard(Str);
+  sys::ScopedLock Guard(S.Lock);
+  return S.Strings.insert(std::make_pair(Str, '\0')).first->getKey();
+}
+
+bool ConcurrentStringPool::count(StringRef Str) const {
+  const Shard &S = getShard(Str);
+  sys::ScopedLock Guard(S.Lock);
+  return S.Strings.count(Str);
+}
+
+size_t ConcurrentStringPool::size() const {
+  size_t Size = 0;
+  for (const Shard &S : Shards) {
+    sys::ScopedLock Guard(S.Lock);
+    Size += S.Strings.size();
+  }
+  return Size;
+}
+
+size_t ConcurrentStringPool::getMemorySize() const {
+  size_t Size = 0;
+  for (const Shard &S : Shards) {
+    sys::ScopedLock Guard(S.Lock);
+    Size += S.Strings.getAllocator().getTotalMemory();
+  }
+  return Size;
+}
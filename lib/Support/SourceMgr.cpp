@@ -19,27 +19,70 @@
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
 using namespace llvm;
 
 static const size_t TabStop = 8;
 
-namespace {
-  struct LineNoCacheTy {
-    unsigned LastQueryBufferID;
-    const char *LastQuery;
-    unsigned LineNoOfQuery;
-  };
+/// Collect the offset of every '\n' in \p Buf into \p Offsets. memchr is
+/// used for the scan since the C library implements it with wide vector
+/// compares; a byte loop here dominates indexing large assembly files.
+template <typename T>
+static void collectNewlineOffsets(StringRef Buf, std::vector<T> &Offsets) {
+  const char *Start = Buf.begin();
+  const char *End = Buf.end();
+  const char *Ptr = Start;
+  while (Ptr != End) {
+    const char *NL =
+        static_cast<const char *>(std::memchr(Ptr, '\n', End - Ptr));
+    if (!NL)
+      break;
+    Offsets.push_back(static_cast<T>(NL - Start));
+    Ptr = NL + 1;
+  }
 }
 
-static LineNoCacheTy *getCache(void *Ptr) {
-  return (LineNoCacheTy*)Ptr;
+template <typename T>
+unsigned SourceMgr::SrcBuffer::getLineNumberImpl(const char *Ptr) const {
+  std::vector<T> *Offsets = static_cast<std::vector<T> *>(OffsetCache);
+  if (!Offsets) {
+    Offsets = new std::vector<T>();
+    collectNewlineOffsets(Buffer->getBuffer(), *Offsets);
+    OffsetCache = Offsets;
+  }
+
+  const char *BufStart = Buffer->getBufferStart();
+  assert(Ptr >= BufStart && Ptr <= Buffer->getBufferEnd());
+  T PtrOffset = static_cast<T>(Ptr - BufStart);
+
+  // The line number is one more than the number of newlines strictly before
+  // the queried offset.
+  return std::lower_bound(Offsets->begin(), Offsets->end(), PtrOffset) -
+         Offsets->begin() + 1;
 }
 
+unsigned SourceMgr::SrcBuffer::getLineNumber(const char *Ptr) const {
+  size_t Sz = Buffer->getBufferSize();
+  if (Sz <= std::numeric_limits<uint16_t>::max())
+    return getLineNumberImpl<uint16_t>(Ptr);
+  if (Sz <= std::numeric_limits<uint32_t>::max())
+    return getLineNumberImpl<uint32_t>(Ptr);
+  return getLineNumberImpl<uint64_t>(Ptr);
+}
 
-SourceMgr::~SourceMgr() {
-  // Delete the line # cache if allocated.
-  if (LineNoCacheTy *Cache = getCache(LineNoCache))
-    delete Cache;
+SourceMgr::SrcBuffer::~SrcBuffer() {
+  if (!OffsetCache)
+    return;
+  // The element type was chosen from the buffer size, which cannot change.
+  size_t Sz = Buffer->getBufferSize();
+  if (Sz <= std::numeric_limits<uint16_t>::max())
+    delete static_cast<std::vector<uint16_t> *>(OffsetCache);
+  else if (Sz <= std::numeric_limits<uint32_t>::max())
+    delete static_cast<std::vector<uint32_t> *>(OffsetCache);
+  else
+    delete static_cast<std::vector<uint64_t> *>(OffsetCache);
 }
 
 unsigned SourceMgr::AddIncludeFile(const std::string &Filename,
@@ -79,40 +122,12 @@ SourceMgr::getLineAndColumn(SMLoc Loc, unsigned BufferID) const {
     BufferID = FindBufferContainingLoc(Loc);
   assert(BufferID && "Invalid Location!");
 
-  const MemoryBuffer *Buff = getMemoryBuffer(BufferID);
+  const SrcBuffer &SB = getBufferInfo(BufferID);
+  const char *BufStart = SB.Buffer->getBufferStart();
+  const char *Ptr = Loc.getPointer();
 
-  // Count the number of \n's between the start of the file and the specified
-  // location.
-  unsigned LineNo = 1;
+  unsigned LineNo = SB.getLineNumber(Ptr);
 
-  const char *BufStart = Buff->getBufferStart();
-  const char *Ptr = BufStart;
-
-  // If we have a line number cache, and if the query is to a later point in the
-  // same file, start searching from the last query location.  This optimizes
-  // for the case when multiple diagnostics come out of one file in order.
-  if (LineNoCacheTy *Cache = getCache(LineNoCache))
-    if (Cache->LastQueryBufferID == BufferID &&
-        Cache->LastQuery <= Loc.getPointer()) {
-      Ptr = Cache->LastQuery;
-      LineNo = Cache->LineNoOfQuery;
-    }
-
-  // Scan for the location being queried, keeping track of the number of lines
-  // we see.
-  for (; SMLoc::getFromPointer(Ptr) != Loc; ++Ptr)
-    if (*Ptr == '\n') ++LineNo;
-
-  // Allocate the line number cache if it doesn't exist.
-  if (!LineNoCache)
-    LineNoCache = new LineNoCacheTy();
-
-  // Update the line # cache.
-  LineNoCacheTy &Cache = *getCache(LineNoCache);
-  Cache.LastQueryBufferID = BufferID;
-  Cache.LastQuery = Ptr;
-  Cache.LineNoOfQuery = LineNo;
-  
   size_t NewlineOffs = StringRef(BufStart, Ptr-BufStart).find_last_of("\n\r");
   if (NewlineOffs == StringRef::npos) NewlineOffs = ~(size_t)0;
   return std::make_pair(LineNo, Ptr-BufStart-NewlineOffs);
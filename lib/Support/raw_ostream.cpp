@@ -28,6 +28,14 @@
 #include <sys/stat.h>
 #include <system_error>
 
+#if LLVM_ENABLE_THREADS != 0
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#endif
+
 // <fcntl.h> may provide O_BINARY.
 #if defined(HAVE_FCNTL_H)
 # include <fcntl.h>
@@ -509,6 +517,169 @@ static int getFD(StringRef Filename, std::error_code &EC,
   return FD;
 }
 
+/// Write all of \p Ptr to \p FD, retrying interrupted and partial writes.
+/// Returns false on an unrecoverable error.
+static bool writeToFD(int FD, const char *Ptr, size_t Size,
+                      bool UseAtomicWrites) {
+  do {
+    ssize_t ret;
+
+    // Check whether we should attempt to use atomic writes.
+    if (LLVM_LIKELY(!UseAtomicWrites)) {
+      ret = ::write(FD, Ptr, Size);
+    } else {
+      // Use ::writev() where available.
+#if defined(HAVE_WRITEV)
+      const void *Addr = static_cast<const void *>(Ptr);
+      struct iovec IOV = {const_cast<void *>(Addr), Size };
+      ret = ::writev(FD, &IOV, 1);
+#else
+      ret = ::write(FD, Ptr, Size);
+#endif
+    }
+
+    if (ret < 0) {
+      // If it's a recoverable error, swallow it and retry the write.
+      //
+      // Ideally we wouldn't ever see EAGAIN or EWOULDBLOCK here, since
+      // raw_ostream isn't designed to do non-blocking I/O. However, some
+      // programs, such as old versions of bjam, have mistakenly used
+      // O_NONBLOCK. For compatibility, emulate blocking semantics by
+      // spinning until the write succeeds. If you don't want spinning,
+      // don't use O_NONBLOCK file descriptors with raw_ostream.
+      if (errno == EINTR || errno == EAGAIN
+#ifdef EWOULDBLOCK
+          || errno == EWOULDBLOCK
+#endif
+          )
+        continue;
+
+      // Otherwise it's a non-recoverable error.
+      return false;
+    }
+
+    // The write may have written some or all of the data. Update the
+    // size and buffer pointer to reflect the remainder that needs
+    // to be written. If there are no bytes left, we're done.
+    Ptr += ret;
+    Size -= ret;
+  } while (Size > 0);
+  return true;
+}
+
+#if LLVM_ENABLE_THREADS != 0
+/// A writer thread and a fixed set of buffers. The stream fills one buffer
+/// while the thread writes the ones handed to it in order.
+class raw_fd_ostream::AsyncWriter {
+  const int FD;
+  const size_t BufferSize;
+  std::vector<std::unique_ptr<char[]>> Buffers;
+
+  std::mutex Lock;
+  /// Signalled whenever a buffer is queued or written, and on shutdown.
+  std::condition_variable Changed;
+  /// Filled buffers waiting to be written, with their sizes.
+  std::deque<std::pair<char *, size_t>> Queue;
+  /// Buffers that may be filled.
+  std::vector<char *> Free;
+  /// True while the thread writes a buffer it has taken off the queue.
+  bool Busy;
+  bool Done;
+  /// True if a write failed since the last call to wait().
+  bool Failed;
+
+  std::thread Thread;
+
+  void run() {
+    std::unique_lock<std::mutex> Guard(Lock);
+    for (;;) {
+      Changed.wait(Guard, [this] { return Done || !Queue.empty(); });
+      if (Queue.empty())
+        return;
+      std::pair<char *, size_t> Item = Queue.front();
+      Queue.pop_front();
+      Busy = true;
+      Guard.unlock();
+      // Once a write has failed the output is useless; just recycle buffers.
+      bool OK = Failed || writeToFD(FD, Item.first, Item.second, false);
+      Guard.lock();
+      Busy = false;
+      Failed |= !OK;
+      Free.push_back(Item.first);
+      Changed.notify_all();
+    }
+  }
+
+public:
+  AsyncWriter(int FD, size_t BufferSize, unsigned NumBuffers)
+      : FD(FD), BufferSize(BufferSize), Busy(false), Done(false),
+        Failed(false) {
+    for (unsigned I = 0; I != NumBuffers; ++I) {
+      Buffers.emplace_back(new char[BufferSize]);
+      Free.push_back(Buffers.back().get());
+    }
+    Thread = std::thread([this] { run(); });
+  }
+
+  ~AsyncWriter() {
+    {
+      std::lock_guard<std::mutex> Guard(Lock);
+      Done = true;
+    }
+    Changed.notify_all();
+    Thread.join();
+  }
+
+  size_t getBufferSize() const { return BufferSize; }
+
+  /// Return true if \p Ptr is the start of one of the writer's buffers.
+  bool owns(const char *Ptr) const {
+    for (const auto &Buffer : Buffers)
+      if (Buffer.get() == Ptr)
+        return true;
+    return false;
+  }
+
+  /// Return a buffer to fill, waiting for one to be written if necessary.
+  char *acquire() {
+    std::unique_lock<std::mutex> Guard(Lock);
+    Changed.wait(Guard, [this] { return !Free.empty(); });
+    char *Buffer = Free.back();
+    Free.pop_back();
+    return Buffer;
+  }
+
+  /// Queue the first \p Size bytes of \p Buffer, which came from acquire(),
+  /// to be written.
+  void submit(char *Buffer, size_t Size) {
+    {
+      std::lock_guard<std::mutex> Guard(Lock);
+      Queue.push_back(std::make_pair(Buffer, Size));
+    }
+    Changed.notify_all();
+  }
+
+  /// Wait until everything queued has been written. Returns false if any
+  /// write failed since the last call.
+  bool wait() {
+    std::unique_lock<std::mutex> Guard(Lock);
+    Changed.wait(Guard, [this] { return Queue.empty() && !Busy; });
+    bool OK = !Failed;
+    Failed = false;
+    return OK;
+  }
+};
+#else
+class raw_fd_ostream::AsyncWriter {
+public:
+  size_t getBufferSize() const { return 0; }
+  bool owns(const char *) const { return false; }
+  char *acquire() { llvm_unreachable("no threads"); }
+  void submit(char *, size_t) { llvm_unreachable("no threads"); }
+  bool wait() { llvm_unreachable("no threads"); }
+};
+#endif
+
 raw_fd_ostream::raw_fd_ostream(StringRef Filename, std::error_code &EC,
                                sys::fs::OpenFlags Flags)
     : raw_fd_ostream(getFD(Filename, EC, Flags), true) {}
@@ -542,6 +713,7 @@ raw_fd_ostream::raw_fd_ostream(int fd, bool shouldClose, bool unbuffered)
 raw_fd_ostream::~raw_fd_ostream() {
   if (FD >= 0) {
     flush();
+    waitForAsyncWrites();
     if (ShouldClose && sys::Process::SafelyCloseFileDescriptor(FD))
       error_detected();
   }
@@ -567,56 +739,71 @@ void raw_fd_ostream::write_impl(const char *Ptr, size_t Size) {
   assert(FD >= 0 && "File already closed.");
   pos += Size;
 
-  do {
-    ssize_t ret;
+  if (Async) {
+    // A full stream buffer is handed to the writer as is, and the stream
+    // continues in a fresh one.
+    if (Ptr == getBufferStart() && Async->owns(Ptr)) {
+      char *Buffer = const_cast<char *>(Ptr);
+      Async->submit(Buffer, Size);
+      SetBuffer(Async->acquire(), Async->getBufferSize());
+      return;
+    }
 
-    // Check whether we should attempt to use atomic writes.
-    if (LLVM_LIKELY(!UseAtomicWrites)) {
-      ret = ::write(FD, Ptr, Size);
-    } else {
-      // Use ::writev() where available.
-#if defined(HAVE_WRITEV)
-      const void *Addr = static_cast<const void *>(Ptr);
-      struct iovec IOV = {const_cast<void *>(Addr), Size };
-      ret = ::writev(FD, &IOV, 1);
-#else
-      ret = ::write(FD, Ptr, Size);
-#endif
+    // Data too large for the stream buffer is copied into writer buffers.
+    while (Size > 0) {
+      size_t N = std::min(Size, Async->getBufferSize());
+      char *Buffer = Async->acquire();
+      memcpy(Buffer, Ptr, N);
+      Async->submit(Buffer, N);
+      Ptr += N;
+      Size -= N;
     }
+    return;
+  }
 
-    if (ret < 0) {
-      // If it's a recoverable error, swallow it and retry the write.
-      //
-      // Ideally we wouldn't ever see EAGAIN or EWOULDBLOCK here, since
-      // raw_ostream isn't designed to do non-blocking I/O. However, some
-      // programs, such as old versions of bjam, have mistakenly used
-      // O_NONBLOCK. For compatibility, emulate blocking semantics by
-      // spinning until the write succeeds. If you don't want spinning,
-      // don't use O_NONBLOCK file descriptors with raw_ostream.
-      if (errno == EINTR || errno == EAGAIN
-#ifdef EWOULDBLOCK
-          || errno == EWOULDBLOCK
-#endif
-          )
-        continue;
+  if (!writeToFD(FD, Ptr, Size, UseAtomicWrites))
+    error_detected();
+}
 
-      // Otherwise it's a non-recoverable error. Note it and quit.
-      error_detected();
-      break;
-    }
+bool raw_fd_ostream::enableAsyncWrites(size_t BufferSize, unsigned NumBuffers) {
+#if LLVM_ENABLE_THREADS != 0
+  if (Async)
+    return true;
+  if (FD < 0 || UseAtomicWrites || GetBufferSize() == 0 || BufferSize == 0)
+    return false;
 
-    // The write may have written some or all of the data. Update the
-    // size and buffer pointer to reflect the remainder that needs
-    // to be written. If there are no bytes left, we're done.
-    Ptr += ret;
-    Size -= ret;
-  } while (Size > 0);
+  // Output to pipes and terminals is usually read as it is produced, so it
+  // must not sit in a queue.
+  sys::fs::file_status Status;
+  if (sys::fs::status(FD, Status) ||
+      Status.type() != sys::fs::file_type::regular_file)
+    return false;
+
+  flush();
+  // One buffer is being filled while the others are written or queued.
+  Async.reset(new AsyncWriter(FD, BufferSize, std::max(NumBuffers, 2U)));
+  SetBuffer(Async->acquire(), BufferSize);
+  return true;
+#else
+  return false;
+#endif
+}
+
+void raw_fd_ostream::waitForAsyncWrites() {
+  if (Async && !Async->wait())
+    error_detected();
 }
 
 void raw_fd_ostream::close() {
   assert(ShouldClose);
   ShouldClose = false;
   flush();
+  if (Async) {
+    waitForAsyncWrites();
+    // The stream buffer belongs to the writer.
+    SetUnbuffered();
+    Async.reset();
+  }
   if (sys::Process::SafelyCloseFileDescriptor(FD))
     error_detected();
   FD = -1;
@@ -624,6 +811,7 @@ void raw_fd_ostream::close() {
 
 uint64_t raw_fd_ostream::seek(uint64_t off) {
   flush();
+  waitForAsyncWrites();
   pos = ::lseek(FD, off, SEEK_SET);
   if (pos == (uint64_t)-1)
     error_detected();
@@ -1133,6 +1133,16 @@ bool X86TTIImpl::isLegalMaskedStore(Type *DataType, int Consecutive) {
   return isLegalMaskedLoad(DataType, Consecutive);
 }
 
+bool X86TTIImpl::enableMemCmpExpansion(unsigned &MaxLoadSize,
+                                       unsigned &MaxNumLoads) {
+  // Unaligned GPR loads are cheap, and bswap plus a compare orders two
+  // chunks. Eight loads per side covers the common header sizes up to 64
+  // bytes on x86-64.
+  MaxLoadSize = ST->is64Bit() ? 8 : 4;
+  MaxNumLoads = 8;
+  return true;
+}
+
 bool X86TTIImpl::hasCompatibleFunctionAttributes(const Function *Caller,
                                                  const Function *Callee) const {
   const TargetMachine &TM = getTLI()->getTargetMachine();
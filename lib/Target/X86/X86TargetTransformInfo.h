@@ -92,6 +92,7 @@ public:
                          Type *Ty);
   bool isLegalMaskedLoad(Type *DataType, int Consecutive);
   bool isLegalMaskedStore(Type *DataType, int Consecutive);
+  bool enableMemCmpExpansion(unsigned &MaxLoadSize, unsigned &MaxNumLoads);
   bool hasCompatibleFunctionAttributes(const Function *Caller,
                                        const Function *Callee) const;
 
@@ -0,0 +1,328 @@
+//===- GlobalReorder.cpp - Lay out globals by access affinity -------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass reorders the global variables of a module so that globals which
+// are accessed together end up next to each other, and globals which are
+// never accessed on a warm path end up after all the others.
+//
+// Globals are emitted in module order, so by default their layout follows
+// declaration order, which scatters state that is used together across cache
+// lines.  For every basic block we collect the set of globals it references
+// and weight it by the block's estimated execution count: the block frequency
+// relative to the function entry, scaled by the function entry count when
+// profile data is available.  Each pair of globals referenced by the same
+// block gains that weight as affinity.  Chains of globals are then built
+// greedily from the heaviest affinity edges (in the style of Pettis-Hansen
+// code layout), and emitted hottest first.  A global referenced from the
+// initializer of a hot global, such as a string in a table of names or the
+// data next to a function pointer in a dispatch table, is as hot as the table.
+//
+// Globals that are never referenced from a block with a non-zero weight are
+// cold.  They are moved after all hot globals and can optionally be placed in
+// their own section.  Zero-initialized globals are left alone, so that they
+// stay in .bss.  Hot globals keep their default section so that GlobalMerge,
+// which runs later in the code generator, can still merge them; the pass
+// records the "Global Affinity Order" module flag, which makes GlobalMerge
+// keep the order chosen here.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/IPO.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/BlockFrequencyInfo.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+using namespace llvm;
+
+#define DEBUG_TYPE "reorder-globals"
+
+STATISTIC(NumHot, "Number of globals laid out by affinity");
+STATISTIC(NumCold, "Number of cold globals moved after hot globals");
+
+static cl::opt<std::string> ColdSection(
+    "reorder-globals-cold-section", cl::Hidden, cl::init(""),
+    cl::desc("Section to place cold, writable globals without an explicit "
+             "section into"));
+
+// Pairwise affinity is quadratic in the number of globals one block touches,
+// so only the first few distinct globals of a block contribute to it.
+static cl::opt<unsigned> MaxGlobalsPerBlock(
+    "reorder-globals-max-per-block", cl::Hidden, cl::init(16),
+    cl::desc("Maximum number of globals per block considered for affinity"));
+
+namespace {
+/// A chain of globals that will be laid out contiguously.
+struct Chain {
+  SmallVector<unsigned, 4> Members;
+  double Weight;
+  uint64_t Size;
+  unsigned FirstIndex;
+};
+
+struct GlobalReorder : public ModulePass {
+  static char ID; // Pass identification, replacement for typeid
+  GlobalReorder() : ModulePass(ID) {
+    initializeGlobalReorderPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnModule(Module &M) override;
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<BlockFrequencyInfo>();
+    AU.setPreservesAll();
+  }
+
+private:
+  /// Candidate globals, in module order.
+  SmallVector<GlobalVariable *, 64> Globals;
+  /// Map from a candidate to its index in Globals.
+  DenseMap<const GlobalVariable *, unsigned> GlobalIndex;
+  /// Estimated number of executions of blocks referencing each global.
+  std::vector<double> Hotness;
+  /// Affinity between two globals, keyed by (lower index, higher index).
+  DenseMap<std::pair<unsigned, unsigned>, double> Affinity;
+
+  void collectCandidates(Module &M);
+  void collectReferences(const Value *V, SmallVectorImpl<unsigned> &Refs,
+                         SmallPtrSetImpl<const Value *> &Visited) const;
+  void accumulateFunction(Function &F);
+  void propagateThroughInitializers();
+  std::vector<Chain> buildChains(const DataLayout &DL) const;
+};
+} // end anonymous namespace
+
+char GlobalReorder::ID = 0;
+INITIALIZE_PASS_BEGIN(GlobalReorder, "reorder-globals",
+                      "Reorder globals by access affinity", false, false)
+INITIALIZE_PASS_DEPENDENCY(BlockFrequencyInfo)
+INITIALIZE_PASS_END(GlobalReorder, "reorder-globals",
+                    "Reorder globals by access affinity", false, false)
+
+ModulePass *llvm::createGlobalReorderPass() { return new GlobalReorder(); }
+
+void GlobalReorder::collectCandidates(Module &M) {
+  for (GlobalVariable &GV : M.globals()) {
+    // Only definitions have a layout, and the llvm.* globals are metadata for
+    // the code generator rather than data.
+    if (GV.isDeclaration() || GV.getName().startswith("llvm."))
+      continue;
+    // Moving a zero-initialized global next to initialized ones, or into the
+    // cold section, would take it out of .bss.
+    if (GV.getInitializer()->isNullValue())
+      continue;
+    GlobalIndex[&GV] = Globals.size();
+    Globals.push_back(&GV);
+  }
+  Hotness.assign(Globals.size(), 0.0);
+}
+
+/// Collect the candidate globals referenced by \p V, looking through constant
+/// expressions such as GEPs and casts of globals, and through the elements of
+/// constant arrays, structs and vectors.
+void GlobalReorder::collectReferences(
+    const Value *V, SmallVectorImpl<unsigned> &Refs,
+    SmallPtrSetImpl<const Value *> &Visited) const {
+  if (const GlobalVariable *GV = dyn_cast<GlobalVariable>(V)) {
+    auto It = GlobalIndex.find(GV);
+    if (It != GlobalIndex.end() && Visited.insert(GV).second)
+      Refs.push_back(It->second);
+    return;
+  }
+  if (isa<ConstantExpr>(V) || isa<ConstantArray>(V) || isa<ConstantStruct>(V) ||
+      isa<ConstantVector>(V))
+    if (Visited.insert(V).second)
+      for (const Value *Op : cast<Constant>(V)->operands())
+        collectReferences(Op, Refs, Visited);
+}
+
+void GlobalReorder::accumulateFunction(Function &F) {
+  BlockFrequencyInfo &BFI = getAnalysis<BlockFrequencyInfo>(F);
+  double EntryFreq = BFI.getEntryFreq();
+  if (EntryFreq == 0)
+    return;
+  // Without profile data every function is assumed to run once, which still
+  // ranks the globals used in loops above the ones used in straight-line code.
+  double EntryCount = 1.0;
+  if (Optional<uint64_t> Count = F.getEntryCount())
+    EntryCount = *Count;
+
+  SmallVector<unsigned, 16> Refs;
+  SmallPtrSet<const Value *, 16> Visited;
+  for (BasicBlock &BB : F) {
+    Refs.clear();
+    Visited.clear();
+    for (Instruction &I : BB)
+      for (const Value *Op : I.operands())
+        collectReferences(Op, Refs, Visited);
+    if (Refs.empty())
+      continue;
+
+    double Weight = EntryCount * BFI.getBlockFreq(&BB).getFrequency() /
+                    EntryFreq;
+    if (Weight == 0)
+      continue;
+    for (unsigned Idx : Refs)
+      Hotness[Idx] += Weight;
+
+    unsigned N = std::min<unsigned>(Refs.size(), MaxGlobalsPerBlock);
+    for (unsigned I = 0; I != N; ++I)
+      for (unsigned J = I + 1; J != N; ++J)
+        Affinity[std::make_pair(std::min(Refs[I], Refs[J]),
+                                std::max(Refs[I], Refs[J]))] += Weight;
+  }
+}
+
+/// Make every global referenced from the initializer of a hot global at least
+/// as hot as that global, transitively.
+void GlobalReorder::propagateThroughInitializers() {
+  SmallVector<unsigned, 16> Worklist;
+  for (unsigned I = 0, E = Globals.size(); I != E; ++I)
+    if (Hotness[I] != 0)
+      Worklist.push_back(I);
+
+  SmallVector<unsigned, 16> Refs;
+  SmallPtrSet<const Value *, 16> Visited;
+  while (!Worklist.empty()) {
+    unsigned I = Worklist.pop_back_val();
+    Refs.clear();
+    Visited.clear();
+    collectReferences(Globals[I]->getInitializer(), Refs, Visited);
+    for (unsigned Ref : Refs)
+      if (Hotness[Ref] < Hotness[I]) {
+        Hotness[Ref] = Hotness[I];
+        Worklist.push_back(Ref);
+      }
+  }
+}
+
+std::vector<Chain> GlobalReorder::buildChains(const DataLayout &DL) const {
+  // Every hot global starts in a chain of its own.
+  std::vector<Chain> Chains;
+  std::vector<unsigned> ChainOf(Globals.size(), ~0U);
+  for (unsigned I = 0, E = Globals.size(); I != E; ++I) {
+    if (Hotness[I] == 0)
+      continue;
+    ChainOf[I] = Chains.size();
+    Chain C;
+    C.Members.push_back(I);
+    C.Weight = Hotness[I];
+    C.Size = DL.getTypeAllocSize(Globals[I]->getType()->getElementType());
+    C.FirstIndex = I;
+    Chains.push_back(C);
+  }
+
+  // Visit the affinity edges heaviest first, ties broken by module order so
+  // that the result is deterministic.
+  typedef std::pair<std::pair<unsigned, unsigned>, double> Edge;
+  std::vector<Edge> Edges(Affinity.begin(), Affinity.end());
+  std::sort(Edges.begin(), Edges.end(), [](const Edge &A, const Edge &B) {
+    if (A.second != B.second)
+      return A.second > B.second;
+    return A.first < B.first;
+  });
+
+  // Join the chains of the two endpoints, orienting them so that the two
+  // globals end up as close to each other as the chains allow.
+  for (const Edge &E : Edges) {
+    unsigned A = E.first.first, B = E.first.second;
+    unsigned CA = ChainOf[A], CB = ChainOf[B];
+    if (CA == CB)
+      continue;
+    Chain &Left = Chains[CA], &Right = Chains[CB];
+    if (Left.Members.front() == A)
+      std::reverse(Left.Members.begin(), Left.Members.end());
+    if (Right.Members.back() == B)
+      std::reverse(Right.Members.begin(), Right.Members.end());
+    for (unsigned M : Right.Members)
+      ChainOf[M] = CA;
+    Left.Members.append(Right.Members.begin(), Right.Members.end());
+    Left.Weight += Right.Weight;
+    Left.Size += Right.Size;
+    Left.FirstIndex = std::min(Left.FirstIndex, Right.FirstIndex);
+    Right.Members.clear();
+  }
+
+  Chains.erase(std::remove_if(Chains.begin(), Chains.end(),
+                              [](const Chain &C) { return C.Members.empty(); }),
+               Chains.end());
+
+  // The densest chains go first, so that the hottest bytes share the fewest
+  // cache lines.
+  std::sort(Chains.begin(), Chains.end(), [](const Chain &A, const Chain &B) {
+    double DA = A.Weight / std::max<uint64_t>(A.Size, 1);
+    double DB = B.Weight / std::max<uint64_t>(B.Size, 1);
+    if (DA != DB)
+      return DA > DB;
+    return A.FirstIndex < B.FirstIndex;
+  });
+  return Chains;
+}
+
+bool GlobalReorder::runOnModule(Module &M) {
+  Globals.clear();
+  GlobalIndex.clear();
+  Affinity.clear();
+  collectCandidates(M);
+  if (Globals.size() < 2)
+    return false;
+
+  for (Function &F : M)
+    if (!F.isDeclaration())
+      accumulateFunction(F);
+  propagateThroughInitializers();
+
+  std::vector<Chain> Chains = buildChains(M.getDataLayout());
+
+  // Move the hot globals, chain by chain, to the end of the global list, then
+  // the cold ones in their original order after them.
+  SmallVector<GlobalVariable *, 64> NewOrder;
+  for (const Chain &C : Chains)
+    for (unsigned I : C.Members)
+      NewOrder.push_back(Globals[I]);
+  NumHot += NewOrder.size();
+  bool Changed = false;
+  for (unsigned I = 0, E = Globals.size(); I != E; ++I) {
+    if (Hotness[I] != 0)
+      continue;
+    GlobalVariable *GV = Globals[I];
+    NewOrder.push_back(GV);
+    ++NumCold;
+    if (!ColdSection.empty() && !GV->hasSection() && !GV->isConstant() &&
+        !GV->isThreadLocal()) {
+      GV->setSection(ColdSection);
+      Changed = true;
+    }
+  }
+
+  for (unsigned I = 0, E = NewOrder.size(); I != E; ++I)
+    Changed |= NewOrder[I] != Globals[I];
+
+  DEBUG(for (GlobalVariable *GV : NewOrder) dbgs()
+        << "GlobalReorder: " << GV->getName() << " hotness "
+        << Hotness[GlobalIndex[GV]] << "\n");
+
+  auto &GlobalList = M.getGlobalList();
+  for (GlobalVariable *GV : NewOrder)
+    GlobalList.splice(GlobalList.end(), GlobalList, GV);
+
+  // Tell GlobalMerge not to sort the globals it merges by size.
+  if (!M.getModuleFlag("Global Affinity Order")) {
+    M.addModuleFlag(Module::Warning, "Global Affinity Order", 1);
+    Changed = true;
+  }
+  return Changed;
+}
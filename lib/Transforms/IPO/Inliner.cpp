@@ -46,6 +46,11 @@ STATISTIC(NumMergedAllocas, "Number of allocas merged together");
 // if those would be more profitable and blocked inline steps.
 STATISTIC(NumCallerCallersAnalyzed, "Number of caller-callers analyzed");
 
+STATISTIC(NumInlineCostCacheHits, "Number of inline costs reused from cache");
+STATISTIC(NumInlineCostCacheMisses, "Number of inline costs computed");
+STATISTIC(NumCallSitesNotRevisited,
+          "Number of call sites skipped because nothing they depend on changed");
+
 static cl::opt<int>
 InlineLimit("inline-threshold", cl::Hidden, cl::init(225), cl::ZeroOrMore,
         cl::desc("Control the amount of inlining to perform (default = 225)"));
@@ -300,9 +305,87 @@ static void emitAnalysis(CallSite CS, const Twine &Msg) {
   emitOptimizationRemarkAnalysis(Ctx, DEBUG_TYPE, *Caller, DLoc, Msg);
 }
 
+/// Summarize everything about CS that the inline cost analysis looks at
+/// beyond the caller and callee themselves: the call site attributes, whether
+/// the call is followed by unreachable, whether it is the last call to a local
+/// function, and for each argument either the constant passed or the base and
+/// constant offset of a pointer argument.  Two call sites with the same
+/// pattern between the same caller and callee have the same inline cost.
+static void computeArgPattern(CallSite CS, const DataLayout &DL,
+                              SmallVectorImpl<uintptr_t> &Pattern) {
+  Function *Callee = CS.getCalledFunction();
+  Instruction *Call = CS.getInstruction();
+  bool NoReturn;
+  if (InvokeInst *II = dyn_cast<InvokeInst>(Call))
+    NoReturn = isa<UnreachableInst>(II->getNormalDest()->begin());
+  else
+    NoReturn = isa<UnreachableInst>(++BasicBlock::iterator(Call));
+  bool LastCallToLocal = Callee->hasLocalLinkage() && Callee->hasOneUse();
+
+  Pattern.push_back(
+      reinterpret_cast<uintptr_t>(CS.getAttributes().getRawPointer()));
+  Pattern.push_back(unsigned(NoReturn) | (unsigned(LastCallToLocal) << 1));
+
+  SmallVector<Value *, 8> Bases;
+  for (Value *Arg : CS.args()) {
+    if (Constant *C = dyn_cast<Constant>(Arg)) {
+      // Constants are uniqued, so their address identifies them. Pointers
+      // are at least 2-aligned, which keeps them apart from the odd tags
+      // used below.
+      Pattern.push_back(reinterpret_cast<uintptr_t>(C));
+      Pattern.push_back(0);
+      Bases.push_back(nullptr);
+      continue;
+    }
+    if (!Arg->getType()->isPointerTy()) {
+      Pattern.push_back(0);
+      Pattern.push_back(0);
+      Bases.push_back(nullptr);
+      continue;
+    }
+
+    // The analysis can fold comparisons and differences between pointers
+    // derived from the same base, and SROA pointers derived from allocas, so
+    // record which earlier argument (if any) shares this one's base.
+    APInt Offset(DL.getPointerTypeSizeInBits(Arg->getType()), 0);
+    Value *Base = Arg->stripAndAccumulateInBoundsConstantOffsets(DL, Offset);
+    unsigned SameBase = std::find(Bases.begin(), Bases.end(), Base) -
+                        Bases.begin();
+    Bases.push_back(Base);
+    Pattern.push_back((uintptr_t(SameBase) << 2) |
+                      (uintptr_t(isa<AllocaInst>(Base)) << 1) | 1);
+    Pattern.push_back(uintptr_t(Offset.getSExtValue()));
+  }
+}
+
+InlineCost Inliner::getCachedInlineCost(CallSite CS) {
+  Function *Caller = CS.getCaller();
+  Function *Callee = CS.getCalledFunction();
+  SmallVector<uintptr_t, 8> Pattern;
+  computeArgPattern(CS, Caller->getParent()->getDataLayout(), Pattern);
+  unsigned CallerVersion = FunctionVersions.lookup(Caller);
+  unsigned CalleeVersion = FunctionVersions.lookup(Callee);
+
+  // Entries computed against an older version of the caller or callee are
+  // simply never matched again; the whole cache is dropped after each SCC.
+  SmallVectorImpl<CachedInlineCost> &Entries =
+      InlineCostCache[std::make_pair(Caller, Callee)];
+  for (const CachedInlineCost &Entry : Entries)
+    if (Entry.CallerVersion == CallerVersion &&
+        Entry.CalleeVersion == CalleeVersion && Entry.ArgPattern == Pattern) {
+      ++NumInlineCostCacheHits;
+      return Entry.Cost;
+    }
+
+  ++NumInlineCostCacheMisses;
+  InlineCost IC = getInlineCost(CS);
+  Entries.push_back(CachedInlineCost{Pattern, CallerVersion, CalleeVersion, IC});
+  return IC;
+}
+
 /// Return true if the inliner should attempt to inline at the given CallSite.
 bool Inliner::shouldInline(CallSite CS) {
-  InlineCost IC = getInlineCost(CS);
+  InlineCost IC = getCachedInlineCost(CS);
   
   if (IC.isAlways()) {
     DEBUG(dbgs() << "    Inlining: cost=always"
@@ -367,7 +450,7 @@ bool Inliner::shouldInline(CallSite CS) {
         continue;
       }
 
-      InlineCost IC2 = getInlineCost(CS2);
+      InlineCost IC2 = getCachedInlineCost(CS2);
       ++NumCallerCallersAnalyzed;
       if (!IC2) {
         callerWillBeRemoved = false;
@@ -494,12 +577,46 @@ bool Inliner::runOnSCC(CallGraphSCC &SCC) {
   InlinedArrayAllocasTy InlinedArrayAllocas;
   InlineFunctionInfo InlineInfo(&CG, AA, ACT);
 
+  // The round in which each function last had its body or use list changed,
+  // and the round in which each pending call site was last considered. A call
+  // site is only reconsidered when its caller, its callee, or (for the outer
+  // inlining heuristic in shouldInline) one of its caller's callers changed
+  // since; otherwise it would be rejected again for the same reason.
+  DenseMap<Function *, unsigned> LastModifiedRound;
+  DenseMap<Instruction *, unsigned> LastVisitedRound;
+  auto ModifiedSince = [&](Function *F, unsigned Round) {
+    auto I = LastModifiedRound.find(F);
+    return I != LastModifiedRound.end() && I->second >= Round;
+  };
+  auto NeedsVisit = [&](CallSite CS) {
+    auto I = LastVisitedRound.find(CS.getInstruction());
+    if (I == LastVisitedRound.end())
+      return true;
+    unsigned Visited = I->second;
+    Function *Caller = CS.getCaller();
+    if (ModifiedSince(Caller, Visited) ||
+        ModifiedSince(CS.getCalledFunction(), Visited))
+      return true;
+    if (Caller->hasLocalLinkage() || Caller->hasLinkOnceODRLinkage())
+      for (User *U : Caller->users())
+        if (Instruction *UI = dyn_cast<Instruction>(U))
+          if (ModifiedSince(UI->getParent()->getParent(), Visited))
+            return true;
+    return false;
+  };
+  auto MarkModified = [&](Function *F, unsigned Round) {
+    LastModifiedRound[F] = Round;
+    invalidateInlineCosts(F);
+  };
+
   // Now that we have all of the call sites, loop over them and inline them if
   // it looks profitable to do so.
   bool Changed = false;
   bool LocalChange;
+  unsigned Round = 0;
   do {
     LocalChange = false;
+    ++Round;
     // Iterate over the outer loop because inlining functions can cause indirect
     // calls to become direct calls.
     // CallSites may be modified inside so ranged for loop can not be used.
@@ -509,6 +626,12 @@ bool Inliner::runOnSCC(CallGraphSCC &SCC) {
       Function *Caller = CS.getCaller();
       Function *Callee = CS.getCalledFunction();
 
+      if (!NeedsVisit(CS)) {
+        ++NumCallSitesNotRevisited;
+        continue;
+      }
+      LastVisitedRound[CS.getInstruction()] = Round;
+
       // If this call site is dead and it is to a readonly function, we should
       // just delete the call instead of trying to inline it, regardless of
       // size.  This happens because IPSCCP propagates the result out of the
@@ -518,7 +641,11 @@ bool Inliner::runOnSCC(CallGraphSCC &SCC) {
                      << *CS.getInstruction() << "\n");
         // Update the call graph by deleting the edge from Callee to Caller.
         CG[Caller]->removeCallEdgeFor(CS);
+        LastVisitedRound.erase(CS.getInstruction());
         CS.getInstruction()->eraseFromParent();
+        MarkModified(Caller, Round);
+        if (Callee)
+          MarkModified(Callee, Round);
         ++NumCallsDeleted;
       } else {
         // We can only inline direct calls to non-declarations.
@@ -550,6 +677,7 @@ bool Inliner::runOnSCC(CallGraphSCC &SCC) {
         }
 
         // Attempt to inline the function.
+        Instruction *Call = CS.getInstruction();
         if (!InlineCallIfPossible(CS, InlineInfo, InlinedArrayAllocas,
                                   InlineHistoryID, InsertLifetime)) {
           emitOptimizationRemarkMissed(CallerCtx, DEBUG_TYPE, *Caller, DLoc,
@@ -559,6 +687,9 @@ bool Inliner::runOnSCC(CallGraphSCC &SCC) {
           continue;
         }
         ++NumInlined;
+        LastVisitedRound.erase(Call);
+        MarkModified(Caller, Round);
+        MarkModified(Callee, Round);
 
         // Report the inline decision.
         emitOptimizationRemark(
@@ -573,8 +704,11 @@ bool Inliner::runOnSCC(CallGraphSCC &SCC) {
           int NewHistoryID = InlineHistory.size();
           InlineHistory.push_back(std::make_pair(Callee, InlineHistoryID));
 
-          for (Value *Ptr : InlineInfo.InlinedCalls)
+          for (Value *Ptr : InlineInfo.InlinedCalls) {
+            // The new call may reuse the memory of an erased one.
+            LastVisitedRound.erase(cast<Instruction>(Ptr));
             CallSites.push_back(std::make_pair(CallSite(Ptr), NewHistoryID));
+          }
         }
       }
       
@@ -617,6 +751,10 @@ bool Inliner::runOnSCC(CallGraphSCC &SCC) {
     }
   } while (LocalChange);
 
+  // The functions in this SCC are about to be changed by the rest of the
+  // CGSCC pipeline, so nothing cached here can be trusted for the next SCC.
+  InlineCostCache.clear();
+  FunctionVersions.clear();
   return Changed;
 }
 
@@ -32,6 +32,17 @@
 // overridable, we move the functionality into a new internal function and
 // leave two overridable thunks to it.
 //
+// Before any comparison is made every function gets a cheap structural hash
+// (its CFG-ordered opcode sequence). Equal functions always have equal
+// hashes, so functions with a unique hash are never inserted into the tree,
+// and the tree orders by hash before falling back to a full comparison.
+//
+// With -mergefunc-parametric, functions that are left after exact merging
+// and differ only in some constant or global operands are merged too: one
+// copy of the body takes the differing values as extra parameters, and the
+// originals become thunks passing their own values. This is only done when
+// the size model says the thunks cost less than the bodies they replace.
+//
 //===----------------------------------------------------------------------===//
 //
 // Future work:
@@ -84,7 +95,9 @@
 #include "llvm/Transforms/IPO.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/FoldingSet.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/IR/CallSite.h"
@@ -93,6 +106,7 @@
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/InlineAsm.h"
 #include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Operator.h"
@@ -102,6 +116,8 @@
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
 #include <vector>
 using namespace llvm;
 
@@ -111,6 +127,10 @@ STATISTIC(NumFunctionsMerged, "Number of functions merged");
 STATISTIC(NumThunksWritten, "Number of thunks generated");
 STATISTIC(NumAliasesWritten, "Number of aliases generated");
 STATISTIC(NumDoubleWeak, "Number of new functions created");
+STATISTIC(NumParametricMerged,
+          "Number of functions merged by passing differing constants");
+STATISTIC(NumParametricParams,
+          "Number of parameters added by parametric merging");
 
 static cl::opt<unsigned> NumFunctionsForSanityCheck(
     "mergefunc-sanity",
@@ -119,6 +139,17 @@ static cl::opt<unsigned> NumFunctionsForSanityCheck(
              "'0' disables this check. Works only with '-debug' key."),
     cl::init(0), cl::Hidden);
 
+static cl::opt<bool> ParametricMerge(
+    "mergefunc-parametric",
+    cl::desc("Merge functions that differ only in constant or global "
+             "operands by passing the differing values as parameters"),
+    cl::init(false), cl::Hidden);
+
+static cl::opt<unsigned> ParametricMaxParams(
+    "mergefunc-parametric-max-params",
+    cl::desc("Maximum number of parameters parametric merging may add"),
+    cl::init(4), cl::Hidden);
+
 namespace {
 
 /// FunctionComparator - Compares two functions to determine whether or not
@@ -133,6 +164,13 @@ public:
   /// Test whether the two functions have equivalent behaviour.
   int compare();
 
+  typedef uint64_t FunctionHash;
+
+  /// Hash a function. Equivalent functions hash equally, but unequal functions
+  /// may also hash equally. The hash only covers the CFG-ordered sequence of
+  /// opcodes, so it is cheap to compute.
+  static FunctionHash functionHash(Function &F);
+
 private:
   /// Test whether two basic blocks have equivalent behaviour.
   int compare(const BasicBlock *BBL, const BasicBlock *BBR);
@@ -390,10 +428,14 @@ private:
 
 class FunctionNode {
   mutable AssertingVH<Function> F;
+  FunctionComparator::FunctionHash Hash;
 
 public:
-  FunctionNode(Function *F) : F(F) {}
+  // Note the hash is recalculated potentially multiple times, but it is cheap.
+  FunctionNode(Function *F)
+      : F(F), Hash(FunctionComparator::functionHash(*F)) {}
   Function *getFunc() const { return F; }
+  FunctionComparator::FunctionHash getHash() const { return Hash; }
 
   /// Replace the reference to the function F by the function G, assuming their
   /// implementations are equal.
@@ -406,6 +448,9 @@ public:
 
   void release() { F = 0; }
   bool operator<(const FunctionNode &RHS) const {
+    // Order first by hashes, then full function comparison.
+    if (Hash != RHS.Hash)
+      return Hash < RHS.Hash;
     return (FunctionComparator(F, RHS.getFunc()).compare()) == -1;
   }
 };
@@ -1073,6 +1118,33 @@ int FunctionComparator::compare() {
   return 0;
 }
 
+// Accumulate the hash of a function's structure: the number of arguments and
+// the sequence of opcodes, visiting blocks in the same order as compare().
+FunctionComparator::FunctionHash FunctionComparator::functionHash(Function &F) {
+  hash_code H = hash_combine(F.isVarArg(), F.arg_size());
+
+  SmallVector<const BasicBlock *, 8> BBs;
+  SmallSet<const BasicBlock *, 16> VisitedBBs;
+  BBs.push_back(&F.getEntryBlock());
+  VisitedBBs.insert(BBs[0]);
+  while (!BBs.empty()) {
+    const BasicBlock *BB = BBs.pop_back_val();
+    // Mark the block boundary, otherwise the partition of opcodes into blocks
+    // would not affect the hash, only their order.
+    H = hash_combine(H, BB->size());
+    for (const Instruction &Inst : *BB)
+      H = hash_combine(H, Inst.getOpcode());
+
+    const TerminatorInst *Term = BB->getTerminator();
+    for (unsigned i = 0, e = Term->getNumSuccessors(); i != e; ++i) {
+      if (!VisitedBBs.insert(Term->getSuccessor(i)).second)
+        continue;
+      BBs.push_back(Term->getSuccessor(i));
+    }
+  }
+  return H;
+}
+
 namespace {
 
 /// MergeFunctions finds functions which will generate identical machine code,
@@ -1135,6 +1207,22 @@ private:
   /// Replace function F with function G in the function tree.
   void replaceFunctionInTree(FnTreeType::iterator &IterToF, Function *G);
 
+  /// Merge functions that are equal up to some constant or global operands
+  /// into one body that takes the differing values as parameters. Runs after
+  /// exact merging has finished. See -mergefunc-parametric.
+  bool mergeParametric(Module &M);
+
+  /// Try to merge the first function of Bucket with as many of the others as
+  /// the size model allows. Removes every function it merged, or the first
+  /// one if nothing was merged, from Bucket.
+  bool mergeParametricGroup(SmallVectorImpl<Function *> &Bucket);
+
+  /// Replace G with a call to MF passing G's arguments followed by ExtraArgs.
+  /// Direct calls of an internal G are rewritten to call MF, otherwise G
+  /// becomes a thunk. Deletes G.
+  void writeParametricThunk(Function *MF, Function *G,
+                            ArrayRef<Constant *> ExtraArgs);
+
   /// The set of all distinct functions. Use the insert() and remove() methods
   /// to modify it.
   FnTreeType FnTree;
@@ -1224,13 +1312,45 @@ bool MergeFunctions::doSanityCheck(std::vector<WeakVH> &Worklist) {
   return true;
 }
 
+/// Return the functions of M that MergeFunctions may fold, sorted by their
+/// structural hash so that candidates for merging are adjacent.
+static void collectHashedFunctions(
+    Module &M,
+    std::vector<std::pair<FunctionComparator::FunctionHash, Function *> >
+        &HashedFuncs) {
+  for (Function &Func : M)
+    if (!Func.isDeclaration() && !Func.hasAvailableExternallyLinkage())
+      HashedFuncs.push_back(
+          std::make_pair(FunctionComparator::functionHash(Func), &Func));
+  std::stable_sort(
+      HashedFuncs.begin(), HashedFuncs.end(),
+      [](const std::pair<FunctionComparator::FunctionHash, Function *> &A,
+         const std::pair<FunctionComparator::FunctionHash, Function *> &B) {
+        return A.first < B.first;
+      });
+}
+
 bool MergeFunctions::runOnModule(Module &M) {
   bool Changed = false;
 
-  for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I) {
-    if (!I->isDeclaration() && !I->hasAvailableExternallyLinkage())
-      Deferred.push_back(WeakVH(I));
+  // All functions in the module, ordered by hash. Functions with a unique
+  // hash value are easily eliminated.
+  std::vector<std::pair<FunctionComparator::FunctionHash, Function *> >
+      HashedFuncs;
+  collectHashedFunctions(M, HashedFuncs);
+  SmallPtrSet<Function *, 32> SharedHash;
+  for (auto I = HashedFuncs.begin(), IE = HashedFuncs.end(); I != IE; ++I) {
+    // If the hash value matches the previous value or the next one, we must
+    // consider merging it. Otherwise it is dropped and never considered again.
+    if ((I != HashedFuncs.begin() && std::prev(I)->first == I->first) ||
+        (std::next(I) != IE && std::next(I)->first == I->first))
+      SharedHash.insert(I->second);
   }
+  // Visit the candidates in module order, so that which function of a pair
+  // is kept, and the order thunks are created in, do not depend on the hash.
+  for (Function &Func : M)
+    if (SharedHash.count(&Func))
+      Deferred.push_back(WeakVH(&Func));
 
   do {
     std::vector<WeakVH> Worklist;
@@ -1271,6 +1391,9 @@ bool MergeFunctions::runOnModule(Module &M) {
 
   FnTree.clear();
 
+  if (ParametricMerge)
+    Changed |= mergeParametric(M);
+
   return Changed;
 }
 
@@ -1440,6 +1563,365 @@ void MergeFunctions::replaceFunctionInTree(FnTreeType::iterator &IterToF,
   IterToF->replaceBy(G);
 }
 
+/// A constant operand of an instruction: the instruction and the operand
+/// number.
+typedef std::pair<Instruction *, unsigned> OperandSlot;
+
+/// Return true if a function may take part in parametric merging. The merged
+/// body gets extra trailing parameters and is reached through thunks, which
+/// rules out anything that cannot be forwarded by a plain call.
+static bool isParametricCandidate(Function &F) {
+  if (F.isDeclaration() || F.hasAvailableExternallyLinkage() ||
+      F.mayBeOverridden() || F.isVarArg() || F.hasPrefixData() ||
+      F.hasPrologueData())
+    return false;
+
+  for (const Argument &A : F.args())
+    if (A.hasByValOrInAllocaAttr())
+      return false;
+
+  for (const BasicBlock &BB : F) {
+    if (BB.hasAddressTaken())
+      return false;
+    for (const Instruction &I : BB) {
+      if (const CallInst *CI = dyn_cast<CallInst>(&I))
+        if (CI->isMustTailCall())
+          return false;
+      if (const IntrinsicInst *II = dyn_cast<IntrinsicInst>(&I))
+        if (II->getIntrinsicID() == Intrinsic::localescape)
+          return false;
+    }
+  }
+  return true;
+}
+
+/// Return true if operand OpNo of I is a constant that could be replaced by
+/// a function argument. Operands which must stay constant, or which codegen
+/// relies on being constant (callees, intrinsic arguments, struct indices,
+/// alloca sizes, case values and shuffle masks), are excluded.
+static bool isParameterizableOperand(const Instruction *I, unsigned OpNo) {
+  const Value *Op = I->getOperand(OpNo);
+  if (!isa<ConstantInt>(Op) && !isa<ConstantFP>(Op) && !isa<GlobalValue>(Op))
+    return false;
+
+  if (isa<AllocaInst>(I) || isa<PHINode>(I) || isa<SwitchInst>(I) ||
+      isa<ShuffleVectorInst>(I) || isa<LandingPadInst>(I) ||
+      isa<IntrinsicInst>(I))
+    return false;
+  if (isa<GetElementPtrInst>(I))
+    return OpNo == 0;
+  if (ImmutableCallSite CS = ImmutableCallSite(I))
+    return !CS.isCallee(&I->getOperandUse(OpNo));
+  return true;
+}
+
+/// Walk F and G in lockstep, in the same CFG order as
+/// FunctionComparator::compare(). Return true if they only differ in
+/// parameterizable operands, appending the slots of F where they differ to
+/// Slots and the corresponding constants of G to GValues.
+static bool findParametricDifferences(Function *F, Function *G,
+                                      SmallVectorImpl<OperandSlot> &Slots,
+                                      SmallVectorImpl<Constant *> &GValues) {
+  if (F->getFunctionType() != G->getFunctionType() ||
+      F->getAttributes() != G->getAttributes() ||
+      F->getCallingConv() != G->getCallingConv() ||
+      F->hasGC() != G->hasGC() ||
+      (F->hasGC() && F->getGC() != G->getGC()) ||
+      StringRef(F->getSection()) != G->getSection() ||
+      F->hasPersonalityFn() != G->hasPersonalityFn() ||
+      (F->hasPersonalityFn() &&
+       F->getPersonalityFn() != G->getPersonalityFn()))
+    return false;
+
+  // Local values must correspond one to one.
+  DenseMap<const Value *, const Value *> FToG, GToF;
+  auto Match = [&](const Value *VF, const Value *VG) {
+    auto IF = FToG.insert(std::make_pair(VF, VG));
+    auto IG = GToF.insert(std::make_pair(VG, VF));
+    return IF.first->second == VG && IG.first->second == VF;
+  };
+
+  for (Function::arg_iterator AF = F->arg_begin(), AG = G->arg_begin(),
+                              AE = F->arg_end();
+       AF != AE; ++AF, ++AG)
+    Match(AF, AG);
+
+  SmallVector<std::pair<BasicBlock *, BasicBlock *>, 8> Worklist;
+  SmallPtrSet<BasicBlock *, 16> VisitedBBs;
+  Worklist.push_back(std::make_pair(&F->getEntryBlock(), &G->getEntryBlock()));
+  VisitedBBs.insert(&F->getEntryBlock());
+  Match(&F->getEntryBlock(), &G->getEntryBlock());
+  while (!Worklist.empty()) {
+    BasicBlock *BBF = Worklist.back().first;
+    BasicBlock *BBG = Worklist.back().second;
+    Worklist.pop_back();
+    if (BBF->size() != BBG->size())
+      return false;
+
+    for (BasicBlock::iterator IF = BBF->begin(), IG = BBG->begin(),
+                              IE = BBF->end();
+         IF != IE; ++IF, ++IG) {
+      if (!IF->isSameOperationAs(IG) || !Match(IF, IG))
+        return false;
+
+      SmallVector<std::pair<unsigned, MDNode *>, 4> MDF, MDG;
+      IF->getAllMetadataOtherThanDebugLoc(MDF);
+      IG->getAllMetadataOtherThanDebugLoc(MDG);
+      if (MDF != MDG)
+        return false;
+
+      for (unsigned i = 0, e = IF->getNumOperands(); i != e; ++i) {
+        Value *OpF = IF->getOperand(i);
+        Value *OpG = IG->getOperand(i);
+        bool LocalF = isa<Argument>(OpF) || isa<Instruction>(OpF) ||
+                      isa<BasicBlock>(OpF);
+        bool LocalG = isa<Argument>(OpG) || isa<Instruction>(OpG) ||
+                      isa<BasicBlock>(OpG);
+        if (LocalF || LocalG) {
+          if (LocalF != LocalG || !Match(OpF, OpG))
+            return false;
+          continue;
+        }
+        if (OpF == OpG)
+          continue;
+        if (OpF->getType() != OpG->getType() ||
+            !isParameterizableOperand(IF, i) ||
+            !isParameterizableOperand(IG, i))
+          return false;
+        Slots.push_back(OperandSlot(IF, i));
+        GValues.push_back(cast<Constant>(OpG));
+      }
+    }
+
+    TerminatorInst *TermF = BBF->getTerminator();
+    TerminatorInst *TermG = BBG->getTerminator();
+    for (unsigned i = 0, e = TermF->getNumSuccessors(); i != e; ++i) {
+      if (!VisitedBBs.insert(TermF->getSuccessor(i)).second)
+        continue;
+      Worklist.push_back(
+          std::make_pair(TermF->getSuccessor(i), TermG->getSuccessor(i)));
+    }
+  }
+  return true;
+}
+
+bool MergeFunctions::mergeParametric(Module &M) {
+  std::vector<std::pair<FunctionComparator::FunctionHash, Function *> >
+      HashedFuncs;
+  collectHashedFunctions(M, HashedFuncs);
+
+  DenseMap<const Function *, unsigned> ModuleIndex;
+  unsigned Index = 0;
+  for (Function &F : M)
+    ModuleIndex[&F] = Index++;
+
+  // Functions differing only in operands have the same opcode sequence and
+  // therefore the same hash, so only functions within a bucket are compared.
+  std::vector<SmallVector<Function *, 8> > Buckets;
+  for (auto I = HashedFuncs.begin(), E = HashedFuncs.end(); I != E;) {
+    SmallVector<Function *, 8> Bucket;
+    auto BucketEnd = I;
+    for (; BucketEnd != E && BucketEnd->first == I->first; ++BucketEnd)
+      if (isParametricCandidate(*BucketEnd->second))
+        Bucket.push_back(BucketEnd->second);
+    I = BucketEnd;
+    if (Bucket.size() > 1)
+      Buckets.push_back(std::move(Bucket));
+  }
+
+  // The merged functions are added to the module as the buckets are visited;
+  // visit them in the order of their first member so that the output does not
+  // depend on the hash values.
+  std::stable_sort(Buckets.begin(), Buckets.end(),
+                   [&](const SmallVector<Function *, 8> &A,
+                       const SmallVector<Function *, 8> &B) {
+                     return ModuleIndex[A.front()] < ModuleIndex[B.front()];
+                   });
+
+  bool Changed = false;
+  for (SmallVectorImpl<Function *> &Bucket : Buckets)
+    while (Bucket.size() > 1)
+      Changed |= mergeParametricGroup(Bucket);
+  return Changed;
+}
+
+bool MergeFunctions::mergeParametricGroup(SmallVectorImpl<Function *> &Bucket) {
+  Function *Base = Bucket.front();
+
+  // The members merged so far, and for each of them the slots of Base where
+  // it differs together with its values there. Base itself has no
+  // differences.
+  SmallVector<Function *, 8> Members(1, Base);
+  SmallVector<SmallVector<OperandSlot, 4>, 8> MemberSlots(1);
+  SmallVector<SmallVector<Constant *, 4>, 8> MemberValues(1);
+
+  // Each new parameter covers the slots whose values agree for every member.
+  // Params holds the per-member values of a parameter, ParamSlots its slots.
+  std::vector<std::vector<Constant *> > Params;
+  std::vector<SmallVector<OperandSlot, 4> > ParamSlots;
+  auto ComputeParams = [&]() {
+    Params.clear();
+    ParamSlots.clear();
+    SmallVector<OperandSlot, 8> AllSlots;
+    for (const auto &Slots : MemberSlots)
+      for (const OperandSlot &Slot : Slots)
+        if (std::find(AllSlots.begin(), AllSlots.end(), Slot) == AllSlots.end())
+          AllSlots.push_back(Slot);
+
+    for (const OperandSlot &Slot : AllSlots) {
+      std::vector<Constant *> Values;
+      for (unsigned m = 0, e = Members.size(); m != e; ++m) {
+        auto It = std::find(MemberSlots[m].begin(), MemberSlots[m].end(), Slot);
+        Values.push_back(
+            It == MemberSlots[m].end()
+                ? cast<Constant>(Slot.first->getOperand(Slot.second))
+                : MemberValues[m][It - MemberSlots[m].begin()]);
+      }
+      auto P = std::find(Params.begin(), Params.end(), Values);
+      if (P == Params.end()) {
+        Params.push_back(Values);
+        ParamSlots.emplace_back();
+        P = Params.end() - 1;
+      }
+      ParamSlots[P - Params.begin()].push_back(Slot);
+    }
+  };
+
+  for (unsigned i = 1; i != Bucket.size(); ++i) {
+    SmallVector<OperandSlot, 4> Slots;
+    SmallVector<Constant *, 4> Values;
+    if (!findParametricDifferences(Base, Bucket[i], Slots, Values))
+      continue;
+    Members.push_back(Bucket[i]);
+    MemberSlots.push_back(Slots);
+    MemberValues.push_back(Values);
+    ComputeParams();
+    if (Params.size() > ParametricMaxParams) {
+      Members.pop_back();
+      MemberSlots.pop_back();
+      MemberValues.pop_back();
+    }
+  }
+  ComputeParams();
+
+  // Size model: every member still costs a call passing the extra values and
+  // a return, in exchange for all but one copy of the body going away.
+  unsigned BodySize = 0;
+  for (const BasicBlock &BB : *Base)
+    BodySize += BB.size();
+  unsigned NumMembers = Members.size();
+  unsigned OldSize = NumMembers * BodySize;
+  unsigned NewSize = BodySize + NumMembers * (Params.size() + 2);
+  if (NumMembers < 2 || Params.empty() || NewSize >= OldSize) {
+    DEBUG(dbgs() << "Not merging " << Base->getName()
+                 << " parametrically: " << NumMembers << " functions, "
+                 << Params.size() << " parameters\n");
+    Bucket.erase(Bucket.begin());
+    return false;
+  }
+
+  // Clone Base's body into a new internal function with one extra parameter
+  // per set of differing operands.
+  FunctionType *FTy = Base->getFunctionType();
+  SmallVector<Type *, 8> ParamTys(FTy->param_begin(), FTy->param_end());
+  for (const auto &Values : Params)
+    ParamTys.push_back(Values.front()->getType());
+  FunctionType *MTy =
+      FunctionType::get(FTy->getReturnType(), ParamTys, /*isVarArg=*/false);
+  Function *MF = Function::Create(MTy, GlobalValue::InternalLinkage,
+                                  Base->getName() + ".merged",
+                                  Base->getParent());
+
+  ValueToValueMapTy VMap;
+  Function::arg_iterator NewArg = MF->arg_begin();
+  for (Argument &A : Base->args()) {
+    NewArg->setName(A.getName());
+    VMap[&A] = NewArg++;
+  }
+  SmallVector<ReturnInst *, 4> Returns;
+  CloneFunctionInto(MF, Base, VMap, /*ModuleLevelChanges=*/false, Returns);
+  MF->setVisibility(GlobalValue::DefaultVisibility);
+  MF->setDLLStorageClass(GlobalValue::DefaultStorageClass);
+  MF->setUnnamedAddr(true);
+
+  for (unsigned p = 0, e = Params.size(); p != e; ++p, ++NewArg) {
+    NewArg->setName("merged.arg");
+    for (const OperandSlot &Slot : ParamSlots[p])
+      cast<Instruction>(VMap[Slot.first])->setOperand(Slot.second, NewArg);
+  }
+  NumParametricParams += Params.size();
+
+  DEBUG(dbgs() << "Merging " << NumMembers << " functions into "
+               << MF->getName() << " with " << Params.size()
+               << " extra parameters\n");
+  for (unsigned m = 0; m != NumMembers; ++m) {
+    SmallVector<Constant *, 4> ExtraArgs;
+    for (const auto &Values : Params)
+      ExtraArgs.push_back(Values[m]);
+    Bucket.erase(std::find(Bucket.begin(), Bucket.end(), Members[m]));
+    writeParametricThunk(MF, Members[m], ExtraArgs);
+    ++NumParametricMerged;
+  }
+  return true;
+}
+
+void MergeFunctions::writeParametricThunk(Function *MF, Function *G,
+                                          ArrayRef<Constant *> ExtraArgs) {
+  // The function tree is no longer in use at this point, so unlike
+  // writeThunk there is no need to remove G's users from it.
+  if (G->hasLocalLinkage()) {
+    for (auto UI = G->use_begin(), UE = G->use_end(); UI != UE;) {
+      Use *U = &*UI;
+      ++UI;
+      CallInst *CI = dyn_cast<CallInst>(U->getUser());
+      if (!CI || !CallSite(CI).isCallee(U))
+        continue;
+
+      SmallVector<Value *, 16> Args(CI->arg_operands().begin(),
+                                    CI->arg_operands().end());
+      Args.append(ExtraArgs.begin(), ExtraArgs.end());
+      CallInst *NewCI = CallInst::Create(MF, Args, "", CI);
+      NewCI->takeName(CI);
+      NewCI->setCallingConv(CI->getCallingConv());
+      NewCI->setAttributes(CI->getAttributes());
+      NewCI->setTailCallKind(CI->getTailCallKind());
+      NewCI->setDebugLoc(CI->getDebugLoc());
+      CI->replaceAllUsesWith(NewCI);
+      CI->eraseFromParent();
+    }
+    if (G->use_empty()) {
+      G->eraseFromParent();
+      return;
+    }
+  }
+
+  Function *NewG = Function::Create(G->getFunctionType(), G->getLinkage(), "",
+                                    G->getParent());
+  BasicBlock *BB = BasicBlock::Create(G->getContext(), "", NewG);
+  IRBuilder<false> Builder(BB);
+
+  SmallVector<Value *, 16> Args;
+  for (Argument &A : NewG->args())
+    Args.push_back(&A);
+  Args.append(ExtraArgs.begin(), ExtraArgs.end());
+
+  CallInst *CI = Builder.CreateCall(MF, Args);
+  CI->setTailCall();
+  CI->setCallingConv(MF->getCallingConv());
+  if (NewG->getReturnType()->isVoidTy())
+    Builder.CreateRetVoid();
+  else
+    Builder.CreateRet(CI);
+
+  NewG->copyAttributesFrom(G);
+  NewG->takeName(G);
+  G->replaceAllUsesWith(NewG);
+  G->eraseFromParent();
+
+  DEBUG(dbgs() << "writeParametricThunk: " << NewG->getName() << '\n');
+  ++NumThunksWritten;
+}
+
 // Insert a ComparableFunction into the FnTree, or merge it away if equal to one
 // that was already inserted.
 bool MergeFunctions::insert(Function *NewFunction) {
@@ -59,6 +59,10 @@ static cl::opt<bool>
 RunLoopRerolling("reroll-loops", cl::Hidden,
                  cl::desc("Run the loop rerolling pass"));
 
+static cl::opt<bool>
+RunGlobalReorder("enable-global-reorder", cl::init(false), cl::Hidden,
+                 cl::desc("Lay out globals by access affinity"));
+
 static cl::opt<bool>
 RunFloat2Int("float-to-int", cl::Hidden, cl::init(true),
              cl::desc("Run the float2int (float demotion) pass"));
@@ -81,6 +85,11 @@ static cl::opt<bool>
 EnableMLSM("mlsm", cl::init(true), cl::Hidden,
            cl::desc("Enable motion of merged load and store"));
 
+static cl::opt<bool>
+EnableGVNHoistSink("enable-gvn-hoist-sink", cl::init(true), cl::Hidden,
+                   cl::desc("Hoist and sink equivalent code across branches "
+                            "when optimizing for size"));
+
 static cl::opt<bool> EnableLoopInterchange(
     "enable-loopinterchange", cl::init(false), cl::Hidden,
     cl::desc("Enable the new, experimental LoopInterchange Pass"));
@@ -89,6 +98,14 @@ static cl::opt<bool> EnableLoopDistribute(
     "enable-loop-distribute", cl::init(false), cl::Hidden,
     cl::desc("Enable the new, experimental LoopDistribution Pass"));
 
+static cl::opt<bool> EnableLoopFusion(
+    "enable-loop-fusion", cl::init(false), cl::Hidden,
+    cl::desc("Enable the new, experimental LoopFusion Pass"));
+
+static cl::opt<bool> EnableLoopVersioningLICM(
+    "enable-loop-versioning-licm", cl::init(false), cl::Hidden,
+    cl::desc("Enable versioning loops with run-time alias checks for LICM"));
+
 PassManagerBuilder::PassManagerBuilder() {
     OptLevel = 2;
     SizeLevel = 0;
@@ -261,6 +278,8 @@ void PassManagerBuilder::populateModulePassManager(
     if (EnableMLSM)
       MPM.add(createMergedLoadStoreMotionPass()); // Merge ld/st in diamonds
     MPM.add(createGVNPass(DisableGVNLoadPRE));  // Remove redundancies
+    if (SizeLevel > 0 && EnableGVNHoistSink)
+      MPM.add(createGVNHoistSinkPass());        // Merge code across branches
   }
   MPM.add(createMemCpyOptPass());             // Remove memcpy / form memset
   MPM.add(createSCCPPass());                  // Constant prop with SCCP
@@ -323,6 +342,18 @@ void PassManagerBuilder::populateModulePassManager(
   // on the rotated form. Disable header duplication at -Oz.
   MPM.add(createLoopRotatePass(SizeLevel == 2 ? 0 : -1));
 
+  // Version loops whose invariant loads are only kept in the loop by possible
+  // aliasing, and hoist the loads out of the checked copy.
+  if (EnableLoopVersioningLICM) {
+    MPM.add(createLoopVersioningLICMPass());
+    MPM.add(createLICMPass());
+  }
+
+  // Fuse adjacent loops over the same iteration space, so that values passed
+  // between them through memory can be reused before they leave the cache.
+  if (EnableLoopFusion)
+    MPM.add(createLoopFusionPass());
+
   // Distribute loops to allow partial vectorization.  I.e. isolate dependences
   // into separate loop that would otherwise inhibit vectorization.
   if (EnableLoopDistribute)
@@ -415,6 +446,10 @@ void PassManagerBuilder::populateModulePassManager(
       }
       MPM.add(createGlobalDCEPass());         // Remove dead fns and globals.
       MPM.add(createConstantMergePass());     // Merge dup global constants
+
+      // Lay out globals once they are final, unless LTO will see them again.
+      if (RunGlobalReorder && !PrepareForLTO)
+        MPM.add(createGlobalReorderPass());
     }
   }
 
@@ -527,6 +562,10 @@ void PassManagerBuilder::addLateLTOOptimizationPasses(
   // Now that we have optimized the program, discard unreachable functions.
   PM.add(createGlobalDCEPass());
 
+  // With the whole program visible, lay out globals by access affinity.
+  if (RunGlobalReorder)
+    PM.add(createGlobalReorderPass());
+
   // FIXME: this is profitable (for compiler time) to do at -O0 too, but
   // currently it damages debug info.
   if (MergeFunctions)
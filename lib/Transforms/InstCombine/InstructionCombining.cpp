@@ -50,6 +50,7 @@
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/IR/CFG.h"
 #include "llvm/IR/DataLayout.h"
+#include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/IR/Dominators.h"
 #include "llvm/IR/GetElementPtrTypeIterator.h"
 #include "llvm/IR/IntrinsicInst.h"
@@ -57,6 +58,9 @@
 #include "llvm/IR/ValueHandle.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/Utils/Local.h"
@@ -74,6 +78,70 @@ STATISTIC(NumSunkInst , "Number of instructions sunk");
 STATISTIC(NumExpand,    "Number of expansions");
 STATISTIC(NumFactor   , "Number of factorizations");
 STATISTIC(NumReassoc  , "Number of reassociations");
+STATISTIC(NumIterations, "Number of instcombine iterations performed");
+STATISTIC(NumMaxIterationsHit,
+          "Number of functions where the iteration limit was reached");
+
+static cl::opt<unsigned>
+MaxIterations("instcombine-max-iterations", cl::init(1000), cl::Hidden,
+              cl::desc("Maximum number of times instcombine revisits a "
+                       "function before giving up on reaching a fixpoint"));
+
+static cl::opt<bool>
+RevisitChangedOnly("instcombine-revisit-changed-only", cl::init(false),
+                   cl::Hidden,
+                   cl::desc("After the first iteration, only revisit "
+                            "instructions that were changed or use a changed "
+                            "value instead of the whole function"));
+
+static cl::opt<bool>
+CollectVisitorStats("instcombine-stats", cl::init(false), cl::Hidden,
+                    cl::desc("Print per-opcode visit counts, combine counts "
+                             "and time spent in instcombine visitors"));
+
+namespace {
+/// VisitorStats - Per-opcode counters collected under -instcombine-stats and
+/// printed when the process shuts down, next to the regular statistics.
+struct VisitorStats {
+  struct Entry {
+    uint64_t Visits;
+    uint64_t Hits;
+    double Time;
+  };
+  Entry Entries[Instruction::OtherOpsEnd];
+
+  VisitorStats() { memset(Entries, 0, sizeof(Entries)); }
+  ~VisitorStats() { print(); }
+  void print();
+};
+}
+
+static ManagedStatic<VisitorStats> VisitorStatsInfo;
+
+namespace llvm { extern raw_ostream *CreateInfoOutputFile(); }
+
+void VisitorStats::print() {
+  uint64_t TotalVisits = 0;
+  for (const Entry &E : Entries)
+    TotalVisits += E.Visits;
+  if (!TotalVisits)
+    return;
+
+  std::unique_ptr<raw_ostream> OS(CreateInfoOutputFile());
+  *OS << "===" << std::string(73, '-') << "===\n"
+      << "                     ... InstCombine Visitor Statistics ...\n"
+      << "===" << std::string(73, '-') << "===\n\n"
+      << "      Visits        Hits    Time (s)  Opcode\n";
+  for (unsigned Op = 0; Op != Instruction::OtherOpsEnd; ++Op) {
+    const Entry &E = Entries[Op];
+    if (!E.Visits)
+      continue;
+    *OS << format("%12" PRIu64 "%12" PRIu64 "%12.4f  %s\n", E.Visits, E.Hits,
+                  E.Time, Instruction::getOpcodeName(Op));
+  }
+  *OS << '\n';
+  OS->flush();
+}
 
 Value *InstCombiner::EmitGEPOffset(User *GEP) {
   return llvm::EmitGEPOffset(Builder, DL, GEP);
@@ -2747,7 +2815,20 @@ bool InstCombiner::run() {
     DEBUG(raw_string_ostream SS(OrigI); I->print(SS); OrigI = SS.str(););
     DEBUG(dbgs() << "IC: Visiting: " << OrigI << '\n');
 
-    if (Instruction *Result = visit(*I)) {
+    Instruction *Result;
+    if (CollectVisitorStats) {
+      VisitorStats::Entry &E = VisitorStatsInfo->Entries[I->getOpcode()];
+      double Start = TimeRecord::getCurrentTime(true).getProcessTime();
+      Result = visit(*I);
+      E.Time += TimeRecord::getCurrentTime(false).getProcessTime() - Start;
+      ++E.Visits;
+      if (Result)
+        ++E.Hits;
+    } else {
+      Result = visit(*I);
+    }
+
+    if (Result) {
       ++NumCombined;
       // Should we replace the old instruction with a new one?
       if (Result != I) {
@@ -2810,16 +2891,21 @@ bool InstCombiner::run() {
 /// many instructions are dead or constant).  Additionally, if we find a branch
 /// whose condition is a known constant, we only visit the reachable successors.
 ///
+/// If \p OnlyTouched is set, the cleanup still covers the whole function but
+/// only instructions the worklist recorded as touched during the previous
+/// iteration, and users of values folded here, are queued for combining.
 static bool AddReachableCodeToWorklist(BasicBlock *BB, const DataLayout &DL,
                                        SmallPtrSetImpl<BasicBlock *> &Visited,
                                        InstCombineWorklist &ICWorklist,
-                                       const TargetLibraryInfo *TLI) {
+                                       const TargetLibraryInfo *TLI,
+                                       bool OnlyTouched) {
   bool MadeIRChange = false;
   SmallVector<BasicBlock*, 256> Worklist;
   Worklist.push_back(BB);
 
   SmallVector<Instruction*, 128> InstrsForInstCombineWorklist;
   DenseMap<ConstantExpr*, Constant*> FoldedConstants;
+  SmallPtrSet<Instruction*, 16> UsersOfFolded;
 
   do {
     BB = Worklist.pop_back_val();
@@ -2845,6 +2931,9 @@ static bool AddReachableCodeToWorklist(BasicBlock *BB, const DataLayout &DL,
         if (Constant *C = ConstantFoldInstruction(Inst, DL, TLI)) {
           DEBUG(dbgs() << "IC: ConstFold to: " << *C << " from: "
                        << *Inst << '\n');
+          if (OnlyTouched)
+            for (User *U : Inst->users())
+              UsersOfFolded.insert(cast<Instruction>(U));
           Inst->replaceAllUsesWith(C);
           ++NumConstProp;
           Inst->eraseFromParent();
@@ -2870,7 +2959,9 @@ static bool AddReachableCodeToWorklist(BasicBlock *BB, const DataLayout &DL,
         }
       }
 
-      InstrsForInstCombineWorklist.push_back(Inst);
+      if (!OnlyTouched || ICWorklist.isTouched(Inst) ||
+          UsersOfFolded.count(Inst))
+        InstrsForInstCombineWorklist.push_back(Inst);
     }
 
     // Recursively visit successors.  If this is a branch or switch on a
@@ -2909,7 +3000,7 @@ static bool AddReachableCodeToWorklist(BasicBlock *BB, const DataLayout &DL,
   // of the function down.  This jives well with the way that it adds all uses
   // of instructions to the worklist after doing a transformation, thus avoiding
   // some N^2 behavior in pathological cases.
-  ICWorklist.AddInitialGroup(&InstrsForInstCombineWorklist[0],
+  ICWorklist.AddInitialGroup(InstrsForInstCombineWorklist.data(),
                              InstrsForInstCombineWorklist.size());
 
   return MadeIRChange;
@@ -2922,7 +3013,8 @@ static bool AddReachableCodeToWorklist(BasicBlock *BB, const DataLayout &DL,
 /// the combiner itself run much faster.
 static bool prepareICWorklistFromFunction(Function &F, const DataLayout &DL,
                                           TargetLibraryInfo *TLI,
-                                          InstCombineWorklist &ICWorklist) {
+                                          InstCombineWorklist &ICWorklist,
+                                          bool OnlyTouched) {
   bool MadeIRChange = false;
 
   // Do a depth-first traversal of the function, populate the worklist with
@@ -2930,7 +3022,8 @@ static bool prepareICWorklistFromFunction(Function &F, const DataLayout &DL,
   // track of which blocks we visit.
   SmallPtrSet<BasicBlock *, 64> Visited;
   MadeIRChange |=
-      AddReachableCodeToWorklist(F.begin(), DL, Visited, ICWorklist, TLI);
+      AddReachableCodeToWorklist(F.begin(), DL, Visited, ICWorklist, TLI,
+                                 OnlyTouched);
 
   // Do a quick scan over the function.  If we find any blocks that are
   // unreachable, remove any instructions inside of them.  This prevents
@@ -2979,29 +3072,48 @@ combineInstructionsOverFunction(Function &F, InstCombineWorklist &Worklist,
 
   // Lower dbg.declare intrinsics otherwise their value may be clobbered
   // by instcombiner.
-  bool DbgDeclaresChanged = LowerDbgDeclare(F);
+  bool MadeIRChange = LowerDbgDeclare(F);
 
   // Iterate while there is work to do.
-  int Iteration = 0;
+  unsigned Iteration = 0;
   for (;;) {
+    if (Iteration == MaxIterations) {
+      ++NumMaxIterationsHit;
+      DEBUG(dbgs() << "\n\nINSTCOMBINE ITERATION LIMIT REACHED on "
+                   << F.getName() << "\n");
+      emitOptimizationRemarkAnalysis(
+          F.getContext(), DEBUG_TYPE, F, DebugLoc(),
+          "iteration limit of " + Twine(MaxIterations) +
+              " reached before instcombine found a fixpoint");
+      break;
+    }
+
     ++Iteration;
+    ++NumIterations;
     DEBUG(dbgs() << "\n\nINSTCOMBINE ITERATION #" << Iteration << " on "
                  << F.getName() << "\n");
 
+    // Every iteration after the first only has to look at what the previous
+    // one changed, if the user asked for that.
+    bool OnlyTouched = RevisitChangedOnly && Iteration > 1;
     bool Changed = false;
-    if (prepareICWorklistFromFunction(F, DL, &TLI, Worklist))
+    if (prepareICWorklistFromFunction(F, DL, &TLI, Worklist, OnlyTouched))
       Changed = true;
 
+    if (RevisitChangedOnly)
+      Worklist.startTracking();
     InstCombiner IC(Worklist, &Builder, MinimizeSize,
                     AA, &AC, &TLI, &DT, DL, LI);
     if (IC.run())
       Changed = true;
+    Worklist.stopTracking();
 
     if (!Changed)
       break;
+    MadeIRChange = true;
   }
 
-  return DbgDeclaresChanged || Iteration > 1;
+  return MadeIRChange;
 }
 
 PreservedAnalyses InstCombinePass::run(Function &F,
@@ -3017,10 +3129,13 @@ PreservedAnalyses InstCombinePass::run(Function &F,
     // No changes, all analyses are preserved.
     return PreservedAnalyses::all();
 
-  // Mark all the analyses that instcombine updates as preserved.
+  // Mark all the analyses that instcombine updates as preserved. The CFG is
+  // never changed, so the loop structure is preserved as well.
   // FIXME: Need a way to preserve CFG analyses here!
   PreservedAnalyses PA;
+  PA.preserve<AssumptionAnalysis>();
   PA.preserve<DominatorTreeAnalysis>();
+  PA.preserve<LoopAnalysis>();
   return PA;
 }
 
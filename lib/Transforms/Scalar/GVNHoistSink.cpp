@@ -0,0 +1,471 @@
+//===- GVNHoistSink.cpp - Merge equivalent code across branches -----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass merges computations that are performed on both sides of a branch,
+// which removes one copy of each of them.
+//
+// Hoisting: when a block ends in a conditional branch to two distinct
+// successors that both have it as their single predecessor, instructions of
+// the successors that compute the same value are merged into one copy placed
+// before the branch. Instructions are value numbered by opcode, type and
+// operands (commutative operands in canonical order); once a pair has been
+// merged, the instructions using it get equal operands as well, so whole
+// equivalent expression trees are hoisted one level at a time.
+//
+// Sinking: when a block has exactly two predecessors that both end in an
+// unconditional branch to it, equivalent instructions near the ends of the
+// predecessors are merged into one copy at the start of the block. One
+// operand may differ between the copies; it is then routed through a new PHI
+// node, which lets the pass sink chains of computations feeding stores.
+//
+// Loads and stores take part as long as moving them does not change what
+// memory they observe or clobber: hoisting asks MemoryDependenceAnalysis
+// whether the access depends on anything earlier in its block, and sinking
+// asks alias analysis about every instruction it moves across. Nothing that
+// may trap is moved across a call or an instruction that may throw.
+//
+// The transformation does not speed anything up on its own, so it is only
+// scheduled at -Os and -Oz, after GVN has removed full redundancies.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/Scalar.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/MemoryDependenceAnalysis.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/Local.h"
+using namespace llvm;
+
+#define DEBUG_TYPE "gvn-hoist-sink"
+
+STATISTIC(NumHoisted, "Number of instructions hoisted");
+STATISTIC(NumSunk, "Number of instructions sunk");
+STATISTIC(NumLoadsStoresMoved, "Number of loads and stores hoisted or sunk");
+
+static cl::opt<unsigned> MaxSinkScan(
+    "gvn-sink-max-scan", cl::init(32), cl::Hidden,
+    cl::desc("Maximum number of instructions of the other predecessor "
+             "considered as a match when sinking an instruction"));
+
+namespace {
+
+/// A hash table from instructions to the instructions of one block that
+/// compute the same value.
+class ValueTable {
+  DenseMap<unsigned, SmallVector<Instruction *, 2> > Table;
+
+  static unsigned hashInstruction(const Instruction *I);
+
+public:
+  void insert(Instruction *I) { Table[hashInstruction(I)].push_back(I); }
+  void erase(Instruction *I);
+
+  /// The instructions that may be equivalent to I, in program order.
+  ArrayRef<Instruction *> lookup(const Instruction *I) const {
+    auto It = Table.find(hashInstruction(I));
+    if (It == Table.end())
+      return None;
+    return It->second;
+  }
+};
+
+class GVNHoistSink : public FunctionPass {
+  AliasAnalysis *AA;
+  MemoryDependenceAnalysis *MD;
+
+public:
+  static char ID; // Pass identification, replacement for typeid
+  GVNHoistSink() : FunctionPass(ID), AA(nullptr), MD(nullptr) {
+    initializeGVNHoistSinkPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnFunction(Function &F) override;
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.setPreservesCFG();
+    AU.addRequired<AliasAnalysis>();
+    AU.addRequired<MemoryDependenceAnalysis>();
+    AU.addPreserved<AliasAnalysis>();
+    AU.addPreserved<MemoryDependenceAnalysis>();
+  }
+
+private:
+  bool hoistFromSuccessors(BasicBlock *BB);
+  bool sinkFromPredecessors(BasicBlock *BB);
+
+  bool canHoist(Instruction *I, const Instruction *FirstBarrier);
+  bool canSinkToEnd(Instruction *I);
+  bool canSinkPair(Instruction *I1, Instruction *I2, BasicBlock *Succ,
+                   int &DifferingOp, PHINode *&UserPHI);
+  void mergeInto(Instruction *Kept, Instruction *Removed);
+  void removeInstruction(Instruction *I);
+};
+
+} // end anonymous namespace
+
+char GVNHoistSink::ID = 0;
+INITIALIZE_PASS_BEGIN(GVNHoistSink, "gvn-hoist-sink",
+                      "Hoist and sink equivalent code across branches", false,
+                      false)
+INITIALIZE_AG_DEPENDENCY(AliasAnalysis)
+INITIALIZE_PASS_DEPENDENCY(MemoryDependenceAnalysis)
+INITIALIZE_PASS_END(GVNHoistSink, "gvn-hoist-sink",
+                    "Hoist and sink equivalent code across branches", false,
+                    false)
+
+FunctionPass *llvm::createGVNHoistSinkPass() { return new GVNHoistSink(); }
+
+unsigned ValueTable::hashInstruction(const Instruction *I) {
+  SmallVector<const Value *, 4> Ops;
+  for (const Use &Op : I->operands())
+    Ops.push_back(Op.get());
+  if (I->isCommutative() && Ops[0] > Ops[1])
+    std::swap(Ops[0], Ops[1]);
+
+  hash_code H = hash_combine(I->getOpcode(), I->getType(),
+                             hash_combine_range(Ops.begin(), Ops.end()));
+  if (const CmpInst *C = dyn_cast<CmpInst>(I))
+    H = hash_combine(H, C->getPredicate());
+  // Keep clear of DenseMap's reserved keys.
+  return unsigned(size_t(H)) & 0x7fffffff;
+}
+
+void ValueTable::erase(Instruction *I) {
+  auto It = Table.find(hashInstruction(I));
+  if (It == Table.end())
+    return;
+  SmallVectorImpl<Instruction *> &Entries = It->second;
+  Entries.erase(std::remove(Entries.begin(), Entries.end(), I),
+                Entries.end());
+}
+
+/// Return true if I is a kind of instruction the pass may move.
+static bool isCandidate(const Instruction *I) {
+  if (const LoadInst *LI = dyn_cast<LoadInst>(I))
+    return LI->isSimple();
+  if (const StoreInst *SI = dyn_cast<StoreInst>(I))
+    return SI->isSimple();
+  return isa<BinaryOperator>(I) || isa<CastInst>(I) || isa<CmpInst>(I) ||
+         isa<GetElementPtrInst>(I) || isa<SelectInst>(I) ||
+         isa<ExtractElementInst>(I) || isa<InsertElementInst>(I) ||
+         isa<ShuffleVectorInst>(I) || isa<ExtractValueInst>(I) ||
+         isa<InsertValueInst>(I);
+}
+
+/// Return true if execution might not continue past I to the next
+/// instruction in its block.
+static bool isBarrier(const Instruction *I) {
+  return I->mayThrow() || (isa<CallInst>(I) && !isa<DbgInfoIntrinsic>(I));
+}
+
+/// Return true if I1 and I2 compute the same value, ignoring poison-generating
+/// flags, which the merged instruction intersects.
+static bool isEquivalent(const Instruction *I1, const Instruction *I2) {
+  if (I1->isIdenticalToWhenDefined(I2))
+    return true;
+  return I1->isCommutative() && I1->isSameOperationAs(I2) &&
+         I1->getOperand(0) == I2->getOperand(1) &&
+         I1->getOperand(1) == I2->getOperand(0);
+}
+
+void GVNHoistSink::removeInstruction(Instruction *I) {
+  MD->removeInstruction(I);
+  if (LoadInst *LI = dyn_cast<LoadInst>(I))
+    MD->invalidateCachedPointerInfo(LI->getPointerOperand());
+  if (I->getType()->getScalarType()->isPointerTy())
+    MD->invalidateCachedPointerInfo(I);
+  I->eraseFromParent();
+}
+
+/// Merge Removed into Kept, which has been moved to where both used to be
+/// computed.
+void GVNHoistSink::mergeInto(Instruction *Kept, Instruction *Removed) {
+  static const unsigned KnownIDs[] = {
+    LLVMContext::MD_tbaa,
+    LLVMContext::MD_alias_scope,
+    LLVMContext::MD_noalias,
+    LLVMContext::MD_range,
+    LLVMContext::MD_fpmath,
+    LLVMContext::MD_invariant_load,
+  };
+  combineMetadata(Kept, Removed, KnownIDs);
+  Kept->intersectOptionalDataWith(Removed);
+  if (isa<LoadInst>(Kept) || isa<StoreInst>(Kept))
+    ++NumLoadsStoresMoved;
+  Removed->replaceAllUsesWith(Kept);
+  removeInstruction(Removed);
+}
+
+/// Return true if I, which lives in a block with a single predecessor, may be
+/// moved to the end of that predecessor. FirstBarrier is the first
+/// instruction of I's block after which execution might not continue.
+bool GVNHoistSink::canHoist(Instruction *I, const Instruction *FirstBarrier) {
+  BasicBlock *BB = I->getParent();
+  for (const Use &Op : I->operands())
+    if (Instruction *OpI = dyn_cast<Instruction>(Op.get()))
+      if (OpI->getParent() == BB)
+        return false;
+
+  // Executing I before the branch is fine if it would have been executed on
+  // this path anyway, or if it cannot trap.
+  if (FirstBarrier && FirstBarrier->comesBefore(I) &&
+      (I->mayReadOrWriteMemory() || !isSafeToSpeculativelyExecute(I)))
+    return false;
+
+  if (!I->mayReadOrWriteMemory())
+    return true;
+
+  // A load or store that depends on nothing earlier in its block sees the
+  // same memory as it would at the end of the predecessor.
+  MemDepResult Dep = MD->getDependency(I);
+  return Dep.isNonLocal() || Dep.isNonFuncLocal();
+}
+
+bool GVNHoistSink::hoistFromSuccessors(BasicBlock *BB) {
+  BranchInst *BI = dyn_cast<BranchInst>(BB->getTerminator());
+  if (!BI || !BI->isConditional())
+    return false;
+  BasicBlock *Succ0 = BI->getSuccessor(0);
+  BasicBlock *Succ1 = BI->getSuccessor(1);
+  if (Succ0 == Succ1 || Succ0 == BB || Succ1 == BB ||
+      !Succ0->getSinglePredecessor() || !Succ1->getSinglePredecessor())
+    return false;
+
+  // Folding the PHIs changes the IR even if nothing is hoisted afterwards.
+  bool Changed =
+      isa<PHINode>(Succ0->begin()) || isa<PHINode>(Succ1->begin());
+  FoldSingleEntryPHINodes(Succ0, AA, MD);
+  FoldSingleEntryPHINodes(Succ1, AA, MD);
+
+  auto FindFirstBarrier = [](BasicBlock *Succ) -> Instruction * {
+    for (Instruction &I : *Succ)
+      if (isBarrier(&I))
+        return &I;
+    return nullptr;
+  };
+  Instruction *FirstBarrier0 = FindFirstBarrier(Succ0);
+  Instruction *FirstBarrier1 = FindFirstBarrier(Succ1);
+
+  ValueTable Succ1Values;
+  for (Instruction &I : *Succ1)
+    if (isCandidate(&I))
+      Succ1Values.insert(&I);
+
+  for (BasicBlock::iterator It = Succ0->begin(), E = Succ0->end(); It != E;) {
+    Instruction *I0 = It++;
+    if (!isCandidate(I0) || !canHoist(I0, FirstBarrier0))
+      continue;
+
+    Instruction *I1 = nullptr;
+    for (Instruction *Candidate : Succ1Values.lookup(I0))
+      if (isEquivalent(I0, Candidate) && canHoist(Candidate, FirstBarrier1)) {
+        I1 = Candidate;
+        break;
+      }
+    if (!I1)
+      continue;
+
+    DEBUG(dbgs() << "GVNHoistSink: hoisting " << *I0 << " into "
+                 << BB->getName() << '\n');
+
+    // The users of I1 in its block are about to get I0 as an operand, which
+    // changes their value numbers.
+    SmallVector<Instruction *, 4> Users;
+    for (User *U : I1->users())
+      if (Instruction *UI = dyn_cast<Instruction>(U))
+        if (UI->getParent() == Succ1 && isCandidate(UI)) {
+          Succ1Values.erase(UI);
+          Users.push_back(UI);
+        }
+    Succ1Values.erase(I1);
+
+    MD->removeInstruction(I0);
+    I0->moveBefore(BI);
+    mergeInto(I0, I1);
+    for (Instruction *UI : Users)
+      Succ1Values.insert(UI);
+
+    ++NumHoisted;
+    Changed = true;
+  }
+  return Changed;
+}
+
+/// Return true if I may be moved to the end of its block: nothing after it
+/// uses it, and it can be reordered with everything after it.
+bool GVNHoistSink::canSinkToEnd(Instruction *I) {
+  BasicBlock *BB = I->getParent();
+  for (User *U : I->users())
+    if (cast<Instruction>(U)->getParent() == BB)
+      return false;
+
+  LoadInst *LI = dyn_cast<LoadInst>(I);
+  StoreInst *SI = dyn_cast<StoreInst>(I);
+  if (!LI && !SI)
+    return true;
+  MemoryLocation Loc =
+      LI ? MemoryLocation::get(LI) : MemoryLocation::get(SI);
+
+  for (BasicBlock::iterator It = I, E = BB->getTerminator(); ++It != E;) {
+    // A store may not be delayed past a point the program might not get to.
+    if (SI && isBarrier(It))
+      return false;
+    if (!It->mayReadOrWriteMemory())
+      continue;
+    AliasAnalysis::ModRefResult MR = AA->getModRefInfo(It, Loc);
+    if (LI ? (MR & AliasAnalysis::Mod) : MR != AliasAnalysis::NoModRef)
+      return false;
+  }
+  return true;
+}
+
+/// Return true if I1 and I2, which live in the two predecessors of Succ, may
+/// be replaced by one instruction at the start of Succ. On success,
+/// DifferingOp is the index of the operand that needs a PHI node (or -1), and
+/// UserPHI the PHI node in Succ merging the two values (or null if unused).
+bool GVNHoistSink::canSinkPair(Instruction *I1, Instruction *I2,
+                               BasicBlock *Succ, int &DifferingOp,
+                               PHINode *&UserPHI) {
+  if (!I1->isSameOperationAs(I2))
+    return false;
+
+  DifferingOp = -1;
+  for (unsigned i = 0, e = I1->getNumOperands(); i != e; ++i) {
+    Value *Op1 = I1->getOperand(i);
+    Value *Op2 = I2->getOperand(i);
+    if (Op1 == Op2) {
+      // The shared operand has to be available in Succ.
+      if (Instruction *OpI = dyn_cast<Instruction>(Op1))
+        if (OpI->getParent() == I1->getParent() ||
+            OpI->getParent() == I2->getParent())
+          return false;
+      continue;
+    }
+    // Operands which must be constants are never routed through PHIs.
+    if (DifferingOp != -1 || isa<Constant>(Op1) || isa<Constant>(Op2))
+      return false;
+    DifferingOp = i;
+  }
+
+  UserPHI = nullptr;
+  if (I1->use_empty() != I2->use_empty())
+    return false;
+  if (!I1->use_empty()) {
+    if (!I1->hasOneUse() || !I2->hasOneUse())
+      return false;
+    PHINode *PN = dyn_cast<PHINode>(I1->user_back());
+    if (!PN || PN != I2->user_back() || PN->getParent() != Succ ||
+        PN->getNumIncomingValues() != 2)
+      return false;
+    UserPHI = PN;
+  }
+
+  return canSinkToEnd(I1) && canSinkToEnd(I2);
+}
+
+bool GVNHoistSink::sinkFromPredecessors(BasicBlock *BB) {
+  pred_iterator PI = pred_begin(BB), PE = pred_end(BB);
+  if (PI == PE)
+    return false;
+  BasicBlock *Pred0 = *PI++;
+  if (PI == PE)
+    return false;
+  BasicBlock *Pred1 = *PI++;
+  if (PI != PE || Pred0 == Pred1 || Pred0 == BB || Pred1 == BB)
+    return false;
+  BranchInst *BI0 = dyn_cast<BranchInst>(Pred0->getTerminator());
+  BranchInst *BI1 = dyn_cast<BranchInst>(Pred1->getTerminator());
+  if (!BI0 || !BI1 || BI0->isConditional() || BI1->isConditional())
+    return false;
+
+  bool Changed = false;
+  // Sunk instructions keep their original order: each one goes in front of
+  // the one sunk before it.
+  Instruction *InsertPt = BB->getFirstInsertionPt();
+  Instruction *Cur = BI0;
+  while (Cur != &Pred0->front()) {
+    Instruction *I0 = Cur->getPrevNode();
+    if (!isCandidate(I0)) {
+      Cur = I0;
+      continue;
+    }
+
+    Instruction *I1 = nullptr;
+    int DifferingOp = -1;
+    PHINode *UserPHI = nullptr;
+    unsigned Scanned = 0;
+    for (Instruction *J = BI1; J != &Pred1->front() && Scanned < MaxSinkScan;
+         ++Scanned) {
+      J = J->getPrevNode();
+      if (isCandidate(J) && canSinkPair(I0, J, BB, DifferingOp, UserPHI)) {
+        I1 = J;
+        break;
+      }
+    }
+    if (!I1) {
+      Cur = I0;
+      continue;
+    }
+
+    DEBUG(dbgs() << "GVNHoistSink: sinking " << *I0 << " into "
+                 << BB->getName() << '\n');
+
+    if (DifferingOp != -1) {
+      Value *Op0 = I0->getOperand(DifferingOp);
+      Value *Op1 = I1->getOperand(DifferingOp);
+      PHINode *NewPN = PHINode::Create(Op0->getType(), 2,
+                                       Op0->getName() + ".sink", BB->begin());
+      NewPN->addIncoming(Op0, Pred0);
+      NewPN->addIncoming(Op1, Pred1);
+      I0->setOperand(DifferingOp, NewPN);
+    }
+
+    MD->removeInstruction(I0);
+    I0->moveBefore(InsertPt);
+    InsertPt = I0;
+    if (UserPHI) {
+      UserPHI->replaceAllUsesWith(I0);
+      removeInstruction(UserPHI);
+    }
+    mergeInto(I0, I1);
+
+    ++NumSunk;
+    Changed = true;
+  }
+  return Changed;
+}
+
+bool GVNHoistSink::runOnFunction(Function &F) {
+  if (skipOptnoneFunction(F))
+    return false;
+
+  AA = &getAnalysis<AliasAnalysis>();
+  MD = &getAnalysis<MemoryDependenceAnalysis>();
+
+  bool Changed = false;
+  for (BasicBlock &BB : F) {
+    Changed |= hoistFromSuccessors(&BB);
+    Changed |= sinkFromPredecessors(&BB);
+  }
+  return Changed;
+}
@@ -34,11 +34,13 @@
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/Analysis/AliasSetTracker.h"
+#include "llvm/Analysis/CaptureTracking.h"
 #include "llvm/Analysis/ConstantFolding.h"
 #include "llvm/Analysis/LoopInfo.h"
 #include "llvm/Analysis/LoopPass.h"
 #include "llvm/Analysis/ScalarEvolution.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/IR/CFG.h"
 #include "llvm/IR/Constants.h"
@@ -53,6 +55,8 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/GlobalStatus.h"
 #include "llvm/Transforms/Utils/Local.h"
 #include "llvm/Transforms/Utils/LoopUtils.h"
 #include "llvm/Transforms/Utils/SSAUpdater.h"
@@ -66,11 +70,27 @@ STATISTIC(NumHoisted   , "Number of instructions hoisted out of loop");
 STATISTIC(NumMovedLoads, "Number of load insts hoisted or sunk");
 STATISTIC(NumMovedCalls, "Number of call insts hoisted or sunk");
 STATISTIC(NumPromoted  , "Number of memory locations promoted to registers");
+STATISTIC(NumPromotedSpeculative, "Number of thread-local memory locations "
+                                  "promoted with a speculative store");
+STATISTIC(NumPromotedConditional, "Number of memory locations promoted with "
+                                  "a flag-guarded store");
 
 static cl::opt<bool>
 DisablePromotion("disable-licm-promotion", cl::Hidden,
                  cl::desc("Disable memory promotion in LICM pass"));
 
+static cl::opt<bool>
+EnableConditionalPromotion("licm-conditional-promotion", cl::Hidden,
+                           cl::init(false),
+                           cl::desc("Promote conditionally stored locations, "
+                                    "storing back at loop exits only if the "
+                                    "loop stored"));
+
+static cl::opt<unsigned> ConditionalPromotionMinRegs(
+    "licm-conditional-promotion-min-regs", cl::Hidden, cl::init(16),
+    cl::desc("Minimum number of scalar registers the target must have for "
+             "flag-guarded promotion"));
+
 static bool inSubLoop(BasicBlock *BB, Loop *CurLoop, LoopInfo *LI);
 static bool isNotUsedInLoop(const Instruction &I, const Loop *CurLoop);
 static bool hoist(Instruction &I, BasicBlock *Preheader);
@@ -111,7 +131,13 @@ namespace {
     /// loop preheaders be inserted into the CFG...
     ///
     void getAnalysisUsage(AnalysisUsage &AU) const override {
-      AU.setPreservesCFG();
+      // Flag-guarded promotion splits loop exit blocks to guard the stores.
+      if (EnableConditionalPromotion) {
+        AU.addPreserved<DominatorTreeWrapperPass>();
+        AU.addPreserved<LoopInfoWrapperPass>();
+      } else {
+        AU.setPreservesCFG();
+      }
       AU.addRequired<DominatorTreeWrapperPass>();
       AU.addRequired<LoopInfoWrapperPass>();
       AU.addRequiredID(LoopSimplifyID);
@@ -122,6 +148,7 @@ namespace {
       AU.addPreserved<AliasAnalysis>();
       AU.addPreserved<ScalarEvolution>();
       AU.addRequired<TargetLibraryInfoWrapperPass>();
+      AU.addRequired<TargetTransformInfoWrapperPass>();
     }
 
     using llvm::Pass::doFinalization;
@@ -137,6 +164,7 @@ namespace {
     DominatorTree *DT;       // Dominator Tree for the current Loop.
 
     TargetLibraryInfo *TLI;  // TargetLibraryInfo for constant folding.
+    TargetTransformInfo *TTI; // TargetTransformInfo for promotion costs.
 
     // State that is updated as we process loops.
     bool Changed;            // Set to true when we change anything.
@@ -166,6 +194,7 @@ INITIALIZE_PASS_DEPENDENCY(LoopSimplify)
 INITIALIZE_PASS_DEPENDENCY(LCSSA)
 INITIALIZE_PASS_DEPENDENCY(ScalarEvolution)
 INITIALIZE_PASS_DEPENDENCY(TargetLibraryInfoWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(TargetTransformInfoWrapperPass)
 INITIALIZE_AG_DEPENDENCY(AliasAnalysis)
 INITIALIZE_PASS_END(LICM, "licm", "Loop Invariant Code Motion", false, false)
 
@@ -187,6 +216,8 @@ bool LICM::runOnLoop(Loop *L, LPPassManager &LPM) {
   DT = &getAnalysis<DominatorTreeWrapperPass>().getDomTree();
 
   TLI = &getAnalysis<TargetLibraryInfoWrapperPass>().getTLI();
+  TTI = &getAnalysis<TargetTransformInfoWrapperPass>().getTTI(
+      *L->getHeader()->getParent());
 
   assert(L->isLCSSAForm(*DT) && "Loop is not in LCSSA form.");
 
@@ -256,7 +287,7 @@ bool LICM::runOnLoop(Loop *L, LPPassManager &LPM) {
          I != E; ++I)
       Changed |= promoteLoopAccessesToScalars(*I, ExitBlocks, InsertPts, 
                                               PIC, LI, DT, CurLoop, 
-                                              CurAST, &SafetyInfo);
+                                              CurAST, &SafetyInfo, TTI);
 
     // Once we have promoted values across the loop body we have to recursively
     // reform LCSSA as any nested loop may now have values defined within the
@@ -720,6 +751,8 @@ namespace {
     PredIteratorCache &PredCache;
     AliasSetTracker &AST;
     LoopInfo &LI;
+    DominatorTree &DT;
+    SSAUpdater *FlagSSA; // Whether the loop stored, if the exit store is guarded.
     DebugLoc DL;
     int Alignment;
     AAMDNodes AATags;
@@ -746,11 +779,13 @@ namespace {
                  SSAUpdater &S, SmallPtrSetImpl<Value *> &PMA,
                  SmallVectorImpl<BasicBlock *> &LEB,
                  SmallVectorImpl<Instruction *> &LIP, PredIteratorCache &PIC,
-                 AliasSetTracker &ast, LoopInfo &li, DebugLoc dl, int alignment,
+                 AliasSetTracker &ast, LoopInfo &li, DominatorTree &dt,
+                 SSAUpdater *FlagSSA, DebugLoc dl, int alignment,
                  const AAMDNodes &AATags)
         : LoadAndStorePromoter(Insts, S), SomePtr(SP), PointerMustAliases(PMA),
           LoopExitBlocks(LEB), LoopInsertPts(LIP), PredCache(PIC), AST(ast),
-          LI(li), DL(dl), Alignment(alignment), AATags(AATags) {}
+          LI(li), DT(dt), FlagSSA(FlagSSA), DL(dl), Alignment(alignment),
+          AATags(AATags) {}
 
     bool isInstInList(Instruction *I,
                       const SmallVectorImpl<Instruction*> &) const override {
@@ -773,6 +808,21 @@ namespace {
         LiveInValue = maybeInsertLCSSAPHI(LiveInValue, ExitBlock);
         Value *Ptr = maybeInsertLCSSAPHI(SomePtr, ExitBlock);
         Instruction *InsertPos = LoopInsertPts[i];
+        if (FlagSSA) {
+          // Only store if some path through the loop stored:
+          //   if (flag) *Ptr = LiveInValue;
+          Value *Flag = FlagSSA->GetValueInMiddleOfBlock(ExitBlock);
+          Flag = maybeInsertLCSSAPHI(Flag, ExitBlock);
+          TerminatorInst *ThenTerm = SplitBlockAndInsertIfThen(
+              Flag, InsertPos, /*Unreachable=*/false, nullptr, &DT);
+          ThenTerm->getParent()->setName(ExitBlock->getName() + ".store");
+          InsertPos->getParent()->setName(ExitBlock->getName() + ".split");
+          if (Loop *L = LI.getLoopFor(ExitBlock)) {
+            L->addBasicBlockToLoop(ThenTerm->getParent(), LI);
+            L->addBasicBlockToLoop(InsertPos->getParent(), LI);
+          }
+          InsertPos = ThenTerm;
+        }
         StoreInst *NewSI = new StoreInst(LiveInValue, Ptr, InsertPos);
         NewSI->setAlignment(Alignment);
         NewSI->setDebugLoc(DL);
@@ -801,7 +851,8 @@ bool llvm::promoteLoopAccessesToScalars(AliasSet &AS,
                                         PredIteratorCache &PIC, LoopInfo *LI, 
                                         DominatorTree *DT, Loop *CurLoop, 
                                         AliasSetTracker *CurAST, 
-                                        LICMSafetyInfo * SafetyInfo) { 
+                                        LICMSafetyInfo * SafetyInfo,
+                                        const TargetTransformInfo *TTI) { 
   // Verify inputs.
   assert(LI != nullptr && DT != nullptr && 
          CurLoop != nullptr && CurAST != nullptr && 
@@ -921,14 +972,57 @@ bool llvm::promoteLoopAccessesToScalars(AliasSet &AS,
     }
   }
 
-  // If there isn't a guaranteed-to-execute instruction, we can't promote.
-  if (!GuaranteedToExecute)
-    return Changed;
+  // If there isn't a guaranteed-to-execute store, the location may still be
+  // promoted if it can be loaded in the preheader and every store in the loop
+  // is seen before an exit, i.e. nothing in the loop may unwind:
+  //
+  //  - If no other thread can observe the location, storing back the value
+  //    loaded in the preheader on paths that did not store is harmless.
+  //  - Otherwise the exit store is guarded by a flag recording whether the
+  //    loop stored, which introduces no store that did not exist before.
+  //    The value and the flag stay live across the loop and the exit blocks
+  //    get split, so this is opt-in and limited to targets with registers to
+  //    spare.
+  bool UseFlag = false;
+  if (!GuaranteedToExecute) {
+    if (LoopUses.empty() || SafetyInfo->MayThrow || !Preheader ||
+        !HasDedicatedExits)
+      return Changed;
+    const DataLayout &MDL = Preheader->getModule()->getDataLayout();
+    if (!isDereferenceablePointer(SomePtr, MDL))
+      return Changed;
+
+    // A captured address may have been handed to another thread.
+    Value *Object = GetUnderlyingObject(SomePtr, MDL);
+    bool IsThreadLocal = false;
+    if (isa<AllocaInst>(Object)) {
+      IsThreadLocal = !PointerMayBeCaptured(Object, /*ReturnCaptures=*/true,
+                                            /*StoreCaptures=*/true);
+    } else if (auto *GV = dyn_cast<GlobalVariable>(Object)) {
+      // A constant may live in read-only memory, where the speculative store
+      // would fault on the paths that never stored.
+      GlobalStatus GS;
+      IsThreadLocal = GV->isThreadLocal() && !GV->isConstant() &&
+                      GV->hasLocalLinkage() &&
+                      !GlobalStatus::analyzeGlobal(GV, GS);
+    }
+
+    if (!IsThreadLocal) {
+      if (!EnableConditionalPromotion || !TTI ||
+          TTI->getNumberOfRegisters(false) < ConditionalPromotionMinRegs)
+        return Changed;
+      UseFlag = true;
+    }
+  }
 
   // Otherwise, this is safe to promote, lets do it!
   DEBUG(dbgs() << "LICM: Promoting value stored to in loop: " <<*SomePtr<<'\n');
   Changed = true;
   ++NumPromoted;
+  if (UseFlag)
+    ++NumPromotedConditional;
+  else if (!GuaranteedToExecute)
+    ++NumPromotedSpeculative;
 
   // Grab a debug location for the inserted loads/stores; given that the
   // inserted loads/stores have little relation to the original loads/stores,
@@ -948,9 +1042,23 @@ bool llvm::promoteLoopAccessesToScalars(AliasSet &AS,
   // We use the SSAUpdater interface to insert phi nodes as required.
   SmallVector<PHINode*, 16> NewPHIs;
   SSAUpdater SSA(&NewPHIs);
+  // The flag is false on entry to the loop and true after every store.
+  SmallVector<PHINode*, 16> NewFlagPHIs;
+  SSAUpdater FlagSSA(&NewFlagPHIs);
+  if (UseFlag) {
+    LLVMContext &Ctx = SomePtr->getContext();
+    FlagSSA.Initialize(Type::getInt1Ty(Ctx),
+                       SomePtr->getName().str() + ".stored");
+    FlagSSA.AddAvailableValue(Preheader, ConstantInt::getFalse(Ctx));
+    for (Instruction *UI : LoopUses)
+      if (isa<StoreInst>(UI))
+        FlagSSA.AddAvailableValue(UI->getParent(), ConstantInt::getTrue(Ctx));
+  }
+
   LoopPromoter Promoter(SomePtr, LoopUses, SSA,
                         PointerMustAliases, ExitBlocks,
-                        InsertPts, PIC, *CurAST, *LI, DL, Alignment, AATags);
+                        InsertPts, PIC, *CurAST, *LI, *DT,
+                        UseFlag ? &FlagSSA : nullptr, DL, Alignment, AATags);
 
   // Set up the preheader to have a definition of the value.  It is the live-out
   // value from the preheader that uses in the loop will use.
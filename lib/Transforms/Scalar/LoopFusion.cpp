@@ -0,0 +1,354 @@
+//===- LoopFusion.cpp - Loop Fusion Pass ----------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the Loop Fusion Pass.  It merges two adjacent loops
+// that run over the same iteration space into a single loop, so that values
+// one loop stores and the other loads are reused while they are still in a
+// register or in the cache.  Once the loops are fused, GVN can forward such a
+// store to the load and an intermediate array may become dead altogether.
+//
+// Only the simplest, but most common, shape is handled: two innermost loops
+// in the same parent whose trip counts are the same, where the exit block of
+// the first is the preheader of the second and contains nothing but the
+// branch to it.  The two loops are thus always executed together, and the
+// fused loop can keep the exit condition of the second.
+//
+// Fusion is legal if no iteration of the second loop accesses memory that a
+// later iteration of the first loop accesses, with at least one of the two
+// accesses being a store.  DependenceAnalysis is used to rule out any
+// dependence between the loops; the remaining dependences are checked
+// directly on the access functions.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/DependenceAnalysis.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Scalar.h"
+#include "llvm/Transforms/Utils/Local.h"
+#include <algorithm>
+#include <cstdlib>
+
+#define LFUSE_NAME "loop-fusion"
+#define DEBUG_TYPE LFUSE_NAME
+
+using namespace llvm;
+
+STATISTIC(NumLoopsFused, "Number of loops fused");
+
+namespace {
+/// \brief The loop fusion pass.
+class LoopFusion : public FunctionPass {
+public:
+  static char ID;
+  LoopFusion() : FunctionPass(ID) {
+    initializeLoopFusionPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnFunction(Function &F) override {
+    LI = &getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+    DT = &getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+    SE = &getAnalysis<ScalarEvolution>();
+    DA = &getAnalysis<DependenceAnalysis>();
+    DL = &F.getParent()->getDataLayout();
+
+    // Fusing a pair of loops can make the fused loop adjacent to another one,
+    // so keep going until there is nothing left to fuse.
+    bool Changed = false;
+    while (fuseOnePair())
+      Changed = true;
+    return Changed;
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<LoopInfoWrapperPass>();
+    AU.addPreserved<LoopInfoWrapperPass>();
+    AU.addRequired<DominatorTreeWrapperPass>();
+    AU.addPreserved<DominatorTreeWrapperPass>();
+    AU.addRequired<ScalarEvolution>();
+    AU.addPreserved<ScalarEvolution>();
+    AU.addRequired<DependenceAnalysis>();
+    AU.addRequiredID(LoopSimplifyID);
+    AU.addRequiredID(LCSSAID);
+  }
+
+private:
+  /// \brief Fuse the first pair of loops found that can be fused.  Returns
+  /// false if there is none.
+  bool fuseOnePair();
+
+  /// \brief Returns the loop that directly follows \p L and has the same
+  /// shape, or null if there is none.
+  Loop *getFusionCandidate(Loop *L);
+
+  /// \brief Collects the loads and stores of \p L into \p Accesses.  Returns
+  /// false if the loop contains any other instruction that touches memory or
+  /// has side effects.
+  bool collectAccesses(Loop *L, SmallVectorImpl<Instruction *> &Accesses);
+
+  /// \brief Returns true if running \p B, an access of \p L2, in the same
+  /// iteration as \p A, an access of \p L1, but before all later iterations
+  /// of \p L1, does not change the result of either.
+  bool isSafeToFuse(Instruction *A, Loop *L1, Instruction *B, Loop *L2);
+
+  /// \brief Returns true if \p L1 and \p L2 can be fused.
+  bool canFuse(Loop *L1, Loop *L2);
+
+  /// \brief Moves the body of \p L2 into \p L1, after the body of \p L1.
+  void fuse(Loop *L1, Loop *L2);
+
+  LoopInfo *LI;
+  DominatorTree *DT;
+  ScalarEvolution *SE;
+  DependenceAnalysis *DA;
+  const DataLayout *DL;
+};
+} // end anonymous namespace
+
+bool LoopFusion::fuseOnePair() {
+  SmallVector<Loop *, 8> Worklist(LI->begin(), LI->end());
+  while (!Worklist.empty()) {
+    Loop *L = Worklist.pop_back_val();
+    if (!L->empty()) {
+      Worklist.append(L->begin(), L->end());
+      continue;
+    }
+    Loop *Next = getFusionCandidate(L);
+    if (!Next || !canFuse(L, Next))
+      continue;
+    fuse(L, Next);
+    ++NumLoopsFused;
+    return true;
+  }
+  return false;
+}
+
+/// \brief Returns true if \p L has a single exit, taken from its latch.
+static bool hasSingleLatchExit(Loop *L) {
+  BasicBlock *Latch = L->getLoopLatch();
+  if (!Latch || L->getExitingBlock() != Latch)
+    return false;
+  BranchInst *BI = dyn_cast<BranchInst>(Latch->getTerminator());
+  return BI && BI->isConditional() && L->getExitBlock();
+}
+
+Loop *LoopFusion::getFusionCandidate(Loop *L) {
+  if (!L->getLoopPreheader() || !hasSingleLatchExit(L))
+    return nullptr;
+
+  // The exit block has to lead straight into the next loop; anything in
+  // between would have to be moved out of the way, and a PHI would carry a
+  // value from the first loop into the second.
+  BasicBlock *Exit = L->getExitBlock();
+  if (Exit->size() != 1 || !Exit->getSinglePredecessor())
+    return nullptr;
+  BranchInst *BI = dyn_cast<BranchInst>(Exit->getTerminator());
+  if (!BI || BI->isConditional())
+    return nullptr;
+
+  BasicBlock *Header = BI->getSuccessor(0);
+  Loop *Next = LI->getLoopFor(Header);
+  if (!Next || Next->getHeader() != Header || !Next->empty() ||
+      Next->getParentLoop() != L->getParentLoop() ||
+      Next->getLoopPreheader() != Exit || !hasSingleLatchExit(Next))
+    return nullptr;
+  return Next;
+}
+
+bool LoopFusion::collectAccesses(Loop *L,
+                                 SmallVectorImpl<Instruction *> &Accesses) {
+  for (BasicBlock *BB : L->getBlocks())
+    for (Instruction &I : *BB) {
+      if (LoadInst *LD = dyn_cast<LoadInst>(&I)) {
+        if (!LD->isSimple())
+          return false;
+        Accesses.push_back(LD);
+      } else if (StoreInst *ST = dyn_cast<StoreInst>(&I)) {
+        if (!ST->isSimple())
+          return false;
+        Accesses.push_back(ST);
+      } else if (I.mayReadOrWriteMemory() || I.mayHaveSideEffects()) {
+        return false;
+      }
+    }
+  return true;
+}
+
+/// \brief Returns the address accessed by \p I, a load or a store.
+static Value *getPointerOperand(Instruction *I) {
+  if (LoadInst *LD = dyn_cast<LoadInst>(I))
+    return LD->getPointerOperand();
+  return cast<StoreInst>(I)->getPointerOperand();
+}
+
+/// \brief Returns the number of bytes accessed by \p I, a load or a store.
+static uint64_t getAccessSize(Instruction *I, const DataLayout &DL) {
+  Type *Ty = isa<LoadInst>(I) ? I->getType()
+                              : cast<StoreInst>(I)->getValueOperand()->getType();
+  return DL.getTypeStoreSize(Ty);
+}
+
+bool LoopFusion::isSafeToFuse(Instruction *A, Loop *L1, Instruction *B,
+                              Loop *L2) {
+  if (!DA->depends(A, B, true))
+    return true;
+
+  // Say the accesses are to A(i) = StartA + Step * i and B(j) = StartB +
+  // Step * j, each a whole element of size |Step|.  They are to the same
+  // element if j = i - (StartB - StartA) / Step.  After fusion, iteration j
+  // of the second loop runs before iteration i of the first if j < i, which
+  // is harmless only if no such pair exists.
+  const SCEVAddRecExpr *ARA =
+      dyn_cast<SCEVAddRecExpr>(SE->getSCEV(getPointerOperand(A)));
+  const SCEVAddRecExpr *ARB =
+      dyn_cast<SCEVAddRecExpr>(SE->getSCEV(getPointerOperand(B)));
+  if (!ARA || !ARB || ARA->getLoop() != L1 || ARB->getLoop() != L2 ||
+      !ARA->isAffine() || !ARB->isAffine())
+    return false;
+
+  const SCEVConstant *StepA =
+      dyn_cast<SCEVConstant>(ARA->getStepRecurrence(*SE));
+  const SCEVConstant *StepB =
+      dyn_cast<SCEVConstant>(ARB->getStepRecurrence(*SE));
+  if (!StepA || StepA != StepB)
+    return false;
+  int64_t Step = StepA->getValue()->getSExtValue();
+  uint64_t Size = getAccessSize(A, *DL);
+  if (Step == 0 || Size != getAccessSize(B, *DL) ||
+      Size != (uint64_t)std::abs(Step))
+    return false;
+
+  const SCEVConstant *Dist = dyn_cast<SCEVConstant>(
+      SE->getMinusSCEV(ARB->getStart(), ARA->getStart()));
+  if (!Dist)
+    return false;
+  int64_t D = Dist->getValue()->getSExtValue();
+  return D % Step == 0 && D / Step <= 0;
+}
+
+bool LoopFusion::canFuse(Loop *L1, Loop *L2) {
+  DEBUG(dbgs() << "LFuse: Checking loops " << L1->getHeader()->getName()
+               << " and " << L2->getHeader()->getName() << "\n");
+
+  const SCEV *BTC = SE->getBackedgeTakenCount(L1);
+  if (isa<SCEVCouldNotCompute>(BTC) || BTC != SE->getBackedgeTakenCount(L2)) {
+    DEBUG(dbgs() << "LFuse: Trip counts differ or are unknown\n");
+    return false;
+  }
+
+  // The initial values of the second loop's PHIs are needed at the start of
+  // the fused loop.
+  BasicBlock *Preheader2 = L2->getLoopPreheader();
+  for (Instruction &I : *L2->getHeader()) {
+    PHINode *PN = dyn_cast<PHINode>(&I);
+    if (!PN)
+      break;
+    Instruction *Init =
+        dyn_cast<Instruction>(PN->getIncomingValueForBlock(Preheader2));
+    if (Init && L1->contains(Init))
+      return false;
+  }
+
+  SmallVector<Instruction *, 16> Accesses1, Accesses2;
+  if (!collectAccesses(L1, Accesses1) || !collectAccesses(L2, Accesses2)) {
+    DEBUG(dbgs() << "LFuse: Unsupported memory operation\n");
+    return false;
+  }
+
+  for (Instruction *A : Accesses1)
+    for (Instruction *B : Accesses2) {
+      if (isa<LoadInst>(A) && isa<LoadInst>(B))
+        continue;
+      if (!isSafeToFuse(A, L1, B, L2)) {
+        DEBUG(dbgs() << "LFuse: Fusion-preventing dependence from " << *A
+                     << " to " << *B << "\n");
+        return false;
+      }
+    }
+  return true;
+}
+
+void LoopFusion::fuse(Loop *L1, Loop *L2) {
+  DEBUG(dbgs() << "LFuse: Fusing loops " << L1->getHeader()->getName()
+               << " and " << L2->getHeader()->getName() << "\n");
+  SE->forgetLoop(L1);
+  SE->forgetLoop(L2);
+
+  BasicBlock *Preheader1 = L1->getLoopPreheader();
+  BasicBlock *Header1 = L1->getHeader();
+  BasicBlock *Latch1 = L1->getLoopLatch();
+  BasicBlock *Preheader2 = L2->getLoopPreheader();
+  BasicBlock *Header2 = L2->getHeader();
+  BasicBlock *Latch2 = L2->getLoopLatch();
+
+  // The first loop now always falls through to the body of the second, whose
+  // latch becomes the latch of the fused loop.
+  BranchInst *Br1 = cast<BranchInst>(Latch1->getTerminator());
+  Value *Cond = Br1->getCondition();
+  BranchInst::Create(Header2, Br1);
+  Br1->eraseFromParent();
+  RecursivelyDeleteTriviallyDeadInstructions(Cond);
+
+  BranchInst *Br2 = cast<BranchInst>(Latch2->getTerminator());
+  for (unsigned i = 0, e = Br2->getNumSuccessors(); i != e; ++i)
+    if (Br2->getSuccessor(i) == Header2)
+      Br2->setSuccessor(i, Header1);
+
+  for (Instruction &I : *Header1) {
+    PHINode *PN = dyn_cast<PHINode>(&I);
+    if (!PN)
+      break;
+    PN->setIncomingBlock(PN->getBasicBlockIndex(Latch1), Latch2);
+  }
+  while (PHINode *PN = dyn_cast<PHINode>(Header2->begin())) {
+    PN->setIncomingBlock(PN->getBasicBlockIndex(Preheader2), Preheader1);
+    PN->moveBefore(Header1->getFirstNonPHI());
+  }
+
+  // The old preheader of the second loop is now unreachable.
+  LI->removeBlock(Preheader2);
+  DT->changeImmediateDominator(Header2, Latch1);
+  DT->eraseNode(Preheader2);
+  Preheader2->eraseFromParent();
+
+  for (BasicBlock *BB : L2->getBlocks()) {
+    LI->changeLoopFor(BB, L1);
+    L1->addBlockEntry(BB);
+  }
+  if (Loop *Parent = L2->getParentLoop())
+    Parent->removeChildLoop(std::find(Parent->begin(), Parent->end(), L2));
+  else
+    LI->removeLoop(std::find(LI->begin(), LI->end(), L2));
+  delete L2;
+}
+
+char LoopFusion::ID = 0;
+static const char lfuse_name[] = "Loop Fusion";
+
+INITIALIZE_PASS_BEGIN(LoopFusion, LFUSE_NAME, lfuse_name, false, false)
+INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(ScalarEvolution)
+INITIALIZE_PASS_DEPENDENCY(DependenceAnalysis)
+INITIALIZE_PASS_DEPENDENCY(LoopSimplify)
+INITIALIZE_PASS_DEPENDENCY(LCSSA)
+INITIALIZE_PASS_END(LoopFusion, LFUSE_NAME, lfuse_name, false, false)
+
+namespace llvm {
+FunctionPass *createLoopFusionPass() { return new LoopFusion(); }
+}
@@ -444,6 +444,7 @@ struct LoopInterchange : public FunctionPass {
     AU.addRequired<DependenceAnalysis>();
     AU.addRequiredID(LoopSimplifyID);
     AU.addRequiredID(LCSSAID);
+    AU.addPreserved<DominatorTreeWrapperPass>();
   }
 
   bool runOnFunction(Function &F) override {
@@ -555,7 +556,6 @@ struct LoopInterchange : public FunctionPass {
 
       // Update the DependencyMatrix
       interChangeDepedencies(DependencyMatrix, i, i - 1);
-      DT->recalculate(F);
 #ifdef DUMP_DEP_MATRICIES
       DEBUG(dbgs() << "Dependence after inter change \n");
       printDepMatrix(DependencyMatrix);
@@ -1081,11 +1081,20 @@ void LoopInterchangeTransform::splitInnerLoopHeader() {
   BasicBlock *InnerLoopPreHeader = InnerLoop->getLoopPreheader();
   if (InnerLoopHasReduction) {
     // FIXME: Check if the induction PHI will always be the first PHI.
+    // SplitBlock would keep the reduction PHIs in the header, so split by
+    // hand and update the analyses the same way.
     BasicBlock *New = InnerLoopHeader->splitBasicBlock(
         ++(InnerLoopHeader->begin()), InnerLoopHeader->getName() + ".split");
     if (LI)
       if (Loop *L = LI->getLoopFor(InnerLoopHeader))
         L->addBasicBlockToLoop(New, *LI);
+    if (DT)
+      if (DomTreeNode *OldNode = DT->getNode(InnerLoopHeader)) {
+        std::vector<DomTreeNode *> Children(OldNode->begin(), OldNode->end());
+        DomTreeNode *NewNode = DT->addNewBlock(New, InnerLoopHeader);
+        for (DomTreeNode *Child : Children)
+          DT->changeImmediateDominator(Child, NewNode);
+      }
 
     // Adjust Reduction PHI's in the block.
     SmallVector<PHINode *, 8> PHIVec;
@@ -1144,6 +1153,22 @@ void LoopInterchangeTransform::updateIncomingBlock(BasicBlock *CurrBlock,
   }
 }
 
+/// \brief Replace every successor OldBB of BI with NewBB, recording the
+/// corresponding dominator tree updates.
+static void
+updateSuccessor(BranchInst *BI, BasicBlock *OldBB, BasicBlock *NewBB,
+                SmallVectorImpl<DominatorTree::UpdateType> &DTUpdates) {
+  for (unsigned i = 0, e = BI->getNumSuccessors(); i < e; ++i) {
+    if (BI->getSuccessor(i) != OldBB)
+      continue;
+    BI->setSuccessor(i, NewBB);
+    DTUpdates.push_back(DominatorTree::UpdateType(DominatorTree::Delete,
+                                                  BI->getParent(), OldBB));
+    DTUpdates.push_back(DominatorTree::UpdateType(DominatorTree::Insert,
+                                                  BI->getParent(), NewBB));
+  }
+}
+
 bool LoopInterchangeTransform::adjustLoopBranches() {
 
   DEBUG(dbgs() << "adjustLoopBranches called\n");
@@ -1185,21 +1210,16 @@ bool LoopInterchangeTransform::adjustLoopBranches() {
   if (!InnerLoopHeaderSucessor)
     return false;
 
-  // Adjust Loop Preheader and headers
-
-  unsigned NumSucc = OuterLoopPredecessorBI->getNumSuccessors();
-  for (unsigned i = 0; i < NumSucc; ++i) {
-    if (OuterLoopPredecessorBI->getSuccessor(i) == OuterLoopPreHeader)
-      OuterLoopPredecessorBI->setSuccessor(i, InnerLoopPreHeader);
-  }
+  // Collect the CFG changes so that the dominator tree can be updated
+  // incrementally instead of being recomputed.
+  SmallVector<DominatorTree::UpdateType, 16> DTUpdates;
 
-  NumSucc = OuterLoopHeaderBI->getNumSuccessors();
-  for (unsigned i = 0; i < NumSucc; ++i) {
-    if (OuterLoopHeaderBI->getSuccessor(i) == OuterLoopLatch)
-      OuterLoopHeaderBI->setSuccessor(i, LoopExit);
-    else if (OuterLoopHeaderBI->getSuccessor(i) == InnerLoopPreHeader)
-      OuterLoopHeaderBI->setSuccessor(i, InnerLoopHeaderSucessor);
-  }
+  // Adjust Loop Preheader and headers
+  updateSuccessor(OuterLoopPredecessorBI, OuterLoopPreHeader,
+                  InnerLoopPreHeader, DTUpdates);
+  updateSuccessor(OuterLoopHeaderBI, OuterLoopLatch, LoopExit, DTUpdates);
+  updateSuccessor(OuterLoopHeaderBI, InnerLoopPreHeader,
+                  InnerLoopHeaderSucessor, DTUpdates);
 
   // Adjust reduction PHI's now that the incoming block has changed.
   updateIncomingBlock(InnerLoopHeaderSucessor, InnerLoopHeader,
@@ -1207,6 +1227,10 @@ bool LoopInterchangeTransform::adjustLoopBranches() {
 
   BranchInst::Create(OuterLoopPreHeader, InnerLoopHeaderBI);
   InnerLoopHeaderBI->eraseFromParent();
+  DTUpdates.push_back(DominatorTree::UpdateType(
+      DominatorTree::Delete, InnerLoopHeader, InnerLoopHeaderSucessor));
+  DTUpdates.push_back(DominatorTree::UpdateType(
+      DominatorTree::Insert, InnerLoopHeader, OuterLoopPreHeader));
 
   // -------------Adjust loop latches-----------
   if (InnerLoopLatchBI->getSuccessor(0) == InnerLoopHeader)
@@ -1214,11 +1238,8 @@ bool LoopInterchangeTransform::adjustLoopBranches() {
   else
     InnerLoopLatchSuccessor = InnerLoopLatchBI->getSuccessor(0);
 
-  NumSucc = InnerLoopLatchPredecessorBI->getNumSuccessors();
-  for (unsigned i = 0; i < NumSucc; ++i) {
-    if (InnerLoopLatchPredecessorBI->getSuccessor(i) == InnerLoopLatch)
-      InnerLoopLatchPredecessorBI->setSuccessor(i, InnerLoopLatchSuccessor);
-  }
+  updateSuccessor(InnerLoopLatchPredecessorBI, InnerLoopLatch,
+                  InnerLoopLatchSuccessor, DTUpdates);
 
   // Adjust PHI nodes in InnerLoopLatchSuccessor. Update all uses of PHI with
   // the value and remove this PHI node from inner loop.
@@ -1239,19 +1260,16 @@ bool LoopInterchangeTransform::adjustLoopBranches() {
   else
     OuterLoopLatchSuccessor = OuterLoopLatchBI->getSuccessor(0);
 
-  if (InnerLoopLatchBI->getSuccessor(1) == InnerLoopLatchSuccessor)
-    InnerLoopLatchBI->setSuccessor(1, OuterLoopLatchSuccessor);
-  else
-    InnerLoopLatchBI->setSuccessor(0, OuterLoopLatchSuccessor);
+  updateSuccessor(InnerLoopLatchBI, InnerLoopLatchSuccessor,
+                  OuterLoopLatchSuccessor, DTUpdates);
 
   updateIncomingBlock(OuterLoopLatchSuccessor, OuterLoopLatch, InnerLoopLatch);
 
-  if (OuterLoopLatchBI->getSuccessor(0) == OuterLoopLatchSuccessor) {
-    OuterLoopLatchBI->setSuccessor(0, InnerLoopLatch);
-  } else {
-    OuterLoopLatchBI->setSuccessor(1, InnerLoopLatch);
-  }
+  updateSuccessor(OuterLoopLatchBI, OuterLoopLatchSuccessor, InnerLoopLatch,
+                  DTUpdates);
 
+  if (DT)
+    DT->applyUpdates(DTUpdates);
   return true;
 }
 void LoopInterchangeTransform::adjustLoopPreheaders() {
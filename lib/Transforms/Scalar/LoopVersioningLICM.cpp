@@ -0,0 +1,326 @@
+//===- LoopVersioningLICM.cpp - Version loops to enable LICM --------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// LICM cannot hoist a loop-invariant load when a store in the loop may write
+// the same memory.  Often the pointers involved are never the same in
+// practice, they just cannot be proven disjoint at compile time.
+//
+// This pass versions such loops.  The run-time checks computed by
+// LoopAccessAnalysis guard a copy of the loop in which the checked pointer
+// groups are known not to overlap.  The memory accesses in that copy are
+// annotated with scoped noalias metadata recording exactly what the checks
+// proved, so that a subsequent LICM run can hoist the invariant loads.  The
+// original loop is kept as the fall-back when the checks fail.
+//
+// Versioning duplicates the loop and adds checks in front of it, so it is
+// limited both by the number of checks and by the size of the loop.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/DepthFirstIterator.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/LoopAccessAnalysis.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/MDBuilder.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Transforms/Scalar.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/LoopVersioning.h"
+
+#define LVLICM_NAME "loop-versioning-licm"
+#define DEBUG_TYPE LVLICM_NAME
+
+using namespace llvm;
+
+static cl::opt<unsigned>
+MaxRuntimeChecks("licm-versioning-max-checks", cl::init(8), cl::Hidden,
+                 cl::desc("Maximum number of run-time pointer checks emitted "
+                          "to version a loop for LICM"));
+
+static cl::opt<unsigned>
+MaxLoopSize("licm-versioning-max-loop-size", cl::init(200), cl::Hidden,
+            cl::desc("Maximum number of instructions in a loop that is "
+                     "duplicated to version it for LICM"));
+
+STATISTIC(NumLoopsVersioned, "Number of loops versioned for LICM");
+STATISTIC(NumTooManyChecks, "Number of loops needing too many checks");
+STATISTIC(NumTooLarge, "Number of loops too large to version");
+
+/// Marks loops that were versioned already, or are the fall-back copy of such
+/// a loop, so that running the pass again does not version them again.
+static const char *const DisableMDName = "llvm.loop.licm_versioning.disable";
+
+static bool isVersioningDisabled(const Loop *L) {
+  MDNode *LoopID = L->getLoopID();
+  if (!LoopID)
+    return false;
+  for (unsigned i = 1, e = LoopID->getNumOperands(); i < e; ++i) {
+    MDNode *MD = dyn_cast<MDNode>(LoopID->getOperand(i));
+    if (!MD || MD->getNumOperands() == 0)
+      continue;
+    MDString *S = dyn_cast<MDString>(MD->getOperand(0));
+    if (S && S->getString() == DisableMDName)
+      return true;
+  }
+  return false;
+}
+
+static void disableVersioning(Loop *L) {
+  LLVMContext &Context = L->getHeader()->getContext();
+  SmallVector<Metadata *, 4> MDs;
+  // Reserve first location for self reference to the LoopID metadata node.
+  MDs.push_back(nullptr);
+  if (MDNode *LoopID = L->getLoopID())
+    for (unsigned i = 1, ie = LoopID->getNumOperands(); i < ie; ++i)
+      MDs.push_back(LoopID->getOperand(i));
+  MDs.push_back(MDNode::get(Context, MDString::get(Context, DisableMDName)));
+
+  // Both copies of a versioned loop get their own, distinct loop ID.
+  MDNode *NewLoopID = MDNode::getDistinct(Context, MDs);
+  NewLoopID->replaceOperandWith(0, NewLoopID);
+  L->setLoopID(NewLoopID);
+}
+
+static Value *getPointerOperand(Instruction &I) {
+  if (LoadInst *LI = dyn_cast<LoadInst>(&I))
+    return LI->getPointerOperand();
+  if (StoreInst *SI = dyn_cast<StoreInst>(&I))
+    return SI->getPointerOperand();
+  return nullptr;
+}
+
+namespace {
+/// \brief The pass class.
+class LoopVersioningLICM : public FunctionPass {
+public:
+  LoopVersioningLICM() : FunctionPass(ID) {
+    initializeLoopVersioningLICMPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnFunction(Function &F) override {
+    LI = &getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+    LAA = &getAnalysis<LoopAccessAnalysis>();
+    DT = &getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+
+    // Versioning creates new loops, so collect the inner-most loops first.
+    SmallVector<Loop *, 8> Worklist;
+    for (Loop *TopLevelLoop : *LI)
+      for (Loop *L : depth_first(TopLevelLoop))
+        if (L->empty())
+          Worklist.push_back(L);
+
+    bool Changed = false;
+    for (Loop *L : Worklist)
+      Changed |= processLoop(L);
+    return Changed;
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<LoopInfoWrapperPass>();
+    AU.addPreserved<LoopInfoWrapperPass>();
+    AU.addRequired<LoopAccessAnalysis>();
+    AU.addRequired<DominatorTreeWrapperPass>();
+    AU.addPreserved<DominatorTreeWrapperPass>();
+  }
+
+  static char ID;
+
+private:
+  /// \brief Returns true if \p L has a load from a loop-invariant address that
+  /// LICM could hoist if it knew that no store in the loop clobbers it.
+  bool hasInvariantLoadBlockedByStores(Loop *L) {
+    bool HasInvariantLoad = false, HasStore = false;
+    for (BasicBlock *BB : L->getBlocks())
+      for (Instruction &I : *BB) {
+        if (LoadInst *Ld = dyn_cast<LoadInst>(&I)) {
+          if (Ld->isSimple() && L->isLoopInvariant(Ld->getPointerOperand()))
+            HasInvariantLoad = true;
+        } else if (I.mayWriteToMemory()) {
+          // LAA gives up on anything else that writes memory, so only plain
+          // stores are worth looking at.
+          if (!isa<StoreInst>(I))
+            return false;
+          HasStore = true;
+        }
+      }
+    return HasInvariantLoad && HasStore;
+  }
+
+  /// \brief Annotates the memory accesses of the versioned loop with scoped
+  /// alias metadata: each checking group gets a scope, and each access is
+  /// declared not to alias the groups its own group was checked against.
+  void annotateNoAlias(Loop *L, const LoopAccessInfo &LAI) {
+    const RuntimePointerChecking *RtPtrChecking =
+        LAI.getRuntimePointerChecking();
+    const auto &Groups = RtPtrChecking->CheckingGroups;
+    LLVMContext &Context = L->getHeader()->getContext();
+    MDBuilder MDB(Context);
+    MDNode *Domain = MDB.createAnonymousAliasScopeDomain("LVerLICMDomain");
+
+    SmallVector<Metadata *, 8> Scopes;
+    for (unsigned I = 0, E = Groups.size(); I != E; ++I)
+      Scopes.push_back(MDB.createAnonymousAliasScope(Domain));
+
+    DenseMap<Value *, unsigned> PtrToGroup;
+    for (unsigned I = 0, E = Groups.size(); I != E; ++I)
+      for (unsigned Member : Groups[I].Members)
+        PtrToGroup[RtPtrChecking->Pointers[Member].PointerValue] = I;
+
+    SmallVector<MDNode *, 8> ScopeLists, NoAliasLists;
+    for (unsigned I = 0, E = Groups.size(); I != E; ++I) {
+      SmallVector<Metadata *, 8> NoAlias;
+      for (unsigned J = 0; J != E; ++J)
+        if (I != J && RtPtrChecking->needsChecking(Groups[I], Groups[J],
+                                                   nullptr))
+          NoAlias.push_back(Scopes[J]);
+      ScopeLists.push_back(MDNode::get(Context, Scopes[I]));
+      NoAliasLists.push_back(NoAlias.empty() ? nullptr
+                                             : MDNode::get(Context, NoAlias));
+    }
+
+    for (BasicBlock *BB : L->getBlocks())
+      for (Instruction &Inst : *BB) {
+        Value *Ptr = getPointerOperand(Inst);
+        if (!Ptr)
+          continue;
+        auto GI = PtrToGroup.find(Ptr);
+        if (GI == PtrToGroup.end() || !NoAliasLists[GI->second])
+          continue;
+        unsigned G = GI->second;
+        Inst.setMetadata(
+            LLVMContext::MD_alias_scope,
+            MDNode::concatenate(Inst.getMetadata(LLVMContext::MD_alias_scope),
+                                ScopeLists[G]));
+        Inst.setMetadata(
+            LLVMContext::MD_noalias,
+            MDNode::concatenate(Inst.getMetadata(LLVMContext::MD_noalias),
+                                NoAliasLists[G]));
+      }
+  }
+
+  /// \brief Try to version an inner-most loop.
+  bool processLoop(Loop *L) {
+    assert(L->empty() && "Only process inner loops.");
+
+    DEBUG(dbgs() << "\nLVerLICM: In \""
+                 << L->getHeader()->getParent()->getName() << "\" checking "
+                 << *L << "\n");
+
+    if (isVersioningDisabled(L)) {
+      DEBUG(dbgs() << "Skipping; already versioned\n");
+      return false;
+    }
+    // LoopVersioning relies on the exit block being dedicated to the loop.
+    if (!L->isLoopSimplifyForm()) {
+      DEBUG(dbgs() << "Skipping; not in loop-simplify form\n");
+      return false;
+    }
+    BasicBlock *PH = L->getLoopPreheader();
+    if (!L->getExitBlock()) {
+      DEBUG(dbgs() << "Skipping; multiple exit blocks\n");
+      return false;
+    }
+    if (!hasInvariantLoadBlockedByStores(L)) {
+      DEBUG(dbgs() << "Skipping; no invariant load next to stores\n");
+      return false;
+    }
+
+    unsigned Size = 0;
+    for (BasicBlock *BB : L->getBlocks())
+      Size += BB->size();
+    if (Size > MaxLoopSize) {
+      DEBUG(dbgs() << "Skipping; loop too large to duplicate\n");
+      ++NumTooLarge;
+      return false;
+    }
+
+    // LAA will check that we only have a single exiting block.
+    const LoopAccessInfo &LAI = LAA->getInfo(L, ValueToValueMap());
+    if (!LAI.canVectorizeMemory()) {
+      DEBUG(dbgs() << "Skipping; memory accesses cannot be disambiguated\n");
+      return false;
+    }
+
+    LoopVersioning LVer(LAI, L, LI, DT);
+    if (!LVer.needsRuntimeChecks()) {
+      DEBUG(dbgs() << "Skipping; no run-time checks needed\n");
+      return false;
+    }
+    if (LAI.getNumRuntimePointerChecks() > MaxRuntimeChecks) {
+      DEBUG(dbgs() << "Skipping; too many run-time checks\n");
+      ++NumTooManyChecks;
+      return false;
+    }
+
+    // Only version the loop if the checks would free an invariant load.  LICM
+    // never hoists volatile or atomic loads, so those do not count.
+    bool ChecksInvariantLoad = false;
+    for (BasicBlock *BB : L->getBlocks())
+      for (Instruction &I : *BB)
+        if (LoadInst *Ld = dyn_cast<LoadInst>(&I))
+          if (Ld->isSimple() && L->isLoopInvariant(Ld->getPointerOperand()))
+            for (const auto &P : LAI.getRuntimePointerChecking()->Pointers)
+              if (P.PointerValue == Ld->getPointerOperand())
+                ChecksInvariantLoad = true;
+    if (!ChecksInvariantLoad) {
+      DEBUG(dbgs() << "Skipping; no invariant load is checked\n");
+      return false;
+    }
+
+    DEBUG(dbgs() << "\nPointers:\n");
+    DEBUG(LAI.getRuntimePointerChecking()->print(dbgs(), 0));
+
+    auto DefsUsedOutside = findDefsUsedOutsideOfLoop(L);
+
+    // To keep things simple have an empty preheader before we version the
+    // loop.  (Also split if this has no predecessor, i.e. entry, because we
+    // rely on PH having a predecessor.)
+    if (!PH->getSinglePredecessor() || &*PH->begin() != PH->getTerminator())
+      SplitBlock(PH, PH->getTerminator(), DT, LI);
+
+    LVer.versionLoop(this);
+    LVer.addPHINodes(DefsUsedOutside);
+    annotateNoAlias(LVer.getVersionedLoop(), LAI);
+
+    disableVersioning(LVer.getVersionedLoop());
+    disableVersioning(LVer.getNonVersionedLoop());
+
+    ++NumLoopsVersioned;
+    return true;
+  }
+
+  // Analyses used.
+  LoopInfo *LI;
+  LoopAccessAnalysis *LAA;
+  DominatorTree *DT;
+};
+} // anonymous namespace
+
+char LoopVersioningLICM::ID;
+static const char lvlicm_name[] = "Loop Versioning For LICM";
+
+INITIALIZE_PASS_BEGIN(LoopVersioningLICM, LVLICM_NAME, lvlicm_name, false,
+                      false)
+INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(LoopAccessAnalysis)
+INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
+INITIALIZE_PASS_END(LoopVersioningLICM, LVLICM_NAME, lvlicm_name, false,
+                    false)
+
+namespace llvm {
+FunctionPass *createLoopVersioningLICMPass() {
+  return new LoopVersioningLICM();
+}
+}
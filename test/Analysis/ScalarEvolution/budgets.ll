@@ -0,0 +1,72 @@
+; RUN: opt < %s -analyze -scalar-evolution | FileCheck %s
+; RUN: opt < %s -analyze -scalar-evolution -scalar-evolution-max-value-depth=2 \
+; RUN:   | FileCheck %s --check-prefix=DEPTH
+; RUN: opt < %s -analyze -scalar-evolution \
+; RUN:   -scalar-evolution-max-arith-operands=2 | FileCheck %s --check-prefix=OPS
+
+; The blocks are laid out backwards so that the first value printed needs
+; the whole chain below it.  Adds and multiplies alternate because a chain of
+; either alone is flattened without recursing.  With a small depth budget the
+; chain is cut off and the rest is treated as an opaque value; the constants
+; cut off with it still fold later on.  The value at the cut is not cached, so
+; it is analyzed in full when it is printed, while the values built on it keep
+; it opaque: the same value gives different expressions depending on the depth
+; it is reached at.
+
+define i32 @chain(i32 %x) {
+entry:
+  br label %b1
+
+b4:
+; CHECK: %a4 = add i32 %a3, %x
+; CHECK-NEXT: -->  (13 * %x)
+; DEPTH: %a4 = add i32 %a3, %x
+; DEPTH-NEXT: -->  ((3 * %a2) + %x)
+  %a4 = add i32 %a3, %x
+  ret i32 %a4
+
+b3:
+  %a3 = mul i32 %a2, 3
+  br label %b4
+
+b2:
+; DEPTH: %a2 = add i32 %a1, %x
+; DEPTH-NEXT: -->  (4 * %x)
+  %a2 = add i32 %a1, %x
+  br label %b3
+
+b1:
+; DEPTH: %a1 = mul i32 %x, 3
+; DEPTH-NEXT: -->  (3 * %x)
+  %a1 = mul i32 %x, 3
+  br label %b2
+}
+
+; The same chain in order: every value is analyzed before its users, so a
+; user at the cut-off depth finds its operands cached and folds in full.
+
+define i32 @chain_in_order(i32 %x) {
+; DEPTH-LABEL: Classifying expressions for: @chain_in_order
+; DEPTH: %a2 = add i32 %a1, %x
+; DEPTH-NEXT: -->  (4 * %x)
+; DEPTH: %a4 = add i32 %a3, %x
+; DEPTH-NEXT: -->  (13 * %x)
+  %a1 = mul i32 %x, 3
+  %a2 = add i32 %a1, %x
+  %a3 = mul i32 %a2, 3
+  %a4 = add i32 %a3, %x
+  ret i32 %a4
+}
+
+; Past the operand budget, sums are built without combining like terms.
+
+define i32 @sum(i32 %x, i32 %y, i32 %z) {
+; CHECK: %t = sub i32 %s, %x
+; CHECK-NEXT: -->  (%y + %z)
+; OPS: %t = sub i32 %s, %x
+; OPS-NEXT: -->  ((-1 * %x) + %x + %y + %z)
+  %xy = add i32 %x, %y
+  %s = add i32 %xy, %z
+  %t = sub i32 %s, %x
+  ret i32 %t
+}
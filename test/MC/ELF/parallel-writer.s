@@ -0,0 +1,38 @@
+// Relocations and compressed debug sections are produced on several threads;
+// the object must not depend on how many.
+// RUN: llvm-mc -filetype=obj -compress-debug-sections -triple x86_64-pc-linux-gnu \
+// RUN:     -elf-writer-threads=1 %s -o %t.1
+// RUN: llvm-mc -filetype=obj -compress-debug-sections -triple x86_64-pc-linux-gnu \
+// RUN:     -elf-writer-threads=4 %s -o %t.4
+// RUN: cmp %t.1 %t.4
+// RUN: llvm-readobj -r %t.4 | FileCheck %s
+
+// REQUIRES: zlib
+
+// CHECK:      Section ({{[0-9]+}}) .rela.text {
+// CHECK-NEXT:   0x1 R_X86_64_PC32 foo 0xFFFFFFFFFFFFFFFC
+// CHECK-NEXT:   0x6 R_X86_64_PC32 bar 0xFFFFFFFFFFFFFFFC
+// CHECK-NEXT: }
+// CHECK:      Section ({{[0-9]+}}) .rela.data {
+// CHECK-NEXT:   0x0 R_X86_64_64 foo 0x0
+// CHECK-NEXT:   0x8 R_X86_64_64 bar 0x8
+// CHECK-NEXT: }
+// CHECK:      Section ({{[0-9]+}}) .rela.text.hot {
+// CHECK-NEXT:   0x1 R_X86_64_PLT32 baz 0xFFFFFFFFFFFFFFFC
+// CHECK-NEXT: }
+
+	.text
+	call	foo
+	call	bar
+
+	.data
+	.quad	foo
+	.quad	bar+8
+
+	.section	.text.hot,"ax",@progbits
+	call	baz@PLT
+
+	.section	.debug_str,"MS",@progbits,1
+	.ascii	"a string that is long enough to be worth compressing, "
+	.ascii	"repeated: a string that is long enough to be worth compressing"
+	.byte	0
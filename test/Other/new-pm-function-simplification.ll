@@ -0,0 +1,33 @@
+; The function simplification pipeline of the new pass manager, and the reuse
+; of the analyses the passes in it preserve. There is no default pipeline yet.
+;
+; RUN: opt -disable-output -disable-verify -debug-pass-manager \
+; RUN:     -passes=function-simplification %s 2>&1 \
+; RUN:     | FileCheck %s --check-prefix=CHECK-O
+; RUN: opt -disable-output -disable-verify -debug-pass-manager \
+; RUN:     -passes='no-op-module,function-simplification' %s 2>&1 \
+; RUN:     | FileCheck %s --check-prefix=CHECK-O
+; RUN: not opt -disable-output -passes=default %s 2>&1 \
+; RUN:     | FileCheck %s --check-prefix=CHECK-BAD
+;
+; CHECK-O: Starting pass manager
+; CHECK-O: Running pass: ModuleToPostOrderCGSCCPassAdaptor
+; CHECK-O: Running pass: CGSCCToFunctionPassAdaptor
+; CHECK-O: Running pass: LowerExpectIntrinsicPass
+; CHECK-O: Running pass: SimplifyCFGPass
+; CHECK-O: Running pass: EarlyCSEPass
+; CHECK-O: Running analysis: DominatorTreeAnalysis
+; CHECK-O: Running pass: InstCombinePass
+; The multiply becomes a shift, which keeps the CFG and so the dominator tree.
+; CHECK-O-NOT: Running analysis: DominatorTreeAnalysis
+; CHECK-O: Running pass: SimplifyCFGPass
+; CHECK-O: Invalidating analysis: DominatorTreeAnalysis
+; CHECK-O: Running pass: InstCombinePass
+; CHECK-O: Finished pass manager
+;
+; CHECK-BAD: unable to parse pass pipeline description
+
+define i32 @f(i32 %x) {
+  %m = mul i32 %x, 8
+  ret i32 %m
+}
@@ -0,0 +1,89 @@
+; Optimizing parts of the module on separate threads gives the same code as
+; optimizing it on one. Globals created by the passes may be named
+; differently, so the output is checked rather than diffed.
+; RUN: opt -S -instcombine -simplifycfg %s | FileCheck %s
+; RUN: opt -S -instcombine -simplifycfg -function-threads=3 %s | FileCheck %s
+; RUN: opt -S -instcombine -function-threads=2 %s | FileCheck %s --check-prefix=ALIGN
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+$comdat_fn = comdat any
+
+@counter = internal global i32 0
+@table = private unnamed_addr constant [2 x i32] [i32 3, i32 5]
+@0 = internal global i32 7
+@llvm.used = appending global [1 x i8*] [i8* bitcast (i32 (i32)* @helper to i8*)], section "llvm.metadata"
+@.fmt = private unnamed_addr constant [5 x i8] c"abc\0A\00"
+@g = global i64 0, align 4
+
+; CHECK: @counter = internal global i32 0
+; CHECK: @table = private unnamed_addr constant [2 x i32] [i32 3, i32 5]
+; CHECK: @0 = internal global i32 7
+; CHECK: @llvm.used = appending global
+; CHECK: @[[STR:str(\.[0-9]+)?]] = private unnamed_addr constant [4 x i8] c"abc\00"
+
+; CHECK-LABEL: define internal i32 @helper(
+; CHECK-NEXT: shl i32 %x, 3
+define internal i32 @helper(i32 %x) {
+  %m = mul i32 %x, 8
+  ret i32 %m
+}
+
+; CHECK-LABEL: define i32 @user(
+; CHECK: call i32 @helper(
+; CHECK: load i32, i32* @counter
+; CHECK: load i32, i32* @0
+define i32 @user(i32 %x) {
+  %c = call i32 @helper(i32 %x)
+  %v = load i32, i32* @counter
+  %w = load i32, i32* @0
+  %s = add i32 %c, %v
+  %t = add i32 %s, %w
+  ret i32 %t
+}
+
+; The load from the constant table folds even though the table is defined in
+; the module the function is linked back into.
+; CHECK-LABEL: define linkonce_odr i32 @comdat_fn() comdat {
+; CHECK-NEXT: ret i32 5
+define linkonce_odr i32 @comdat_fn() comdat {
+  %p = getelementptr [2 x i32], [2 x i32]* @table, i32 0, i32 1
+  %v = load i32, i32* %p
+  ret i32 %v
+}
+
+; CHECK-LABEL: define void @branches(
+; CHECK-NEXT: entry:
+; CHECK-NEXT: store i32 1, i32* @counter
+; CHECK-NEXT: ret void
+define void @branches() {
+entry:
+  br label %next
+next:
+  store i32 1, i32* @counter
+  ret void
+}
+
+; The string that instcombine creates for the call to puts is linked back
+; from the part that made it.
+; CHECK-LABEL: define void @print(
+; CHECK-NEXT: call i32 @puts(i8* getelementptr inbounds ([4 x i8], [4 x i8]* @[[STR]], i64 0, i64 0))
+; CHECK-NEXT: ret void
+define void @print() {
+  %f = getelementptr [5 x i8], [5 x i8]* @.fmt, i64 0, i64 0
+  %r = call i32 (i8*, ...) @printf(i8* %f)
+  ret void
+}
+
+declare i32 @printf(i8*, ...)
+
+; Instcombine raises the alignment of @g in the part that loads from it; the
+; definition in the original module has to be raised with it.
+; ALIGN: @g = global i64 0, align [[A:[0-9]+]]
+; ALIGN-LABEL: define i64 @load_g(
+; ALIGN-NEXT: load i64, i64* @g, align [[A]]
+define i64 @load_g() {
+  %v = load i64, i64* @g, align 4
+  ret i64 %v
+}
@@ -0,0 +1,82 @@
+; RUN: opt -S -codegenprepare < %s | FileCheck %s
+; RUN: opt -S -codegenprepare -disable-cgp-memcmp-expansion < %s | FileCheck %s --check-prefix=DISABLED
+; RUN: opt -S -codegenprepare -disable-simplify-libcalls < %s | FileCheck %s --check-prefix=DISABLED
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+declare i32 @memcmp(i8* nocapture, i8* nocapture, i64)
+
+; Only equality is observed: two 8 byte chunks are XORed and ORed together.
+; CHECK-LABEL: @cmp_eq16(
+; CHECK-NOT: call i32 @memcmp
+; CHECK: load i64, i64* {{.*}}, align 1
+; CHECK: xor i64
+; CHECK: xor i64
+; CHECK: or i64
+; CHECK: icmp ne i64
+; CHECK: ret i1
+; DISABLED-LABEL: @cmp_eq16(
+; DISABLED: call i32 @memcmp
+define i1 @cmp_eq16(i8* %x, i8* %y) {
+  %call = tail call i32 @memcmp(i8* %x, i8* %y, i64 16)
+  %cmp = icmp eq i32 %call, 0
+  ret i1 %cmp
+}
+
+; A single chunk is compared without branches.
+; CHECK-LABEL: @cmp4(
+; CHECK-NOT: call i32 @memcmp
+; CHECK: call i32 @llvm.bswap.i32
+; CHECK: call i32 @llvm.bswap.i32
+; CHECK: icmp ult i64
+; CHECK: select i1 {{.*}}, i32 -1, i32 1
+; CHECK-NOT: br
+; CHECK: ret i32
+define i32 @cmp4(i8* %x, i8* %y) {
+  %call = tail call i32 @memcmp(i8* %x, i8* %y, i64 4)
+  ret i32 %call
+}
+
+; 12 bytes are an 8 byte and a 4 byte chunk, each in its own block.
+; CHECK-LABEL: @cmp12(
+; CHECK-NOT: call i32 @memcmp
+; CHECK: call i64 @llvm.bswap.i64
+; CHECK: br i1 {{.*}}, label %memcmp.loadbb, label %memcmp.res
+; CHECK: memcmp.loadbb:
+; CHECK: call i32 @llvm.bswap.i32
+; CHECK: br i1 {{.*}}, label %memcmp.end, label %memcmp.res
+; CHECK: memcmp.res:
+; CHECK: select i1 {{.*}}, i32 -1, i32 1
+; CHECK: memcmp.end:
+; CHECK: phi i32 [ {{.*}}, %memcmp.res ], [ 0, %memcmp.loadbb ]
+define i32 @cmp12(i8* %x, i8* %y) {
+  %call = tail call i32 @memcmp(i8* %x, i8* %y, i64 12)
+  ret i32 %call
+}
+
+; More than eight loads would be needed, so the call stays.
+; CHECK-LABEL: @cmp128(
+; CHECK: call i32 @memcmp
+define i32 @cmp128(i8* %x, i8* %y) {
+  %call = tail call i32 @memcmp(i8* %x, i8* %y, i64 128)
+  ret i32 %call
+}
+
+; Expanding into more than one load is not done when optimizing for size.
+; CHECK-LABEL: @cmp16_optsize(
+; CHECK: call i32 @memcmp
+define i32 @cmp16_optsize(i8* %x, i8* %y) optsize {
+  %call = tail call i32 @memcmp(i8* %x, i8* %y, i64 16)
+  ret i32 %call
+}
+
+; A nobuiltin call site is not treated as the library function.
+; CHECK-LABEL: @cmp4_nobuiltin(
+; CHECK: call i32 @memcmp(i8* %x, i8* %y, i64 4) #
+define i32 @cmp4_nobuiltin(i8* %x, i8* %y) {
+  %call = tail call i32 @memcmp(i8* %x, i8* %y, i64 4) #0
+  ret i32 %call
+}
+
+attributes #0 = { nobuiltin }
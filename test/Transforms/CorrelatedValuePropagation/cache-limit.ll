@@ -0,0 +1,59 @@
+; RUN: opt < %s -correlated-propagation -lvi-cache-entry-limit=2 -S | FileCheck %s
+; RUN: opt < %s -jump-threading -lvi-cache-entry-limit=2 -S | FileCheck %s --check-prefix=JT
+
+; Evicting cached results between queries must not change the answers, only
+; cause them to be recomputed.
+
+declare void @use(i1)
+
+; CHECK-LABEL: @test1(
+define void @test1(i32 %x) {
+entry:
+  %c = icmp ult i32 %x, 10
+  br i1 %c, label %bb1, label %exit
+
+bb1:
+  %c1 = icmp ult i32 %x, 20
+; CHECK: call void @use(i1 true)
+  call void @use(i1 %c1)
+  %c2 = icmp eq i32 %x, 15
+; CHECK: call void @use(i1 false)
+  call void @use(i1 %c2)
+  %c3 = icmp ugt i32 %x, 9
+; CHECK: call void @use(i1 false)
+  call void @use(i1 %c3)
+  br label %exit
+
+exit:
+  ret void
+}
+
+; The second compare is known on both incoming edges, so the join is threaded
+; away.
+; JT-LABEL: @test2(
+; JT: icmp eq i32 %x, 5
+; JT-NOT: icmp eq i32 %x, 5
+; JT: ret i32 1
+define i32 @test2(i32 %x, i1 %p) {
+entry:
+  %c = icmp eq i32 %x, 5
+  br i1 %c, label %a, label %b
+
+a:
+  call void @use(i1 %p)
+  br label %join
+
+b:
+  call void @use(i1 %p)
+  br label %join
+
+join:
+  %c2 = icmp eq i32 %x, 5
+  br i1 %c2, label %t, label %f
+
+t:
+  ret i32 1
+
+f:
+  ret i32 2
+}
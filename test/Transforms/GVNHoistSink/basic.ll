@@ -0,0 +1,153 @@
+; RUN: opt < %s -basicaa -gvn-hoist-sink -S | FileCheck %s
+
+declare void @f()
+
+; Equivalent computations on both sides of a branch, including a commuted
+; add and a load, are hoisted into the branching block.
+define i32 @hoist(i1 %c, i32 %a, i32 %b, i32* %p) {
+; CHECK-LABEL: @hoist(
+; CHECK: entry:
+; CHECK-NEXT: %x1 = add i32 %a, %b
+; CHECK-NEXT: %y1 = mul i32 %x1, 3
+; CHECK-NEXT: %l1 = load i32, i32* %p
+; CHECK-NEXT: br i1 %c
+; CHECK: then:
+; CHECK-NEXT: %r1 = sub i32 %y1, %l1
+; CHECK: else:
+; CHECK-NEXT: %r2 = xor i32 %y1, %l1
+entry:
+  br i1 %c, label %then, label %else
+
+then:
+  %x1 = add nsw i32 %a, %b
+  %y1 = mul i32 %x1, 3
+  %l1 = load i32, i32* %p
+  %r1 = sub i32 %y1, %l1
+  br label %end
+
+else:
+  %x2 = add i32 %b, %a
+  %y2 = mul i32 %x2, 3
+  %l2 = load i32, i32* %p
+  %r2 = xor i32 %y2, %l2
+  br label %end
+
+end:
+  %r = phi i32 [ %r1, %then ], [ %r2, %else ]
+  ret i32 %r
+}
+
+; A load that may be clobbered by an earlier store in its block is not
+; hoisted above the store, but can still be sunk below it.
+define i32 @no_hoist_clobbered_load(i1 %c, i32* %p, i32* %q) {
+; CHECK-LABEL: @no_hoist_clobbered_load(
+; CHECK: entry:
+; CHECK-NEXT: br i1 %c
+; CHECK: then:
+; CHECK-NEXT: store i32 0, i32* %q
+; CHECK-NEXT: br label %end
+; CHECK: else:
+; CHECK-NEXT: br label %end
+; CHECK: end:
+; CHECK-NEXT: %l2 = load i32, i32* %p
+; CHECK-NEXT: ret i32 %l2
+entry:
+  br i1 %c, label %then, label %else
+
+then:
+  store i32 0, i32* %q
+  %l1 = load i32, i32* %p
+  br label %end
+
+else:
+  %l2 = load i32, i32* %p
+  br label %end
+
+end:
+  %r = phi i32 [ %l1, %then ], [ %l2, %else ]
+  ret i32 %r
+}
+
+; A division that may trap is not hoisted above a call that may not return,
+; but it is sunk below it.
+define i32 @no_hoist_past_call(i1 %c, i32 %a, i32 %b) {
+; CHECK-LABEL: @no_hoist_past_call(
+; CHECK: entry:
+; CHECK-NEXT: br i1 %c
+; CHECK: then:
+; CHECK-NEXT: call void @f()
+; CHECK-NEXT: br label %end
+; CHECK: end:
+; CHECK-NEXT: %d2 = sdiv i32 %a, %b
+entry:
+  br i1 %c, label %then, label %else
+
+then:
+  call void @f()
+  %d1 = sdiv i32 %a, %b
+  br label %end
+
+else:
+  %d2 = sdiv i32 %a, %b
+  br label %end
+
+end:
+  %r = phi i32 [ %d1, %then ], [ %d2, %else ]
+  ret i32 %r
+}
+
+; Stores and the computations feeding them are sunk into the join block,
+; with PHI nodes for the operands that differ.
+define void @sink(i1 %c, i32 %a, i32 %b, i32* %p) {
+; CHECK-LABEL: @sink(
+; CHECK: then:
+; CHECK-NEXT: br label %end
+; CHECK: else:
+; CHECK-NEXT: br label %end
+; CHECK: end:
+; CHECK-NEXT: %b.sink = phi i32 [ %b, %else ], [ %a, %then ]
+; CHECK-NEXT: %x2 = add i32 %b.sink, 1
+; CHECK-NEXT: store i32 %x2, i32* %p
+; CHECK-NEXT: ret void
+entry:
+  br i1 %c, label %then, label %else
+
+then:
+  %x1 = add i32 %a, 1
+  store i32 %x1, i32* %p
+  br label %end
+
+else:
+  %x2 = add i32 %b, 1
+  store i32 %x2, i32* %p
+  br label %end
+
+end:
+  ret void
+}
+
+; A store is not sunk past a call that may not return.
+define void @no_sink_past_call(i1 %c, i32 %a, i32 %b, i32* %p) {
+; CHECK-LABEL: @no_sink_past_call(
+; CHECK: then:
+; CHECK-NEXT: store i32 %a, i32* %p
+; CHECK-NEXT: call void @f()
+; CHECK: else:
+; CHECK-NEXT: store i32 %b, i32* %p
+; CHECK: end:
+; CHECK-NEXT: ret void
+entry:
+  br i1 %c, label %then, label %else
+
+then:
+  store i32 %a, i32* %p
+  call void @f()
+  br label %end
+
+else:
+  store i32 %b, i32* %p
+  br label %end
+
+end:
+  ret void
+}
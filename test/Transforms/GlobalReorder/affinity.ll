@@ -0,0 +1,57 @@
+; RUN: opt < %s -reorder-globals -S | FileCheck %s
+; RUN: opt < %s -reorder-globals -reorder-globals-cold-section=.data.cold -S \
+; RUN:   | FileCheck %s --check-prefix=SECTION
+
+; @x and @y are used together in a loop, so they are hottest and adjacent.
+; @z is only used once on entry. @cold and @ro are never used and go last,
+; in their original order. The zero-initialized globals are left where they
+; are, ahead of the moved ones, even though @bss is hot, so that they stay in
+; .bss.
+
+; CHECK: @bss = global i32 0
+; CHECK-NEXT: @cold.bss = global i32 0
+; CHECK-NEXT: @x = internal global i32 1
+; CHECK-NEXT: @y = internal global i32 2
+; CHECK-NEXT: @z = internal global i32 3
+; CHECK-NEXT: @cold = global i32 4
+; CHECK-NEXT: @ro = constant i32 1
+
+; Only writable cold globals are moved into the cold section, and not the ones
+; that belong in .bss.
+; SECTION: @cold.bss = global i32 0{{$}}
+; SECTION: @z = internal global i32 3{{$}}
+; SECTION: @cold = global i32 4, section ".data.cold"
+; SECTION: @ro = constant i32 1{{$}}
+
+; GlobalMerge keeps this order instead of sorting by size.
+; CHECK: !llvm.module.flags = !{!0}
+; CHECK: !0 = !{i32 2, !"Global Affinity Order", i32 1}
+
+@cold = global i32 4
+@bss = global i32 0
+@x = internal global i32 1
+@z = internal global i32 3
+@ro = constant i32 1
+@cold.bss = global i32 0
+@y = internal global i32 2
+
+define i32 @f(i32 %n) {
+entry:
+  %z = load i32, i32* @z
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %sum = phi i32 [ %z, %entry ], [ %sum.next, %loop ]
+  %x = load i32, i32* @x
+  %y = load i32, i32* @y
+  %xy = add i32 %x, %y
+  store i32 %xy, i32* @bss
+  %sum.next = add i32 %sum, %xy
+  %i.next = add i32 %i, 1
+  %cmp = icmp slt i32 %i.next, %n
+  br i1 %cmp, label %loop, label %exit
+
+exit:
+  ret i32 %sum.next
+}
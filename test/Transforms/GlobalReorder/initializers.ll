@@ -0,0 +1,38 @@
+; RUN: opt < %s -reorder-globals -reorder-globals-cold-section=.data.cold -S \
+; RUN:   | FileCheck %s
+
+; The names and the state referenced from the hot dispatch table are as hot as
+; the table, so they are laid out with it, smallest first, and stay out of the
+; cold section. @unused.name is only referenced from the cold @unused, so it
+; goes last with it.
+
+; CHECK: @name.a = private constant [2 x i8] c"a\00"
+; CHECK-NEXT: @name.b = private constant [2 x i8] c"b\00"
+; CHECK-NEXT: @state = internal global i32 1{{$}}
+; CHECK-NEXT: @table = internal constant [2 x %entry]
+; CHECK-NEXT: @unused = global i8* {{.*}}, section ".data.cold"
+; CHECK-NEXT: @unused.name = private constant [2 x i8] c"u\00"
+
+%entry = type { i8*, void (i32*)*, i32* }
+
+@unused = global i8* getelementptr ([2 x i8], [2 x i8]* @unused.name, i32 0, i32 0)
+@name.a = private constant [2 x i8] c"a\00"
+@unused.name = private constant [2 x i8] c"u\00"
+@state = internal global i32 1
+@name.b = private constant [2 x i8] c"b\00"
+@table = internal constant [2 x %entry] [
+  %entry { i8* getelementptr ([2 x i8], [2 x i8]* @name.a, i32 0, i32 0),
+           void (i32*)* @handler, i32* @state },
+  %entry { i8* getelementptr ([2 x i8], [2 x i8]* @name.b, i32 0, i32 0),
+           void (i32*)* @handler, i32* null }]
+
+declare void @handler(i32*)
+
+define void @dispatch(i32 %i) {
+  %fp = getelementptr [2 x %entry], [2 x %entry]* @table, i32 0, i32 %i, i32 1
+  %f = load void (i32*)*, void (i32*)** %fp
+  %sp = getelementptr [2 x %entry], [2 x %entry]* @table, i32 0, i32 %i, i32 2
+  %s = load i32*, i32** %sp
+  call void %f(i32* %s)
+  ret void
+}
@@ -0,0 +1,31 @@
+; REQUIRES: asserts
+; RUN: opt < %s -inline -inline-threshold=0 -S -stats 2>&1 | FileCheck %s
+
+; Call sites that pass the same constants to the same callee from the same
+; caller share one inline cost computation.
+
+declare void @use(i32)
+
+define internal void @callee(i32 %x) {
+entry:
+  call void @use(i32 %x)
+  call void @use(i32 %x)
+  call void @use(i32 %x)
+  call void @use(i32 %x)
+  ret void
+}
+
+define void @caller() {
+; CHECK-LABEL: define void @caller(
+; CHECK: call void @callee(i32 1)
+; CHECK: call void @callee(i32 1)
+; CHECK: call void @callee(i32 2)
+entry:
+  call void @callee(i32 1)
+  call void @callee(i32 1)
+  call void @callee(i32 2)
+  ret void
+}
+
+; CHECK-DAG: 1 inline - Number of inline costs reused from cache
+; CHECK-DAG: 2 inline - Number of inline costs computed
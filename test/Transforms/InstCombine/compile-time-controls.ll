@@ -0,0 +1,27 @@
+; RUN: opt < %s -instcombine -instcombine-max-iterations=1 \
+; RUN:   -pass-remarks-analysis=instcombine -S 2>&1 | FileCheck %s --check-prefix=LIMIT
+; RUN: opt < %s -instcombine -instcombine-revisit-changed-only -S \
+; RUN:   | FileCheck %s
+; RUN: opt < %s -instcombine -instcombine-stats -disable-output 2>&1 \
+; RUN:   | FileCheck %s --check-prefix=STATS
+
+; With a limit of one iteration the function is still combined once, but the
+; pass reports that it stopped before confirming a fixpoint.
+; LIMIT: remark: <unknown>:0:0: iteration limit of 1 reached before instcombine found a fixpoint
+; LIMIT-LABEL: define i32 @test(
+; LIMIT-NEXT: ret i32 %x
+
+; Revisiting only changed instructions reaches the same result.
+; CHECK-LABEL: define i32 @test(
+; CHECK-NEXT: ret i32 %x
+
+; STATS: InstCombine Visitor Statistics
+; STATS: Visits Hits Time (s) Opcode
+; STATS-DAG: 1 1 {{[0-9.]+}} add
+; STATS-DAG: {{[0-9]+}} 0 {{[0-9.]+}} ret
+
+define i32 @test(i32 %x) {
+  %a = add i32 %x, 0
+  %b = xor i32 %a, 0
+  ret i32 %b
+}
@@ -0,0 +1,211 @@
+; RUN: opt < %s -basicaa -licm -S | FileCheck %s
+; RUN: opt < %s -basicaa -licm -licm-conditional-promotion \
+; RUN:   -licm-conditional-promotion-min-regs=0 -S \
+; RUN:   | FileCheck %s --check-prefix=FLAG
+
+@g = global i32 0, align 4
+@tls = internal thread_local global i32 0, align 4
+@tls.const = internal thread_local constant i32 0, align 4
+
+declare void @escape(i32*)
+
+; A conditionally stored global is only promoted with a guard flag, so that
+; the exit store only happens if the loop stored.
+; CHECK-LABEL: @global_cond(
+; CHECK: for.body:
+; CHECK: load i32, i32* @g
+; CHECK: store i32 {{.*}}, i32* @g
+; FLAG-LABEL: @global_cond(
+; FLAG: entry:
+; FLAG: %g.promoted = load i32, i32* @g
+; FLAG: for.body:
+; FLAG-NOT: load i32, i32* @g
+; FLAG-NOT: store i32 {{.*}}, i32* @g
+; FLAG: for.end:
+; FLAG: %[[FLAG:.*]] = phi i1
+; FLAG: br i1 %[[FLAG]], label %for.end.store, label %for.end.split
+; FLAG: for.end.store:
+; FLAG-NEXT: store i32 %{{.*}}, i32* @g
+; FLAG-NEXT: br label %for.end.split
+; FLAG: for.end.split:
+; FLAG-NEXT: ret void
+define void @global_cond(i32 %n, i32* noalias %c) {
+entry:
+  br label %for.cond
+
+for.cond:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %for.inc ]
+  %cmp = icmp slt i32 %i, %n
+  br i1 %cmp, label %for.body, label %for.end
+
+for.body:
+  %idx = getelementptr inbounds i32, i32* %c, i32 %i
+  %cv = load i32, i32* %idx
+  %tobool = icmp eq i32 %cv, 0
+  br i1 %tobool, label %for.inc, label %if.then
+
+if.then:
+  %v = load i32, i32* @g, align 4
+  %inc = add nsw i32 %v, 1
+  store i32 %inc, i32* @g, align 4
+  br label %for.inc
+
+for.inc:
+  %i.next = add nsw i32 %i, 1
+  br label %for.cond
+
+for.end:
+  ret void
+}
+
+; A local whose address does not escape cannot be observed by another thread,
+; so it is promoted with an unconditional store at the exit.
+; CHECK-LABEL: @local_cond(
+; CHECK: entry:
+; CHECK: %sum.promoted = load i32, i32* %sum
+; CHECK: for.body:
+; CHECK-NOT: store i32 {{.*}}, i32* %sum
+; CHECK: for.end:
+; CHECK: store i32 %{{.*}}, i32* %sum
+define i32 @local_cond(i32 %n, i32* noalias %c) {
+entry:
+  %sum = alloca i32, align 4
+  store i32 0, i32* %sum, align 4
+  br label %for.cond
+
+for.cond:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %for.inc ]
+  %cmp = icmp slt i32 %i, %n
+  br i1 %cmp, label %for.body, label %for.end
+
+for.body:
+  %idx = getelementptr inbounds i32, i32* %c, i32 %i
+  %cv = load i32, i32* %idx
+  %tobool = icmp eq i32 %cv, 0
+  br i1 %tobool, label %for.inc, label %if.then
+
+if.then:
+  %v = load i32, i32* %sum, align 4
+  %add = add nsw i32 %v, %cv
+  store i32 %add, i32* %sum, align 4
+  br label %for.inc
+
+for.inc:
+  %i.next = add nsw i32 %i, 1
+  br label %for.cond
+
+for.end:
+  %r = load i32, i32* %sum, align 4
+  ret i32 %r
+}
+
+; Once the address escapes, the local is treated like any other memory.
+; CHECK-LABEL: @local_escaped(
+; CHECK: if.then:
+; CHECK: store i32 %{{.*}}, i32* %sum
+define i32 @local_escaped(i32 %n, i32* noalias %c) {
+entry:
+  %sum = alloca i32, align 4
+  store i32 0, i32* %sum, align 4
+  call void @escape(i32* %sum)
+  br label %for.cond
+
+for.cond:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %for.inc ]
+  %cmp = icmp slt i32 %i, %n
+  br i1 %cmp, label %for.body, label %for.end
+
+for.body:
+  %idx = getelementptr inbounds i32, i32* %c, i32 %i
+  %cv = load i32, i32* %idx
+  %tobool = icmp eq i32 %cv, 0
+  br i1 %tobool, label %for.inc, label %if.then
+
+if.then:
+  %v = load i32, i32* %sum, align 4
+  %add = add nsw i32 %v, %cv
+  store i32 %add, i32* %sum, align 4
+  br label %for.inc
+
+for.inc:
+  %i.next = add nsw i32 %i, 1
+  br label %for.cond
+
+for.end:
+  %r = load i32, i32* %sum, align 4
+  ret i32 %r
+}
+
+
+; Another thread cannot see an internal thread_local global whose address is
+; not taken, so it is promoted like a local.
+; CHECK-LABEL: @tls_cond(
+; CHECK: entry:
+; CHECK: %tls.promoted = load i32, i32* @tls
+; CHECK: for.body:
+; CHECK-NOT: store i32 {{.*}}, i32* @tls
+; CHECK: for.end:
+; CHECK: store i32 %{{.*}}, i32* @tls
+define void @tls_cond(i32 %n, i32* noalias %c) {
+entry:
+  br label %for.cond
+
+for.cond:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %for.inc ]
+  %cmp = icmp slt i32 %i, %n
+  br i1 %cmp, label %for.body, label %for.end
+
+for.body:
+  %idx = getelementptr inbounds i32, i32* %c, i32 %i
+  %cv = load i32, i32* %idx
+  %tobool = icmp eq i32 %cv, 0
+  br i1 %tobool, label %for.inc, label %if.then
+
+if.then:
+  %v = load i32, i32* @tls, align 4
+  %inc = add nsw i32 %v, 1
+  store i32 %inc, i32* @tls, align 4
+  br label %for.inc
+
+for.inc:
+  %i.next = add nsw i32 %i, 1
+  br label %for.cond
+
+for.end:
+  ret void
+}
+
+; A thread_local constant may be read-only, so no store may be added to it.
+; CHECK-LABEL: @tls_const_cond(
+; CHECK: if.then:
+; CHECK: store i32 {{.*}}, i32* @tls.const
+; CHECK: for.end:
+; CHECK-NEXT: ret void
+define void @tls_const_cond(i32 %n, i32* noalias %c) {
+entry:
+  br label %for.cond
+
+for.cond:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %for.inc ]
+  %cmp = icmp slt i32 %i, %n
+  br i1 %cmp, label %for.body, label %for.end
+
+for.body:
+  %idx = getelementptr inbounds i32, i32* %c, i32 %i
+  %cv = load i32, i32* %idx
+  %tobool = icmp eq i32 %cv, 0
+  br i1 %tobool, label %for.inc, label %if.then
+
+if.then:
+  %v = load i32, i32* @tls.const, align 4
+  %inc = add nsw i32 %v, 1
+  store i32 %inc, i32* @tls.const, align 4
+  br label %for.inc
+
+for.inc:
+  %i.next = add nsw i32 %i, 1
+  br label %for.cond
+
+for.end:
+  ret void
+}
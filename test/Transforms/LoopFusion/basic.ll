@@ -0,0 +1,220 @@
+; RUN: opt -basicaa -loop-fusion -S < %s | FileCheck %s
+; RUN: opt -basicaa -loop-fusion -indvars -gvn -S < %s \
+; RUN:     | FileCheck %s --check-prefix=GVN
+;
+; Once the loops are fused and their induction variables merged, the value
+; stored to the intermediate array is forwarded to the load from it.
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+; The second loop reads y[i] in the same iteration the first loop writes it:
+;
+;   for (i = 0; i < 100; i++) y[i] = a[i] * k;
+;   for (i = 0; i < 100; i++) z[i] = y[i] + b[i];
+
+; CHECK-LABEL: @fuse(
+; CHECK: entry:
+; CHECK-NEXT: br label %loop1
+; CHECK: loop1:
+; CHECK-NEXT: %i = phi i64 [ 0, %entry ], [ %i.next, %loop2 ]
+; CHECK-NEXT: %j = phi i64 [ 0, %entry ], [ %j.next, %loop2 ]
+; CHECK: store i32 %mul, i32* %y.i
+; CHECK-NEXT: %i.next = add nuw nsw i64 %i, 1
+; CHECK-NEXT: br label %loop2
+; CHECK: loop2:
+; CHECK: %y.val = load i32, i32* %y.j
+; CHECK: br i1 %exit2, label %end, label %loop1
+; CHECK: end:
+; CHECK-NEXT: ret void
+
+; GVN-LABEL: @fuse(
+; GVN-NOT: load i32, i32* %y
+; GVN: %add = add i32 %mul, %b.val
+define void @fuse(i32* noalias %a, i32* noalias %b, i32* noalias %y,
+                  i32* noalias %z, i32 %k) {
+entry:
+  br label %loop1
+
+loop1:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop1 ]
+  %a.i = getelementptr inbounds i32, i32* %a, i64 %i
+  %a.val = load i32, i32* %a.i
+  %mul = mul i32 %a.val, %k
+  %y.i = getelementptr inbounds i32, i32* %y, i64 %i
+  store i32 %mul, i32* %y.i
+  %i.next = add nuw nsw i64 %i, 1
+  %exit1 = icmp eq i64 %i.next, 100
+  br i1 %exit1, label %mid, label %loop1
+
+mid:
+  br label %loop2
+
+loop2:
+  %j = phi i64 [ 0, %mid ], [ %j.next, %loop2 ]
+  %y.j = getelementptr inbounds i32, i32* %y, i64 %j
+  %y.val = load i32, i32* %y.j
+  %b.j = getelementptr inbounds i32, i32* %b, i64 %j
+  %b.val = load i32, i32* %b.j
+  %add = add i32 %y.val, %b.val
+  %z.j = getelementptr inbounds i32, i32* %z, i64 %j
+  store i32 %add, i32* %z.j
+  %j.next = add nuw nsw i64 %j, 1
+  %exit2 = icmp eq i64 %j.next, 100
+  br i1 %exit2, label %end, label %loop2
+
+end:
+  ret void
+}
+
+; Reading y[i + 1] in the second loop needs the value the first loop stores
+; in the next iteration, so the loops cannot be fused.
+;
+;   for (i = 0; i < 100; i++) y[i] = a[i];
+;   for (i = 0; i < 100; i++) z[i] = y[i + 1];
+
+; CHECK-LABEL: @forward_dependence(
+; CHECK: br i1 %exit1, label %mid, label %loop1
+; CHECK: mid:
+; CHECK-NEXT: br label %loop2
+define void @forward_dependence(i32* noalias %a, i32* noalias %y,
+                                i32* noalias %z) {
+entry:
+  br label %loop1
+
+loop1:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop1 ]
+  %a.i = getelementptr inbounds i32, i32* %a, i64 %i
+  %a.val = load i32, i32* %a.i
+  %y.i = getelementptr inbounds i32, i32* %y, i64 %i
+  store i32 %a.val, i32* %y.i
+  %i.next = add nuw nsw i64 %i, 1
+  %exit1 = icmp eq i64 %i.next, 100
+  br i1 %exit1, label %mid, label %loop1
+
+mid:
+  br label %loop2
+
+loop2:
+  %j = phi i64 [ 0, %mid ], [ %j.next, %loop2 ]
+  %j.1 = add nuw nsw i64 %j, 1
+  %y.j = getelementptr inbounds i32, i32* %y, i64 %j.1
+  %y.val = load i32, i32* %y.j
+  %z.j = getelementptr inbounds i32, i32* %z, i64 %j
+  store i32 %y.val, i32* %z.j
+  %j.next = add nuw nsw i64 %j, 1
+  %exit2 = icmp eq i64 %j.next, 100
+  br i1 %exit2, label %end, label %loop2
+
+end:
+  ret void
+}
+
+; Reading y[i - 1] only needs values stored in earlier iterations, which the
+; fused loop has already run.
+;
+;   for (i = 1; i < 100; i++) y[i] = a[i];
+;   for (i = 1; i < 100; i++) z[i] = y[i - 1];
+
+; CHECK-LABEL: @backward_dependence(
+; CHECK-NOT: mid:
+; CHECK: br label %loop2
+; CHECK: br i1 %exit2, label %end, label %loop1
+define void @backward_dependence(i32* noalias %a, i32* noalias %y,
+                                 i32* noalias %z) {
+entry:
+  br label %loop1
+
+loop1:
+  %i = phi i64 [ 1, %entry ], [ %i.next, %loop1 ]
+  %a.i = getelementptr inbounds i32, i32* %a, i64 %i
+  %a.val = load i32, i32* %a.i
+  %y.i = getelementptr inbounds i32, i32* %y, i64 %i
+  store i32 %a.val, i32* %y.i
+  %i.next = add nuw nsw i64 %i, 1
+  %exit1 = icmp eq i64 %i.next, 100
+  br i1 %exit1, label %mid, label %loop1
+
+mid:
+  br label %loop2
+
+loop2:
+  %j = phi i64 [ 1, %mid ], [ %j.next, %loop2 ]
+  %j.1 = add nsw i64 %j, -1
+  %y.j = getelementptr inbounds i32, i32* %y, i64 %j.1
+  %y.val = load i32, i32* %y.j
+  %z.j = getelementptr inbounds i32, i32* %z, i64 %j
+  store i32 %y.val, i32* %z.j
+  %j.next = add nuw nsw i64 %j, 1
+  %exit2 = icmp eq i64 %j.next, 100
+  br i1 %exit2, label %end, label %loop2
+
+end:
+  ret void
+}
+
+; The loops run a different number of times.
+
+; CHECK-LABEL: @trip_count_mismatch(
+; CHECK: mid:
+; CHECK-NEXT: br label %loop2
+define void @trip_count_mismatch(i32* noalias %a, i32* noalias %b) {
+entry:
+  br label %loop1
+
+loop1:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop1 ]
+  %a.i = getelementptr inbounds i32, i32* %a, i64 %i
+  store i32 0, i32* %a.i
+  %i.next = add nuw nsw i64 %i, 1
+  %exit1 = icmp eq i64 %i.next, 100
+  br i1 %exit1, label %mid, label %loop1
+
+mid:
+  br label %loop2
+
+loop2:
+  %j = phi i64 [ 0, %mid ], [ %j.next, %loop2 ]
+  %b.j = getelementptr inbounds i32, i32* %b, i64 %j
+  store i32 1, i32* %b.j
+  %j.next = add nuw nsw i64 %j, 1
+  %exit2 = icmp eq i64 %j.next, 50
+  br i1 %exit2, label %end, label %loop2
+
+end:
+  ret void
+}
+
+; A call in between the loops keeps them apart.
+
+; CHECK-LABEL: @not_adjacent(
+; CHECK: mid:
+; CHECK-NEXT: call void @g()
+declare void @g()
+
+define void @not_adjacent(i32* noalias %a, i32* noalias %b) {
+entry:
+  br label %loop1
+
+loop1:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop1 ]
+  %a.i = getelementptr inbounds i32, i32* %a, i64 %i
+  store i32 0, i32* %a.i
+  %i.next = add nuw nsw i64 %i, 1
+  %exit1 = icmp eq i64 %i.next, 100
+  br i1 %exit1, label %mid, label %loop1
+
+mid:
+  call void @g()
+  br label %loop2
+
+loop2:
+  %j = phi i64 [ 0, %mid ], [ %j.next, %loop2 ]
+  %b.j = getelementptr inbounds i32, i32* %b, i64 %j
+  store i32 1, i32* %b.j
+  %j.next = add nuw nsw i64 %j, 1
+  %exit2 = icmp eq i64 %j.next, 100
+  br i1 %exit2, label %end, label %loop2
+
+end:
+  ret void
+}
@@ -0,0 +1,35 @@
+; RUN: opt < %s -loop-vectorize -force-vector-interleave=1 -force-vector-width=4 -dce -instcombine -S | FileCheck %s
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; A loop-invariant pointer that may alias a stored array is its own lower and
+; upper bound, so the loop is vectorized behind a run-time check:
+; void foo(int *a, int *p, long n) {
+;   for (long i = 0; i < n; ++i)
+;     a[i] = *p;
+; }
+
+; CHECK-LABEL: define void @foo(
+; CHECK: vector.memcheck:
+; CHECK: [[AEND:%[^ ]+]] = getelementptr i32, i32* %a, i64
+; CHECK: %bound0 = icmp ule i32* %a, %p
+; CHECK: %bound1 = icmp uge i32* [[AEND]], %p
+; CHECK: br i1 %memcheck.conflict, label %middle.block, label %vector.ph
+; CHECK: store <4 x i32>
+define void @foo(i32* %a, i32* %p, i64 %n) {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %v = load i32, i32* %p, align 4
+  %arrayidx = getelementptr inbounds i32, i32* %a, i64 %i
+  store i32 %v, i32* %arrayidx, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %cmp = icmp slt i64 %i.next, %n
+  br i1 %cmp, label %for.body, label %for.end
+
+for.end:
+  ret void
+}
@@ -0,0 +1,85 @@
+; RUN: opt < %s -basicaa -scoped-noalias -loop-versioning-licm -licm -S | FileCheck %s
+; RUN: opt < %s -basicaa -scoped-noalias -loop-versioning-licm -licm-versioning-max-checks=1 -S | FileCheck %s --check-prefix=LIMIT
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+; The load of the coefficient cannot be hoisted because %out may point to it.
+; After versioning, the checked copy of the loop loads it once up front.
+
+; CHECK-LABEL: @filter(
+; CHECK: for.body.lver.memcheck:
+; CHECK: br i1 %memcheck.conflict, label %for.body.ph.lver.orig, label %for.body.ph
+; CHECK: for.body.lver.orig:
+; CHECK: %c.lver.orig = load float, float* %coef
+; CHECK: for.body.ph:
+; CHECK-NEXT: %c = load float, float* %coef, align 4, !alias.scope
+; CHECK: for.body:
+; CHECK-NOT: load float, float* %coef
+; CHECK: store float %m, float* %o, align 4, !alias.scope
+; CHECK: br i1 %done, label %loopexit.loopexit, label %for.body, !llvm.loop ![[LOOP:[0-9]+]]
+
+; Two checks are needed, which is over the limit.
+; LIMIT-LABEL: @filter(
+; LIMIT-NOT: memcheck
+
+define void @filter(float* %out, float* %in, float* %coef, i64 %n) {
+entry:
+  %cmp = icmp sgt i64 %n, 0
+  br i1 %cmp, label %preheader, label %exit
+
+preheader:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %preheader ], [ %i.next, %for.body ]
+  %c = load float, float* %coef, align 4
+  %a = getelementptr inbounds float, float* %in, i64 %i
+  %x = load float, float* %a, align 4
+  %m = fmul float %x, %c
+  %o = getelementptr inbounds float, float* %out, i64 %i
+  store float %m, float* %o, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %loopexit, label %for.body
+
+loopexit:
+  br label %exit
+
+exit:
+  ret void
+}
+
+; Without an invariant load there is nothing to gain from versioning.
+
+; CHECK-LABEL: @copy(
+; CHECK-NOT: memcheck
+; CHECK: ret void
+
+define void @copy(float* %out, float* %in, i64 %n) {
+entry:
+  %cmp = icmp sgt i64 %n, 0
+  br i1 %cmp, label %preheader, label %exit
+
+preheader:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %preheader ], [ %i.next, %for.body ]
+  %a = getelementptr inbounds float, float* %in, i64 %i
+  %x = load float, float* %a, align 4
+  %o = getelementptr inbounds float, float* %out, i64 %i
+  store float %x, float* %o, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %loopexit, label %for.body
+
+loopexit:
+  br label %exit
+
+exit:
+  ret void
+}
+
+; The checked copy is marked so that it is not versioned again.
+; CHECK: ![[DISABLE:[0-9]+]] = !{!"llvm.loop.licm_versioning.disable"}
+; CHECK: ![[LOOP]] = distinct !{![[LOOP]], ![[DISABLE]]}
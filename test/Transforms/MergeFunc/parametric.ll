@@ -0,0 +1,126 @@
+; RUN: opt -S -mergefunc -mergefunc-parametric < %s | FileCheck %s
+; RUN: opt -S -mergefunc < %s | FileCheck %s --check-prefix=NOPARAM
+
+; Accessors that only differ in the global they touch and a constant are
+; merged into one body taking both as parameters.
+
+@a = global i32 0
+@b = global i32 0
+
+; NOPARAM-LABEL: define i32 @get_a(i32 %x)
+; NOPARAM: load i32, i32* @a
+define i32 @get_a(i32 %x) {
+  %v = load i32, i32* @a
+  %s = shl i32 %v, 3
+  %m = mul i32 %s, %x
+  %o = or i32 %m, 1
+  %r = xor i32 %o, %v
+  %t = add i32 %r, 17
+  %u = sub i32 %t, %x
+  store i32 %u, i32* @a
+  %w = and i32 %u, 255
+  ret i32 %w
+}
+
+define i32 @get_b(i32 %x) {
+  %v = load i32, i32* @b
+  %s = shl i32 %v, 5
+  %m = mul i32 %s, %x
+  %o = or i32 %m, 1
+  %r = xor i32 %o, %v
+  %t = add i32 %r, 17
+  %u = sub i32 %t, %x
+  store i32 %u, i32* @b
+  %w = and i32 %u, 255
+  ret i32 %w
+}
+
+; Internal functions are not kept as thunks; their callers call the merged
+; body directly.
+
+; CHECK-LABEL: define i32 @user(i32 %x)
+; CHECK-NEXT: %1 = call i32 @inc1.merged(i32 %x, i32 1)
+; CHECK-NEXT: %2 = call i32 @inc1.merged(i32 %1, i32 2)
+; CHECK-NEXT: ret i32 %2
+define i32 @user(i32 %x) {
+  %1 = call i32 @inc1(i32 %x)
+  %2 = call i32 @inc2(i32 %1)
+  ret i32 %2
+}
+
+; CHECK-NOT: define internal i32 @inc1
+; CHECK-NOT: define internal i32 @inc2
+define internal i32 @inc1(i32 %x) {
+  %a = add i32 %x, 1
+  %b = mul i32 %a, %x
+  %c = xor i32 %b, 7
+  %d = add i32 %c, 1
+  %e = mul i32 %d, %a
+  %f = xor i32 %e, %b
+  %g = sub i32 %f, %c
+  %h = and i32 %g, %d
+  %i = or i32 %h, 1
+  ret i32 %i
+}
+
+define internal i32 @inc2(i32 %x) {
+  %a = add i32 %x, 2
+  %b = mul i32 %a, %x
+  %c = xor i32 %b, 7
+  %d = add i32 %c, 2
+  %e = mul i32 %d, %a
+  %f = xor i32 %e, %b
+  %g = sub i32 %f, %c
+  %h = and i32 %g, %d
+  %i = or i32 %h, 1
+  ret i32 %i
+}
+
+; Functions that differ in more than the operands are left alone.
+
+; CHECK-LABEL: define i32 @other1(i32 %x)
+; CHECK-NEXT: add i32 %x, 1
+define i32 @other1(i32 %x) {
+  %a = add i32 %x, 1
+  %b = mul i32 %a, %x
+  %c = xor i32 %b, 7
+  %d = add i32 %c, 1
+  %e = mul i32 %d, %a
+  %f = xor i32 %e, %b
+  %g = sub i32 %f, %c
+  %h = or i32 %g, %d
+  %i = and i32 %h, 3
+  ret i32 %i
+}
+
+; CHECK-LABEL: define i32 @other2(i32 %x)
+; CHECK-NEXT: add i32 %x, 1
+define i32 @other2(i32 %x) {
+  %a = add i32 %x, 1
+  %b = mul i32 %a, %x
+  %c = xor i32 %b, 7
+  %d = add i32 %c, 1
+  %e = mul i32 %d, %a
+  %f = xor i32 %e, %a
+  %g = sub i32 %f, %c
+  %h = or i32 %g, %d
+  %i = and i32 %h, 3
+  ret i32 %i
+}
+
+; The merged bodies are added in the module order of the first function of
+; each group, whatever the hashes of the groups are.
+; CHECK-LABEL: define internal i32 @get_a.merged(i32 %x, i32* %merged.arg, i32 %merged.arg1)
+; CHECK: load i32, i32* %merged.arg
+; CHECK: shl i32 %v, %merged.arg1
+; CHECK: store i32 %u, i32* %merged.arg
+
+; The thunks replacing the originals are created after the merged body.
+; CHECK-LABEL: define i32 @get_a(i32)
+; CHECK-NEXT: tail call i32 @get_a.merged(i32 %0, i32* @a, i32 3)
+; CHECK-NEXT: ret i32
+; CHECK-LABEL: define i32 @get_b(i32)
+; CHECK-NEXT: tail call i32 @get_a.merged(i32 %0, i32* @b, i32 5)
+; CHECK-NEXT: ret i32
+
+; CHECK-LABEL: define internal i32 @inc1.merged
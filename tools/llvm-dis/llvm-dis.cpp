@@ -187,6 +187,10 @@ int main(int argc, char **argv) {
     return 1;
   }
 
+  // Textual IR for a large module runs into gigabytes; write it out while
+  // the next buffer is being printed. Pipes keep writing synchronously.
+  Out->os().enableAsyncWrites();
+
   std::unique_ptr<AssemblyAnnotationWriter> Annotator;
   if (ShowAnnotations)
     Annotator.reset(new CommentWriter());
@@ -0,0 +1,328 @@
+//===- ParallelDriver.cpp - Run function passes on several threads --------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+/// The module is split by function. Every part is read lazily from a bitcode
+/// copy of the whole module into its own LLVMContext; only the bodies of its
+/// own functions are materialized, and the functions of the other parts are
+/// turned into declarations. Global
+/// variables keep their initializers so that the passes can still fold loads
+/// from constants.
+///
+/// Once a part has been optimized, everything that is not one of its
+/// function bodies, or new from the passes, is turned into a declaration or
+/// dropped, and the part is linked back into the original module. Local
+/// symbols are made external and hidden for the duration so that they can be
+/// referenced across parts, and unnamed ones are given a name; both are
+/// undone after linking, as is the order of the functions.
+///
+//===----------------------------------------------------------------------===//
+
+#include "ParallelDriver.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Linker/Linker.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+#include <algorithm>
+#include <memory>
+#if LLVM_ENABLE_THREADS != 0
+#include <thread>
+#endif
+
+using namespace llvm;
+
+namespace {
+/// The properties of a global value that splitting the module changes, to be
+/// restored once the parts have been linked back.
+struct SavedGlobal {
+  std::string Name;
+  GlobalValue::LinkageTypes Linkage;
+  GlobalValue::VisibilityTypes Visibility;
+  Comdat *C;
+  bool WasUnnamed;
+};
+
+/// The properties of a global variable that the passes of a part may change,
+/// although the definition stays in the original module. InstCombine, for
+/// example, raises the alignment of a global to match its accesses.
+struct PartGlobal {
+  unsigned Alignment;
+  std::string Section;
+  bool UnnamedAddr;
+};
+typedef StringMap<PartGlobal> PartGlobalMap;
+} // end anonymous namespace
+
+/// Return true if the functions of \p M can be divided between parts.
+static bool canSplit(const Module &M) {
+  // An alias has to stay next to its aliasee, and debug info belongs to its
+  // compile unit; neither can be divided.
+  if (!M.alias_empty() || M.getNamedMetadata("llvm.dbg.cu"))
+    return false;
+
+  unsigned NumDefined = 0;
+  for (const Function &F : M) {
+    if (F.isDeclaration())
+      continue;
+    ++NumDefined;
+    // A block address refers to the body of its function.
+    for (const BasicBlock &BB : F)
+      if (BB.hasAddressTaken())
+        return false;
+  }
+  return NumDefined > 1;
+}
+
+/// Assign each defined function of \p M to one of \p NumParts parts. The
+/// largest functions are placed first, each in the part with the fewest
+/// instructions so far.
+static StringMap<unsigned> assignParts(const Module &M, unsigned NumParts) {
+  std::vector<std::pair<size_t, const Function *>> Sizes;
+  for (const Function &F : M) {
+    if (F.isDeclaration())
+      continue;
+    size_t Size = 0;
+    for (const BasicBlock &BB : F)
+      Size += BB.size();
+    Sizes.push_back(std::make_pair(Size, &F));
+  }
+  std::stable_sort(Sizes.begin(), Sizes.end(),
+                   [](const std::pair<size_t, const Function *> &A,
+                      const std::pair<size_t, const Function *> &B) {
+                     return A.first > B.first;
+                   });
+
+  StringMap<unsigned> PartOf;
+  std::vector<size_t> Load(NumParts, 0);
+  for (const auto &S : Sizes) {
+    unsigned Part = std::min_element(Load.begin(), Load.end()) - Load.begin();
+    Load[Part] += S.first;
+    PartOf[S.second->getName()] = Part;
+  }
+  return PartOf;
+}
+
+/// Optimize the functions of part \p Part of the module in \p Bitcode, and
+/// write the part that has to be linked back to \p Result. The properties of
+/// the original global variables after the passes are recorded in \p Attrs,
+/// since linking does not carry them over to the definitions.
+static void optimizePart(StringRef Bitcode, unsigned Part,
+                         const StringMap<unsigned> &PartOf,
+                         ArrayRef<const PassInfo *> Passes,
+                         const TargetLibraryInfoImpl &TLII, TargetMachine *TM,
+                         SmallVectorImpl<char> &Result, PartGlobalMap &Attrs) {
+  LLVMContext Context;
+  ErrorOr<std::unique_ptr<Module>> MOrErr = getLazyBitcodeModule(
+      MemoryBuffer::getMemBuffer(Bitcode, "<part>", false), Context);
+  if (std::error_code EC = MOrErr.getError())
+    report_fatal_error("cannot read module part: " + EC.message());
+  Module &M = **MOrErr;
+
+  // Only read the bodies this part owns; the others are dropped while still
+  // on disk, so the cost of a part does not grow with the whole module.
+  for (Function &F : M) {
+    if (!F.isDeclaration() && PartOf.lookup(F.getName()) != Part) {
+      F.deleteBody();
+      F.setComdat(nullptr);
+    }
+  }
+  if (std::error_code EC = M.materializeAllPermanently())
+    report_fatal_error("cannot read module part: " + EC.message());
+
+  std::vector<GlobalVariable *> Globals;
+  for (GlobalVariable &GV : M.globals())
+    Globals.push_back(&GV);
+
+  legacy::FunctionPassManager FPM(&M);
+  FPM.add(new TargetLibraryInfoWrapperPass(TLII));
+  FPM.add(createTargetTransformInfoWrapperPass(TM ? TM->getTargetIRAnalysis()
+                                                  : TargetIRAnalysis()));
+  for (const PassInfo *PassInf : Passes)
+    FPM.add(PassInf->getTargetMachineCtor()
+                ? PassInf->getTargetMachineCtor()(TM)
+                : PassInf->getNormalCtor()());
+
+  FPM.doInitialization();
+  for (Function &F : M)
+    FPM.run(F);
+  FPM.doFinalization();
+
+  for (GlobalVariable *GV : Globals) {
+    PartGlobal &A = Attrs[GV->getName()];
+    A.Alignment = GV->getAlignment();
+    A.Section = GV->getSection();
+    A.UnnamedAddr = GV->hasUnnamedAddr();
+  }
+
+  // The original module still defines every global variable, and owns the
+  // appending arrays and named metadata; keep only declarations of them here
+  // so that linking does not define or append them twice.
+  for (GlobalVariable *GV : Globals) {
+    if (GV->hasAppendingLinkage() && GV->use_empty()) {
+      GV->eraseFromParent();
+      continue;
+    }
+    GV->setInitializer(nullptr);
+    GV->setLinkage(GlobalValue::ExternalLinkage);
+    GV->setComdat(nullptr);
+  }
+  for (Function &F : M)
+    F.setComdat(nullptr);
+  while (!M.named_metadata_empty())
+    M.eraseNamedMetadata(&*M.named_metadata_begin());
+
+  raw_svector_ostream OS(Result);
+  WriteBitcodeToFile(&M, OS);
+  OS.flush();
+}
+
+bool llvm::runFunctionPassesInParallel(
+    Module &M, ArrayRef<const PassInfo *> Passes, unsigned NumThreads,
+    const TargetLibraryInfoImpl &TLII,
+    std::function<TargetMachine *()> CreateTM) {
+  if (NumThreads < 2 || !canSplit(M))
+    return false;
+
+  // Let every part refer to every symbol by name.
+  std::vector<SavedGlobal> Saved;
+  std::vector<std::string> FunctionOrder;
+  auto Externalize = [&](GlobalValue &GV) {
+    SavedGlobal S;
+    S.WasUnnamed = !GV.hasName();
+    if (S.WasUnnamed)
+      GV.setName("__opt_part.anon");
+    S.Name = GV.getName();
+    S.Linkage = GV.getLinkage();
+    S.Visibility = GV.getVisibility();
+    S.C = nullptr;
+    if (GV.hasLocalLinkage()) {
+      GV.setLinkage(GlobalValue::ExternalLinkage);
+      GV.setVisibility(GlobalValue::HiddenVisibility);
+    }
+    Saved.push_back(S);
+  };
+  for (GlobalVariable &GV : M.globals())
+    Externalize(GV);
+  for (Function &F : M) {
+    Externalize(F);
+    Saved.back().C = F.getComdat();
+    FunctionOrder.push_back(Saved.back().Name);
+  }
+
+  unsigned NumDefined = 0;
+  for (const Function &F : M)
+    NumDefined += !F.isDeclaration();
+  unsigned NumParts = std::min(NumThreads, NumDefined);
+  StringMap<unsigned> PartOf = assignParts(M, NumParts);
+
+  SmallVector<char, 0> Bitcode;
+  {
+    raw_svector_ostream OS(Bitcode);
+    WriteBitcodeToFile(&M, OS);
+  }
+  StringRef BitcodeRef(Bitcode.data(), Bitcode.size());
+
+  // Target machines are not thread-safe, so each part gets its own.
+  std::vector<std::unique_ptr<TargetMachine>> TMs;
+  for (unsigned Part = 0; Part != NumParts; ++Part)
+    TMs.emplace_back(CreateTM());
+
+  std::vector<SmallVector<char, 0>> Results(NumParts);
+  std::vector<PartGlobalMap> PartAttrs(NumParts);
+  auto Run = [&](unsigned Part) {
+    optimizePart(BitcodeRef, Part, PartOf, Passes, TLII, TMs[Part].get(),
+                 Results[Part], PartAttrs[Part]);
+  };
+#if LLVM_ENABLE_THREADS != 0
+  std::vector<std::thread> Threads;
+  for (unsigned Part = 1; Part != NumParts; ++Part)
+    Threads.emplace_back(Run, Part);
+  Run(0);
+  for (std::thread &T : Threads)
+    T.join();
+#else
+  for (unsigned Part = 0; Part != NumParts; ++Part)
+    Run(Part);
+#endif
+
+  // Replace the original bodies with the optimized ones.
+  for (Function &F : M) {
+    if (!F.isDeclaration()) {
+      F.deleteBody();
+      F.setComdat(nullptr);
+    }
+  }
+  for (unsigned Part = 0; Part != NumParts; ++Part) {
+    StringRef Data(Results[Part].data(), Results[Part].size());
+    ErrorOr<std::unique_ptr<Module>> PartOrErr =
+        parseBitcodeFile(MemoryBufferRef(Data, "<part>"), M.getContext());
+    if (std::error_code EC = PartOrErr.getError())
+      report_fatal_error("cannot read optimized module part: " +
+                         EC.message());
+    if (Linker::LinkModules(&M, PartOrErr->get()))
+      report_fatal_error("cannot link optimized module part");
+  }
+
+  // The accesses in a part may rely on the changes its passes made to a
+  // global, such as a raised alignment. Keep the largest alignment and any new
+  // section, and keep unnamed_addr only if no part dropped it.
+  for (GlobalVariable &GV : M.globals()) {
+    for (const PartGlobalMap &Attrs : PartAttrs) {
+      auto I = Attrs.find(GV.getName());
+      if (I == Attrs.end())
+        continue;
+      const PartGlobal &A = I->second;
+      if (A.Alignment > GV.getAlignment())
+        GV.setAlignment(A.Alignment);
+      if (A.Section != GV.getSection())
+        GV.setSection(A.Section);
+      if (!A.UnnamedAddr)
+        GV.setUnnamedAddr(false);
+    }
+  }
+
+  // Linking recreates the functions it defines at the end of the module; put
+  // them back in their original order, followed by any the passes declared.
+  std::vector<Function *> Order;
+  SmallPtrSet<Function *, 32> Ordered;
+  for (const std::string &Name : FunctionOrder) {
+    Function *F = M.getFunction(Name);
+    Order.push_back(F);
+    Ordered.insert(F);
+  }
+  for (Function &F : M)
+    if (!Ordered.count(&F))
+      Order.push_back(&F);
+  Module::FunctionListType &Functions = M.getFunctionList();
+  for (Function *F : Order)
+    Functions.splice(Functions.end(), Functions, F);
+
+  for (const SavedGlobal &S : Saved) {
+    GlobalValue *GV = M.getNamedValue(S.Name);
+    GV->setLinkage(S.Linkage);
+    GV->setVisibility(S.Visibility);
+    if (S.C)
+      cast<GlobalObject>(GV)->setComdat(S.C);
+    if (S.WasUnnamed)
+      GV->setName("");
+  }
+  return true;
+}
@@ -0,0 +1,53 @@
+//===- ParallelDriver.h - Run function passes on several threads -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+/// A function which runs a pipeline of function passes over the functions of
+/// a module on several threads.
+///
+/// An LLVMContext, and everything uniqued in it (constants, types, metadata),
+/// may only be used by one thread at a time. Rather than making the context
+/// thread-safe, the module is split into parts that are each loaded into a
+/// context of their own, optimized concurrently, and linked back into the
+/// original module. The split does not depend on timing, so the output is
+/// the same on every run with the same number of threads. It can differ from
+/// a serial run in the names of globals the passes create, which are uniqued
+/// per part before linking (for example \c @str.8 rather than \c @str.1).
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TOOLS_OPT_PARALLELDRIVER_H
+#define LLVM_TOOLS_OPT_PARALLELDRIVER_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include <functional>
+
+namespace llvm {
+class Module;
+class PassInfo;
+class TargetLibraryInfoImpl;
+class TargetMachine;
+
+/// \brief Run \p Passes, which must all be function passes or be scheduled
+/// by a function pass manager, over every function defined in \p M, using up
+/// to \p NumThreads threads.
+///
+/// \p CreateTM is called once per thread to create a target machine for the
+/// passes of that thread, since target machines are not thread-safe.
+///
+/// Returns false without touching \p M if the module cannot be split, for
+/// example because it has aliases, block addresses or debug info. The caller
+/// should then run the passes the usual way.
+bool runFunctionPassesInParallel(
+    Module &M, ArrayRef<const PassInfo *> Passes, unsigned NumThreads,
+    const TargetLibraryInfoImpl &TLII,
+    std::function<TargetMachine *()> CreateTM);
+}
+
+#endif
@@ -14,6 +14,7 @@
 
 #include "BreakpointPrinter.h"
 #include "NewPMDriver.h"
+#include "ParallelDriver.h"
 #include "PassPrinters.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/Analysis/CallGraph.h"
@@ -190,6 +191,11 @@ static cl::opt<bool> PreserveAssemblyUseListOrder(
     cl::desc("Preserve use-list order when writing LLVM assembly."),
     cl::init(false), cl::Hidden);
 
+static cl::opt<unsigned> FunctionThreads(
+    "function-threads", cl::init(1),
+    cl::desc("Run a pipeline made only of function passes on this many "
+             "threads, each optimizing a part of the module"));
+
 static inline void addPass(legacy::PassManagerBase &PM, Pass *P) {
   // Add the pass to the pass manager...
   PM.add(P);
@@ -281,6 +287,37 @@ static TargetMachine* GetTargetMachine(Triple TheTriple, StringRef CPUStr,
                                         GetCodeGenOptLevel());
 }
 
+/// Return true if the passes on the command line can be run by
+/// runFunctionPassesInParallel: there are no -O levels, link-time passes or
+/// printing modes, and every pass can be scheduled by a function pass manager.
+static bool isFunctionPipeline(TargetMachine *TM) {
+  if (PassList.empty() || AnalyzeOnly || PrintBreakpoints || PrintEachXForm ||
+      StandardLinkOpts || OptLevelO1 || OptLevelO2 || OptLevelOs ||
+      OptLevelOz || OptLevelO3 || TimePassesIsEnabled)
+    return false;
+
+  // The pass manager's own printing and debugging output would be interleaved
+  // across the parts, or lost with them.
+  StringMap<cl::Option *> &Opts = cl::getRegisteredOptions();
+  for (const char *Name : {"print-before", "print-after", "print-before-all",
+                           "print-after-all", "debug-pass"}) {
+    auto I = Opts.find(Name);
+    if (I != Opts.end() && I->second->getNumOccurrences())
+      return false;
+  }
+
+  for (const PassInfo *PassInf : PassList) {
+    std::unique_ptr<Pass> P;
+    if (PassInf->getTargetMachineCtor())
+      P.reset(PassInf->getTargetMachineCtor()(TM));
+    else if (PassInf->getNormalCtor())
+      P.reset(PassInf->getNormalCtor()());
+    if (!P || P->getPassKind() > PT_Function)
+      return false;
+  }
+  return true;
+}
+
 #ifdef LINK_POLLY_INTO_TOOLS
 namespace polly {
 void initializePollyPasses(llvm::PassRegistry &Registry);
@@ -452,6 +489,19 @@ int main(int argc, char **argv) {
   Passes.add(createTargetTransformInfoWrapperPass(TM ? TM->getTargetIRAnalysis()
                                                      : TargetIRAnalysis()));
 
+  // A pipeline of function passes can optimize parts of the module on
+  // separate threads.
+  bool RanInParallel = false;
+  if (FunctionThreads > 1 && isFunctionPipeline(TM.get())) {
+    std::vector<const PassInfo *> Infos(PassList.begin(), PassList.end());
+    RanInParallel = runFunctionPassesInParallel(
+        *M, Infos, FunctionThreads, TLII, [&]() -> TargetMachine * {
+          if (!ModuleTriple.getArch())
+            return nullptr;
+          return GetTargetMachine(ModuleTriple, CPUStr, FeaturesStr, Options);
+        });
+  }
+
   std::unique_ptr<legacy::FunctionPassManager> FPasses;
   if (OptLevelO1 || OptLevelO2 || OptLevelOs || OptLevelOz || OptLevelO3) {
     FPasses.reset(new legacy::FunctionPassManager(M.get()));
@@ -478,7 +528,7 @@ int main(int argc, char **argv) {
   }
 
   // Create a new optimization pass for each one specified on the command line
-  for (unsigned i = 0; i < PassList.size(); ++i) {
+  for (unsigned i = 0; !RanInParallel && i < PassList.size(); ++i) {
     if (StandardLinkOpts &&
         StandardLinkOpts.getPosition() < PassList.getPosition(i)) {
       AddStandardLinkPasses(Passes);
@@ -7,7 +7,9 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/Bitcode/BitstreamReader.h"
+#include "llvm/Bitcode/BitstreamWriter.h"
 #include "gtest/gtest.h"
 
 using namespace llvm;
@@ -53,4 +55,73 @@ TEST(BitstreamReaderTest, AtEndOfStreamEmpty) {
   EXPECT_TRUE(Cursor.AtEndOfStream());
 }
 
+TEST(BitstreamReaderTest, ReadArrayRecords) {
+  // Element counts chosen so that the arrays straddle several words.
+  SmallVector<uint64_t, 64> Fixed, VBR, Char6;
+  for (unsigned I = 0; I != 50; ++I) {
+    Fixed.push_back(I % 8);
+    // Mostly single-chunk values with a few multi-chunk ones mixed in.
+    VBR.push_back(I % 7 == 0 ? (uint64_t(1) << (I % 40)) + I : I % 32);
+    Char6.push_back("abcXYZ019._"[I % 11]);
+  }
+
+  SmallVector<char, 1024> Buffer;
+  {
+    BitstreamWriter Stream(Buffer);
+    Stream.EnterSubblock(8, 3);
+
+    auto MakeArrayAbbrev = [&](unsigned Code, BitCodeAbbrevOp Elt) {
+      BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+      Abbv->Add(BitCodeAbbrevOp(Code));
+      Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Array));
+      Abbv->Add(Elt);
+      return Stream.EmitAbbrev(Abbv);
+    };
+    unsigned FixedAbbrev =
+        MakeArrayAbbrev(1, BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 3));
+    unsigned VBRAbbrev =
+        MakeArrayAbbrev(2, BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6));
+    unsigned Char6Abbrev =
+        MakeArrayAbbrev(3, BitCodeAbbrevOp(BitCodeAbbrevOp::Char6));
+
+    Stream.EmitRecord(1, Fixed, FixedAbbrev);
+    Stream.EmitRecord(2, VBR, VBRAbbrev);
+    Stream.EmitRecord(3, Char6, Char6Abbrev);
+    // Unabbreviated records are a run of VBR6 values.
+    Stream.EmitRecord(4, VBR);
+    // A record that is skipped rather than read.
+    Stream.EmitRecord(1, Fixed, FixedAbbrev);
+    Stream.EmitRecord(5, Fixed);
+    Stream.ExitBlock();
+  }
+
+  BitstreamReader Reader((const unsigned char *)Buffer.begin(),
+                         (const unsigned char *)Buffer.end());
+  BitstreamCursor Cursor(Reader);
+
+  BitstreamEntry Entry = Cursor.advance();
+  ASSERT_EQ(BitstreamEntry::SubBlock, Entry.Kind);
+  ASSERT_EQ(8u, Entry.ID);
+  ASSERT_FALSE(Cursor.EnterSubBlock(8));
+
+  auto ReadRecord = [&](unsigned ExpectedCode, ArrayRef<uint64_t> Expected) {
+    BitstreamEntry Entry = Cursor.advance();
+    ASSERT_EQ(BitstreamEntry::Record, Entry.Kind);
+    SmallVector<uint64_t, 64> Vals;
+    EXPECT_EQ(ExpectedCode, Cursor.readRecord(Entry.ID, Vals));
+    EXPECT_TRUE(Expected.equals(Vals));
+  };
+  ReadRecord(1, Fixed);
+  ReadRecord(2, VBR);
+  ReadRecord(3, Char6);
+  ReadRecord(4, VBR);
+
+  Entry = Cursor.advance();
+  ASSERT_EQ(BitstreamEntry::Record, Entry.Kind);
+  Cursor.skipRecord(Entry.ID);
+  ReadRecord(5, Fixed);
+
+  EXPECT_EQ(BitstreamEntry::EndBlock, Cursor.advance().Kind);
+}
+
 } // end anonymous namespace
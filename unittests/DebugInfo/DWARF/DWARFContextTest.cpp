@@ -0,0 +1,137 @@
+//===- llvm/unittest/DebugInfo/DWARFContextTest.cpp -----------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/DebugInfo/DWARF/DWARFContext.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Object/ObjectFile.h"
+#include "llvm/Support/Compression.h"
+#include "llvm/Support/ELF.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/MathExtras.h"
+#include "gtest/gtest.h"
+#include <cstring>
+using namespace llvm;
+using namespace object;
+
+namespace {
+
+/// Return \p Data in the format of a .zdebug_* section: "ZLIB", the size of
+/// the uncompressed data as a big-endian 64-bit number, then the zlib stream.
+std::string compressSection(StringRef Data) {
+  std::string Result = "ZLIB";
+  for (int Shift = 56; Shift >= 0; Shift -= 8)
+    Result += char((uint64_t(Data.size()) >> Shift) & 0xff);
+  SmallString<0> Compressed;
+  EXPECT_EQ(zlib::StatusOK, zlib::compress(Data, Compressed));
+  Result += Compressed.str();
+  return Result;
+}
+
+/// Build a relocatable ELF64 object in host byte order holding \p Sections,
+/// given as (name, contents) pairs. The file offset of each section's
+/// contents is appended to \p Offsets.
+std::string makeObject(ArrayRef<std::pair<StringRef, std::string>> Sections,
+                       SmallVectorImpl<uint64_t> &Offsets) {
+  std::string Obj(sizeof(ELF::Elf64_Ehdr), '\0');
+  std::string StrTab(1, '\0');
+  auto AddName = [&](StringRef Name) {
+    uint32_t Offset = StrTab.size();
+    StrTab += Name;
+    StrTab += '\0';
+    return Offset;
+  };
+  std::vector<ELF::Elf64_Shdr> Headers(1);
+  auto AddSection = [&](uint32_t Name, StringRef Contents, unsigned Type) {
+    ELF::Elf64_Shdr Shdr;
+    memset(&Shdr, 0, sizeof(Shdr));
+    Shdr.sh_name = Name;
+    Shdr.sh_type = Type;
+    Shdr.sh_offset = Obj.size();
+    Shdr.sh_size = Contents.size();
+    Shdr.sh_addralign = 1;
+    Headers.push_back(Shdr);
+    Obj += Contents;
+  };
+  for (const auto &S : Sections) {
+    Offsets.push_back(Obj.size());
+    AddSection(AddName(S.first), S.second, ELF::SHT_PROGBITS);
+  }
+  uint32_t StrTabName = AddName(".shstrtab");
+  AddSection(StrTabName, StrTab, ELF::SHT_STRTAB);
+
+  Obj.resize(RoundUpToAlignment(Obj.size(), 8), '\0');
+  ELF::Elf64_Ehdr Ehdr;
+  memset(&Ehdr, 0, sizeof(Ehdr));
+  memcpy(Ehdr.e_ident, ELF::ElfMagic, strlen(ELF::ElfMagic));
+  Ehdr.e_ident[ELF::EI_CLASS] = ELF::ELFCLASS64;
+  Ehdr.e_ident[ELF::EI_DATA] =
+      sys::IsLittleEndianHost ? ELF::ELFDATA2LSB : ELF::ELFDATA2MSB;
+  Ehdr.e_ident[ELF::EI_VERSION] = ELF::EV_CURRENT;
+  Ehdr.e_type = ELF::ET_REL;
+  Ehdr.e_machine = ELF::EM_X86_64;
+  Ehdr.e_version = ELF::EV_CURRENT;
+  Ehdr.e_shoff = Obj.size();
+  Ehdr.e_ehsize = sizeof(ELF::Elf64_Ehdr);
+  Ehdr.e_shentsize = sizeof(ELF::Elf64_Shdr);
+  Ehdr.e_shnum = Headers.size();
+  Ehdr.e_shstrndx = Headers.size() - 1;
+  memcpy(&Obj[0], &Ehdr, sizeof(Ehdr));
+  Obj.append(reinterpret_cast<const char *>(Headers.data()),
+             Headers.size() * sizeof(ELF::Elf64_Shdr));
+  return Obj;
+}
+
+TEST(DWARFContext, CompressedSectionsAreUncompressedOnAccess) {
+  if (!zlib::isAvailable())
+    return;
+
+  std::string Str;
+  for (unsigned I = 0; Str.size() < 256 * 1024; ++I)
+    Str += "string" + std::to_string(I) + '\0';
+  std::string Line = "line table contents";
+  std::string ZLine = compressSection(Line);
+
+  SmallVector<uint64_t, 2> Offsets;
+  std::string Obj = makeObject(
+      {std::make_pair(StringRef(".zdebug_str"), compressSection(Str)),
+       std::make_pair(StringRef(".zdebug_line"), ZLine)},
+      Offsets);
+  MemoryBufferRef Buffer(Obj, "test.o");
+
+  {
+    ErrorOr<std::unique_ptr<ObjectFile>> ObjOrErr =
+        ObjectFile::createObjectFile(Buffer);
+    ASSERT_TRUE(bool(ObjOrErr));
+    DWARFContextInMemory Ctx(**ObjOrErr);
+    EXPECT_EQ(Str, Ctx.getStringSection());
+    EXPECT_EQ(Line, Ctx.getLineSection().Data);
+  }
+
+  ErrorOr<std::unique_ptr<ObjectFile>> ObjOrErr =
+      ObjectFile::createObjectFile(Buffer);
+  ASSERT_TRUE(bool(ObjOrErr));
+  DWARFContextInMemory Ctx(**ObjOrErr);
+
+  // Reading the start of .debug_str inflates that section only.
+  EXPECT_TRUE(
+      Ctx.getStringSection().startswith(StringRef("string0\0string1", 15)));
+
+  // The compressed .debug_line has not been read yet, so destroying its zlib
+  // stream now leaves it empty when it is accessed.
+  const size_t HeaderSize = 12;
+  std::fill(Obj.begin() + Offsets[1] + HeaderSize,
+            Obj.begin() + Offsets[1] + ZLine.size(), '\xff');
+  EXPECT_TRUE(Ctx.getLineSection().Data.empty());
+
+  // An uncompressed section is cached, not inflated again.
+  EXPECT_EQ(Ctx.getStringSection().data(), Ctx.getStringSection().data());
+  EXPECT_EQ(Str.size(), Ctx.getStringSection().size());
+}
+
+} // end anonymous namespace
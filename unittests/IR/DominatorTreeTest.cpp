@@ -250,6 +250,172 @@ namespace llvm {
       Passes.add(P);
       Passes.run(*M);
     }
+
+    // A function whose CFG is built from an adjacency list, so that edges can
+    // be inserted and deleted freely. Every block ends in a switch on the
+    // function argument.
+    class CFGBuilder {
+      LLVMContext Context;
+      std::unique_ptr<Module> M;
+      Function *F;
+      std::vector<BasicBlock *> Blocks;
+      std::vector<std::vector<unsigned>> Succs;
+
+      void rebuildTerminator(unsigned From) {
+        BasicBlock *BB = Blocks[From];
+        if (TerminatorInst *TI = BB->getTerminator())
+          TI->eraseFromParent();
+        if (Succs[From].empty()) {
+          ReturnInst::Create(Context, BB);
+          return;
+        }
+        Value *Cond = F->arg_begin();
+        SwitchInst *SI = SwitchInst::Create(Cond, Blocks[Succs[From][0]],
+                                            Succs[From].size(), BB);
+        for (unsigned i = 1, e = Succs[From].size(); i != e; ++i)
+          SI->addCase(ConstantInt::get(Type::getInt32Ty(Context), i),
+                      Blocks[Succs[From][i]]);
+      }
+
+    public:
+      explicit CFGBuilder(unsigned NumBlocks)
+          : M(new Module("CFGBuilder", Context)), Succs(NumBlocks) {
+        FunctionType *FTy = FunctionType::get(
+            Type::getVoidTy(Context), Type::getInt32Ty(Context), false);
+        F = Function::Create(FTy, Function::ExternalLinkage, "f", M.get());
+        for (unsigned i = 0; i != NumBlocks; ++i)
+          Blocks.push_back(BasicBlock::Create(Context, "", F));
+        for (unsigned i = 0; i != NumBlocks; ++i)
+          rebuildTerminator(i);
+      }
+
+      Function &getFunction() { return *F; }
+      BasicBlock *getBlock(unsigned i) { return Blocks[i]; }
+      bool hasEdge(unsigned From, unsigned To) const {
+        return std::find(Succs[From].begin(), Succs[From].end(), To) !=
+               Succs[From].end();
+      }
+
+      DominatorTree::UpdateType insertEdge(unsigned From, unsigned To) {
+        Succs[From].push_back(To);
+        rebuildTerminator(From);
+        return DominatorTree::UpdateType(DominatorTree::Insert, Blocks[From],
+                                         Blocks[To]);
+      }
+
+      DominatorTree::UpdateType deleteEdge(unsigned From, unsigned To) {
+        auto I = std::find(Succs[From].begin(), Succs[From].end(), To);
+        assert(I != Succs[From].end() && "Deleting a missing edge");
+        Succs[From].erase(I);
+        rebuildTerminator(From);
+        return DominatorTree::UpdateType(DominatorTree::Delete, Blocks[From],
+                                         Blocks[To]);
+      }
+    };
+
+    TEST(DominatorTree, InsertDeleteEdges) {
+      // 0 -> 1 -> 2 -> 3, 0 -> 4 -> 3, 5 -> 6 unreachable.
+      CFGBuilder B(7);
+      B.insertEdge(0, 1);
+      B.insertEdge(1, 2);
+      B.insertEdge(2, 3);
+      B.insertEdge(0, 4);
+      B.insertEdge(4, 3);
+      B.insertEdge(5, 6);
+
+      DominatorTree DT;
+      DT.recalculate(B.getFunction());
+      EXPECT_TRUE(DT.dominates(B.getBlock(1), B.getBlock(2)));
+      EXPECT_EQ(2u, DT.getNode(B.getBlock(2))->getLevel());
+
+      // Reachable insertion: 4 -> 2 makes 0 the idom of 2.
+      B.insertEdge(4, 2);
+      DT.insertEdge(B.getBlock(4), B.getBlock(2));
+      EXPECT_TRUE(DT.verify());
+      EXPECT_EQ(B.getBlock(0),
+                DT.getNode(B.getBlock(2))->getIDom()->getBlock());
+      EXPECT_EQ(1u, DT.getNode(B.getBlock(2))->getLevel());
+
+      // Insertion making 5 and 6 reachable.
+      B.insertEdge(3, 5);
+      DT.insertEdge(B.getBlock(3), B.getBlock(5));
+      EXPECT_TRUE(DT.verify());
+      EXPECT_TRUE(DT.isReachableFromEntry(B.getBlock(6)));
+      EXPECT_TRUE(DT.dominates(B.getBlock(5), B.getBlock(6)));
+
+      // Reachable deletion.
+      B.deleteEdge(4, 2);
+      DT.deleteEdge(B.getBlock(4), B.getBlock(2));
+      EXPECT_TRUE(DT.verify());
+      EXPECT_TRUE(DT.dominates(B.getBlock(1), B.getBlock(2)));
+
+      // Deletion making 5 and 6 unreachable again.
+      B.deleteEdge(3, 5);
+      DT.deleteEdge(B.getBlock(3), B.getBlock(5));
+      EXPECT_TRUE(DT.verify());
+      EXPECT_FALSE(DT.isReachableFromEntry(B.getBlock(5)));
+      EXPECT_FALSE(DT.isReachableFromEntry(B.getBlock(6)));
+    }
+
+    TEST(DominatorTree, ApplyUpdatesBatch) {
+      CFGBuilder B(6);
+      B.insertEdge(0, 1);
+      B.insertEdge(1, 2);
+      B.insertEdge(2, 3);
+      B.insertEdge(3, 1);
+      B.insertEdge(3, 4);
+
+      DominatorTree DT;
+      DT.recalculate(B.getFunction());
+      DominatorTreeBase<BasicBlock> PDT(/*isPostDom=*/true);
+      PDT.recalculate(B.getFunction());
+
+      // The CFG is changed first, then the trees are told about every change
+      // at once. The insertion and deletion of 0 -> 3 cancel out.
+      std::vector<DominatorTree::UpdateType> Updates;
+      Updates.push_back(B.insertEdge(0, 3));
+      Updates.push_back(B.insertEdge(0, 5));
+      Updates.push_back(B.insertEdge(5, 4));
+      Updates.push_back(B.deleteEdge(3, 4));
+      Updates.push_back(B.insertEdge(2, 4));
+      Updates.push_back(B.deleteEdge(0, 3));
+      DT.applyUpdates(Updates);
+      PDT.applyUpdates(Updates);
+
+      EXPECT_TRUE(DT.verify());
+      EXPECT_TRUE(PDT.verify());
+      EXPECT_EQ(B.getBlock(0),
+                DT.getNode(B.getBlock(4))->getIDom()->getBlock());
+    }
+
+    TEST(DominatorTree, RandomUpdates) {
+      const unsigned NumBlocks = 24;
+      CFGBuilder B(NumBlocks);
+      DominatorTree DT;
+      DT.recalculate(B.getFunction());
+
+      // Simple deterministic LCG, so that failures are reproducible.
+      uint64_t Seed = 42;
+      auto Next = [&Seed](unsigned Bound) {
+        Seed = Seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        return unsigned(Seed >> 33) % Bound;
+      };
+
+      for (unsigned Round = 0; Round != 200; ++Round) {
+        std::vector<DominatorTree::UpdateType> Updates;
+        unsigned NumUpdates = 1 + Next(4);
+        for (unsigned i = 0; i != NumUpdates; ++i) {
+          unsigned From = Next(NumBlocks);
+          unsigned To = 1 + Next(NumBlocks - 1);
+          if (B.hasEdge(From, To))
+            Updates.push_back(B.deleteEdge(From, To));
+          else
+            Updates.push_back(B.insertEdge(From, To));
+        }
+        DT.applyUpdates(Updates);
+        ASSERT_TRUE(DT.verify()) << "Incorrect tree after round " << Round;
+      }
+    }
   }
 }
 
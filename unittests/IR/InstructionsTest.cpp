@@ -518,6 +518,51 @@ TEST(InstructionsTest, CloneCall) {
   }
 }
 
+TEST(InstructionsTest, ComesBefore) {
+  LLVMContext C;
+  Module M("M", C);
+  FunctionType *FT =
+      FunctionType::get(Type::getVoidTy(C), Type::getInt32Ty(C), false);
+  Function *F = Function::Create(FT, Function::ExternalLinkage, "f", &M);
+  BasicBlock *BB = BasicBlock::Create(C, "", F);
+  IRBuilder<> Builder(BB);
+
+  // Build a long chain so that the order is not trivially recovered.
+  Value *V = F->arg_begin();
+  SmallVector<Instruction *, 16> Insts;
+  for (unsigned i = 0; i != 1000; ++i) {
+    V = Builder.CreateAdd(V, Builder.getInt32(i));
+    Insts.push_back(cast<Instruction>(V));
+  }
+  ReturnInst *Ret = Builder.CreateRetVoid();
+
+  EXPECT_FALSE(BB->isInstrOrderValid());
+  EXPECT_TRUE(Insts.front()->comesBefore(Insts.back()));
+  EXPECT_TRUE(BB->isInstrOrderValid());
+  EXPECT_FALSE(Insts.back()->comesBefore(Insts.front()));
+  EXPECT_FALSE(Ret->comesBefore(Ret));
+  EXPECT_TRUE(Insts[500]->comesBefore(Ret));
+
+  // Removing instructions keeps the ordering valid.
+  Insts[1]->replaceAllUsesWith(Insts[0]);
+  Insts[1]->eraseFromParent();
+  EXPECT_TRUE(BB->isInstrOrderValid());
+  EXPECT_TRUE(Insts[0]->comesBefore(Insts[2]));
+
+  // Inserting or moving instructions invalidates it.
+  Insts[999]->moveBefore(Insts[0]);
+  EXPECT_FALSE(BB->isInstrOrderValid());
+  EXPECT_TRUE(Insts[999]->comesBefore(Insts[0]));
+  EXPECT_FALSE(Insts[0]->comesBefore(Insts[999]));
+  EXPECT_TRUE(BB->isInstrOrderValid());
+
+  Instruction *New = BinaryOperator::CreateAdd(Insts[0], Insts[0]);
+  New->insertAfter(Ret->getPrevNode());
+  EXPECT_FALSE(BB->isInstrOrderValid());
+  EXPECT_TRUE(New->comesBefore(Ret));
+  EXPECT_TRUE(Insts[998]->comesBefore(New));
+}
+
 }  // end anonymous namespace
 }  // end namespace llvm
 
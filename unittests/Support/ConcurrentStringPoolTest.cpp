@@ -0,0 +1,105 @@
+//===- llvm/unittest/Support/ConcurrentStringPoolTest.cpp -----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/ConcurrentStringPool.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/Config/llvm-config.h"
+#include "gtest/gtest.h"
+#include <string>
+#include <vector>
+
+#if LLVM_ENABLE_THREADS != 0
+#include <thread>
+#endif
+
+using namespace llvm;
+
+namespace {
+
+TEST(ConcurrentStringPoolTest, Intern) {
+  ConcurrentStringPool Pool;
+  EXPECT_EQ(0u, Pool.size());
+
+  std::string Foo = "foo";
+  StringRef A = Pool.intern(Foo);
+  StringRef B = Pool.intern("foo");
+  StringRef C = Pool.intern("bar");
+
+  EXPECT_EQ("foo", A);
+  EXPECT_EQ(A.data(), B.data());
+  EXPECT_NE(A.data(), C.data());
+  EXPECT_NE(Foo.data(), A.data());
+  EXPECT_EQ('\0', A.data()[A.size()]);
+  EXPECT_TRUE(Pool.count("bar"));
+  EXPECT_FALSE(Pool.count("baz"));
+  EXPECT_EQ(2u, Pool.size());
+}
+
+TEST(ConcurrentStringPoolTest, EmbeddedNulAndEmpty) {
+  ConcurrentStringPool Pool;
+  StringRef Empty = Pool.intern("");
+  StringRef Nul = Pool.intern(StringRef("a\0b", 3));
+  EXPECT_TRUE(Empty.empty());
+  EXPECT_EQ(3u, Nul.size());
+  EXPECT_EQ(Nul.data(), Pool.intern(StringRef("a\0b", 3)).data());
+  EXPECT_NE(Nul.data(), Pool.intern("a").data());
+  EXPECT_EQ(3u, Pool.size());
+}
+
+TEST(ConcurrentStringPoolTest, StableAddresses) {
+  // Growing the tables must not move strings that were already interned.
+  ConcurrentStringPool Pool;
+  StringRef First = Pool.intern("first");
+  for (unsigned I = 0; I != 10000; ++I)
+    Pool.intern(Twine("str").concat(Twine(I)).str());
+  EXPECT_EQ(First.data(), Pool.intern("first").data());
+  EXPECT_EQ("first", First);
+  EXPECT_EQ(10001u, Pool.size());
+  EXPECT_LT(0u, Pool.getMemorySize());
+}
+
+#if LLVM_ENABLE_THREADS != 0
+// Stress the pool with many threads interning overlapping sets of names, as
+// parallel code generation would with symbol names. Every thread must see the
+// same address for the same name. Run with -gtest_repeat and under tsan to
+// look at contention and races.
+TEST(ConcurrentStringPoolTest, ContendedIntern) {
+  const unsigned NumThreads = 8;
+  const unsigned NumNames = 2000;
+  // Each thread walks the names in a different order, by stepping with a
+  // multiplier coprime to NumNames, so that threads race to insert them.
+  const unsigned Steps[NumThreads] = {1, 3, 7, 9, 11, 13, 17, 19};
+
+  ConcurrentStringPool Pool;
+  std::vector<std::vector<const char *>> Seen(NumThreads);
+  std::vector<std::thread> Threads;
+  for (unsigned T = 0; T != NumThreads; ++T) {
+    Threads.emplace_back([&, T] {
+      std::vector<const char *> &Out = Seen[T];
+      Out.resize(NumNames);
+      for (unsigned I = 0; I != NumNames; ++I) {
+        unsigned N = (I * Steps[T] + T * 97) % NumNames;
+        SmallString<32> Name;
+        (Twine("symbol_") + Twine(N)).toVector(Name);
+        Out[N] = Pool.intern(Name).data();
+      }
+    });
+  }
+  for (std::thread &Th : Threads)
+    Th.join();
+
+  EXPECT_EQ(NumNames, Pool.size());
+  for (unsigned T = 1; T != NumThreads; ++T)
+    for (unsigned N = 0; N != NumNames; ++N)
+      ASSERT_EQ(Seen[0][N], Seen[T][N]);
+}
+#endif
+
+} // anonymous namespace
@@ -173,3 +173,29 @@ TEST_F(SourceMgrTest, FixitForTab) {
             Output);
 }
 
+
+TEST_F(SourceMgrTest, LineAndColumnOutOfOrder) {
+  setMainBuffer("aaa\nbb\n\ncccc\nd", "file.in");
+
+  EXPECT_EQ(std::make_pair(5u, 2u), SM.getLineAndColumn(getLoc(14)));
+  EXPECT_EQ(std::make_pair(1u, 1u), SM.getLineAndColumn(getLoc(0)));
+  EXPECT_EQ(std::make_pair(4u, 3u), SM.getLineAndColumn(getLoc(10)));
+  EXPECT_EQ(std::make_pair(1u, 4u), SM.getLineAndColumn(getLoc(3)));
+  EXPECT_EQ(std::make_pair(2u, 1u), SM.getLineAndColumn(getLoc(4)));
+  EXPECT_EQ(std::make_pair(3u, 1u), SM.getLineAndColumn(getLoc(7)));
+  EXPECT_EQ(3u, SM.FindLineNumber(getLoc(7)));
+}
+
+TEST_F(SourceMgrTest, LineAndColumnLargeBuffer) {
+  // Exceed 64K so the offset table needs 32-bit entries.
+  std::string Text;
+  for (unsigned i = 0; i != 20000; ++i)
+    Text += "line\n";
+  setMainBuffer(Text, "file.in");
+
+  EXPECT_EQ(std::make_pair(20000u, 3u),
+            SM.getLineAndColumn(getLoc(19999 * 5 + 2)));
+  EXPECT_EQ(std::make_pair(2u, 1u), SM.getLineAndColumn(getLoc(5)));
+  EXPECT_EQ(std::make_pair(20001u, 1u),
+            SM.getLineAndColumn(getLoc(Text.size())));
+}
@@ -30,4 +30,32 @@ TEST(formatted_raw_ostreamTest, Test_Tell) {
   }
 }
 
+TEST(formatted_raw_ostreamTest, Test_Position) {
+  SmallString<128> A;
+  raw_svector_ostream B(A);
+  formatted_raw_ostream C(B);
+
+  C << "a\tb\nxyz";
+  C.flush();
+  EXPECT_EQ(3U, C.getColumn());
+  EXPECT_EQ(1U, C.getLine());
+  C.PadToColumn(8);
+  C << "#";
+  C.flush();
+  EXPECT_EQ("a\tb\nxyz     #", B.str());
+}
+
+TEST(formatted_raw_ostreamTest, Test_NoPositionTracking) {
+  SmallString<128> A;
+  raw_svector_ostream B(A);
+  formatted_raw_ostream C(B);
+  C.disablePositionTracking();
+  EXPECT_FALSE(C.isTrackingPosition());
+
+  C << "a\tb\nxyz";
+  C.flush();
+  EXPECT_EQ("a\tb\nxyz", B.str());
+  EXPECT_EQ(7U, (unsigned) C.tell());
+}
+
 }
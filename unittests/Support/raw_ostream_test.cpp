@@ -9,7 +9,10 @@
 
 #include "gtest/gtest.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Format.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 
 using namespace llvm;
@@ -182,4 +185,68 @@ TEST(raw_ostreamTest, FormatDecimal) {
 }
 
 
+TEST(raw_fd_ostreamTest, AsyncWrites) {
+  SmallString<64> Path;
+  int FD;
+  ASSERT_FALSE(sys::fs::createTemporaryFile("async", "txt", FD, Path));
+
+  // Use small buffers so that the writer has to recycle them many times,
+  // and mix small writes with writes larger than a buffer.
+  std::string Expected;
+  {
+    raw_fd_ostream OS(FD, true);
+    OS << "header\n";
+    bool Enabled = OS.enableAsyncWrites(64, 2);
+#if LLVM_ENABLE_THREADS != 0
+    EXPECT_TRUE(Enabled);
+#else
+    EXPECT_FALSE(Enabled);
+#endif
+    Expected += "header\n";
+    std::string Big(300, 'x');
+    for (unsigned I = 0; I != 1000; ++I) {
+      OS << I << ' ';
+      Expected += std::to_string(I) + ' ';
+      if (I % 100 == 0) {
+        OS << Big;
+        Expected += Big;
+      }
+    }
+    EXPECT_EQ(Expected.size(), OS.tell());
+
+    // Seeking waits for the queued buffers, so that the rewrite lands last.
+    OS.pwrite("HEADER", 6, 0);
+    Expected.replace(0, 6, "HEADER");
+    OS << "tail";
+    Expected += "tail";
+    OS.close();
+    EXPECT_FALSE(OS.has_error());
+  }
+
+  ErrorOr<std::unique_ptr<MemoryBuffer>> Buf = MemoryBuffer::getFile(Path);
+  ASSERT_TRUE(!!Buf);
+  EXPECT_EQ(Expected, (*Buf)->getBuffer().str());
+  sys::fs::remove(Path);
+}
+
+TEST(raw_fd_ostreamTest, AsyncWritesFallback) {
+  // Unbuffered streams keep writing synchronously.
+  SmallString<64> Path;
+  int FD;
+  ASSERT_FALSE(sys::fs::createTemporaryFile("async", "txt", FD, Path));
+  {
+    raw_fd_ostream OS(FD, true, /*unbuffered=*/true);
+    EXPECT_FALSE(OS.enableAsyncWrites());
+    OS << "abc";
+  }
+  sys::fs::remove(Path);
+
+#ifdef LLVM_ON_UNIX
+  // So do character devices, like pipes and terminals.
+  ASSERT_FALSE(sys::fs::openFileForWrite("/dev/null", FD, sys::fs::F_None));
+  raw_fd_ostream Null(FD, true);
+  EXPECT_FALSE(Null.enableAsyncWrites());
+#endif
+}
+
 }